@@ -0,0 +1,117 @@
+/*
+ * Stream and decode the MSM shared memory log.
+ *
+ * Puts /dev/smem_log in binary stream mode and prints each new entry
+ * as it is logged, oldest first:
+ *
+ *	timetick proc subsystem:event [cont] data1 data2 data3
+ *
+ * Usage: smem_log_stream [-s] [-i interval_ms]
+ *	-s	read the static log instead of the general one
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/ioctl.h>
+
+#define SMEM_LOG_BASE		0x30
+#define SMIOC_SETMODE		_IOW(SMEM_LOG_BASE, 1, int)
+#define SMIOC_SETLOG		_IOW(SMEM_LOG_BASE, 2, int)
+#define SMIOC_STATIC_LOG	0x00000004
+#define SMIOC_BINARY_STREAM	0x00000005
+
+#define SMEM_LOG_CONT		0x10000000
+
+struct smem_log_item {
+	uint32_t identifier;
+	uint32_t timetick;
+	uint32_t data1;
+	uint32_t data2;
+	uint32_t data3;
+};
+
+static const char *proc_name(uint32_t id)
+{
+	switch (id >> 28 & 0xe) {
+	case 0x0:
+		return "MODM";
+	case 0x4:
+		return "QDSP";
+	case 0x8:
+		return "APPS";
+	default:
+		return "????";
+	}
+}
+
+static void print_item(const struct smem_log_item *item)
+{
+	uint32_t id = item->identifier;
+
+	printf("%10u %s %03x:%04x%s 0x%08x 0x%08x 0x%08x\n",
+	       item->timetick, proc_name(id),
+	       (id >> 16) & 0xfff, id & 0xffff,
+	       (id & SMEM_LOG_CONT) ? " cont" : "",
+	       item->data1, item->data2, item->data3);
+}
+
+int main(int argc, char **argv)
+{
+	struct smem_log_item items[256];
+	int interval_ms = 100;
+	int static_log = 0;
+	ssize_t len;
+	int fd, i, c;
+
+	while ((c = getopt(argc, argv, "si:")) != -1) {
+		switch (c) {
+		case 's':
+			static_log = 1;
+			break;
+		case 'i':
+			interval_ms = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s] [-i interval_ms]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	fd = open("/dev/smem_log", O_RDONLY);
+	if (fd < 0) {
+		perror("/dev/smem_log");
+		return 1;
+	}
+
+	if (static_log && ioctl(fd, SMIOC_SETLOG, SMIOC_STATIC_LOG) < 0) {
+		perror("SMIOC_SETLOG");
+		return 1;
+	}
+	if (ioctl(fd, SMIOC_SETMODE, SMIOC_BINARY_STREAM) < 0) {
+		perror("SMIOC_SETMODE");
+		return 1;
+	}
+
+	for (;;) {
+		len = read(fd, items, sizeof(items));
+		if (len < 0) {
+			perror("read");
+			return 1;
+		}
+
+		for (i = 0; i < len / sizeof(items[0]); i++)
+			if (items[i].identifier)
+				print_item(&items[i]);
+		fflush(stdout);
+
+		if (len < sizeof(items))
+			usleep(interval_ms * 1000);
+	}
+
+	return 0;
+}
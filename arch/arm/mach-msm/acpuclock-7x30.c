@@ -23,8 +23,11 @@
 #include <linux/clk.h>
 #include <linux/cpufreq.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/io.h>
 #include <linux/sort.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 #include <mach/board.h>
 #include <mach/msm_iomap.h>
 #include <asm/mach-types.h>
@@ -67,6 +70,27 @@
 
 #define MAX_AXI_KHZ 192000
 
+/*
+ * AXI votes go through an RPC to the modem.  Lowering the vote after a
+ * cpufreq ramp down is deferred by this long so that a quick ramp back up
+ * does not pay for two round trips.
+ */
+#define AXI_DROP_DELAY_MS 50
+
+/* Switch latency histogram: bucket n counts switches of [2^(n-1), 2^n) us */
+#define SWITCH_HIST_BUCKETS 14
+
+struct switch_stats {
+	unsigned long			count;
+	unsigned long			vdd_set;
+	unsigned long			vdd_skipped;
+	unsigned long			axi_set;
+	unsigned long			axi_deferred;
+	uint32_t			avg_us;
+	uint32_t			max_us;
+	unsigned long			hist[SWITCH_HIST_BUCKETS];
+};
+
 struct clock_state {
 	struct clkctl_acpu_speed	*current_speed;
 	struct mutex			lock;
@@ -75,6 +99,12 @@ struct clock_state {
 	unsigned long			wait_for_irq_khz;
 	int				wfi_ramp_down;
 	int				pwrc_ramp_down;
+	unsigned int			vdd_raw;	/* last programmed */
+	unsigned int			vdd_mv;
+	spinlock_t			axi_lock;
+	unsigned long			axi_vote_hz;	/* last voted */
+	struct delayed_work		axi_drop_work;
+	struct switch_stats		stats;
 };
 
 struct clkctl_acpu_speed {
@@ -211,10 +241,17 @@ unsigned long acpuclk_wait_for_irq(void)
 
 static int acpuclk_set_acpu_vdd(struct clkctl_acpu_speed *s)
 {
+	int raise = s->vdd_mv > drv_state.vdd_mv;
 #ifdef CONFIG_HTC_SMEM_MSMC1C2_DEBUG
 	unsigned int smem_val;
 	int ret;
 
+	/* Skip the SPM round trip when the level is already programmed. */
+	if (s->vdd_raw == drv_state.vdd_raw) {
+		drv_state.stats.vdd_skipped++;
+		return 0;
+	}
+
 	/* store current MSMC1 and AXI */
 	smem_val = readl(HTC_SMEM_MSMC1);
 	writel(smem_val, HTC_SMEM_MSMC2_MSMC1);
@@ -234,13 +271,28 @@ static int acpuclk_set_acpu_vdd(struct clkctl_acpu_speed *s)
 	/* HTC_SMEM_MSMC2_CURR is valid only when STAT:0x33334444 */
 	writel(0x33334444, HTC_SMEM_MSMC2_STAT);
 #else
-	int ret = msm_spm_set_vdd(0, s->vdd_raw);
+	int ret;
+
+	/* Skip the SPM round trip when the level is already programmed. */
+	if (s->vdd_raw == drv_state.vdd_raw) {
+		drv_state.stats.vdd_skipped++;
+		return 0;
+	}
+
+	ret = msm_spm_set_vdd(0, s->vdd_raw);
 	if (ret)
 		return ret;
 #endif
-
-	/* Wait for voltage to stabilize. */
-	udelay(drv_state.vdd_switch_time_us);
+	drv_state.vdd_raw = s->vdd_raw;
+	drv_state.vdd_mv = s->vdd_mv;
+	drv_state.stats.vdd_set++;
+
+	/*
+	 * Wait for voltage to stabilize.  Only a raise has to settle before
+	 * the faster clock is applied; a drop happens after the slow down.
+	 */
+	if (raise)
+		udelay(drv_state.vdd_switch_time_us);
 	return 0;
 }
 
@@ -277,14 +329,67 @@ static void acpuclk_set_src(const struct clkctl_acpu_speed *s)
 
 static struct clk *ebi1_clk;
 
+/*
+ * Vote hz for the AXI bus if it is above (raise) or below (!raise) the
+ * current vote.  SWFI and power collapse get here without drv_state.lock,
+ * so the compare and the vote are done under axi_lock.
+ */
+static int acpuclk_set_axi_rate(unsigned long hz, int raise)
+{
+	unsigned long flags;
+	int rc = 0;
+
+	spin_lock_irqsave(&drv_state.axi_lock, flags);
+	if (raise ? hz > drv_state.axi_vote_hz : hz < drv_state.axi_vote_hz) {
+		rc = clk_set_rate(ebi1_clk, hz);
+		if (!rc) {
+			drv_state.axi_vote_hz = hz;
+			drv_state.stats.axi_set++;
+		}
+	}
+	spin_unlock_irqrestore(&drv_state.axi_lock, flags);
+	return rc;
+}
+
+static void acpuclk_axi_drop_work(struct work_struct *work)
+{
+	unsigned long hz;
+	int res;
+
+	mutex_lock(&drv_state.lock);
+	hz = drv_state.current_speed->axi_clk_hz;
+	res = acpuclk_set_axi_rate(hz, 0);
+	if (res < 0)
+		pr_warning("Setting AXI min rate failed (%d)\n", res);
+	mutex_unlock(&drv_state.lock);
+}
+
+static void acpuclk_record_switch(ktime_t start)
+{
+	struct switch_stats *st = &drv_state.stats;
+	uint32_t us = ktime_to_us(ktime_sub(ktime_get(), start));
+	int bucket = min(fls(us), SWITCH_HIST_BUCKETS - 1);
+
+	st->hist[bucket]++;
+	if (us > st->max_us)
+		st->max_us = us;
+	/* Running average with a weight of 1/8 for the new sample. */
+	if (st->count++)
+		st->avg_us = st->avg_us - (st->avg_us >> 3) + (us >> 3);
+	else
+		st->avg_us = us;
+}
+
 int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 {
 	struct clkctl_acpu_speed *tgt_s, *strt_s;
 	int res, rc = 0;
+	ktime_t start;
 
 	if (reason == SETRATE_CPUFREQ)
 		mutex_lock(&drv_state.lock);
 
+	start = ktime_get();
 	strt_s = drv_state.current_speed;
 
 	if (rate == (strt_s->acpu_clk_khz * 1000))
@@ -300,8 +405,11 @@ int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 	}
 
 	if (reason == SETRATE_CPUFREQ) {
-		/* Increase VDD if needed. */
-		if (tgt_s->vdd_mv > strt_s->vdd_mv) {
+		/*
+		 * Increase VDD if needed.  Compare against the level really
+		 * programmed: SWFI and power collapse ramps leave VDD alone.
+		 */
+		if (tgt_s->vdd_mv > drv_state.vdd_mv) {
 			rc = acpuclk_set_acpu_vdd(tgt_s);
 			if (rc < 0) {
 				pr_err("ACPU VDD increase to %d mV failed "
@@ -317,12 +425,10 @@ int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 	/* Increase the AXI bus frequency if needed. This must be done before
 	 * increasing the ACPU frequency, since voting for high AXI rates
 	 * implicitly takes care of increasing the MSMC1 voltage, as needed. */
-	if (tgt_s->axi_clk_hz > strt_s->axi_clk_hz) {
-		res = clk_set_rate(ebi1_clk, tgt_s->axi_clk_hz);
-		if (rc < 0) {
-			pr_err("Setting AXI min rate failed (%d)\n", rc);
-			goto out;
-		}
+	rc = acpuclk_set_axi_rate(tgt_s->axi_clk_hz, 1);
+	if (rc < 0) {
+		pr_err("Setting AXI min rate failed (%d)\n", rc);
+		goto out;
 	}
 
 	/* Make sure target PLL is on. */
@@ -346,9 +452,19 @@ int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 		pll_disable(strt_s->src);
 	}
 
-	/* Decrease the AXI bus frequency if we can. */
-	if (tgt_s->axi_clk_hz < strt_s->axi_clk_hz) {
-		res = clk_set_rate(ebi1_clk, tgt_s->axi_clk_hz);
+	/*
+	 * Decrease the AXI bus frequency if we can.  Power collapse drops
+	 * it right away; cpufreq batches the drop with any ramp up that
+	 * follows shortly.
+	 */
+	if (reason == SETRATE_CPUFREQ) {
+		if (tgt_s->axi_clk_hz < drv_state.axi_vote_hz) {
+			drv_state.stats.axi_deferred++;
+			schedule_delayed_work(&drv_state.axi_drop_work,
+				msecs_to_jiffies(AXI_DROP_DELAY_MS));
+		}
+	} else {
+		res = acpuclk_set_axi_rate(tgt_s->axi_clk_hz, 0);
 		if (res < 0)
 			pr_warning("Setting AXI min rate failed (%d)\n", res);
 	}
@@ -358,7 +474,7 @@ int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 		goto out;
 
 	/* Drop VDD level if we can. */
-	if (tgt_s->vdd_mv < strt_s->vdd_mv) {
+	if (tgt_s->vdd_mv < drv_state.vdd_mv) {
 		res = acpuclk_set_acpu_vdd(tgt_s);
 		if (res < 0) {
 			pr_warning("ACPU VDD decrease to %d mV failed (%d)\n",
@@ -367,6 +483,7 @@ int acpuclk_set_rate(unsigned long rate, enum setrate_reason reason)
 	}
 
 	dprintk("ACPU speed change complete\n");
+	acpuclk_record_switch(start);
 out:
 	if (reason == SETRATE_CPUFREQ)
 		mutex_unlock(&drv_state.lock);
@@ -390,8 +507,14 @@ unsigned long acpuclk_get_rate(void)
 		return 0;
 }
 
+/*
+ * Report the measured average once there are enough samples, rather than
+ * the conservative platform value.
+ */
 uint32_t acpuclk_get_switch_time(void)
 {
+	if (drv_state.stats.count >= 16 && drv_state.stats.avg_us)
+		return drv_state.stats.avg_us;
 	return drv_state.acpu_switch_time_us;
 }
 
@@ -437,6 +560,30 @@ static unsigned int acpuclk_get_current_vdd(void)
 	return vdd_mv;
 }
 
+static int acpuclk_get_switch_stats(char *buf, int size)
+{
+	struct switch_stats st;
+	int len;
+	int i;
+
+	mutex_lock(&drv_state.lock);
+	st = drv_state.stats;
+	mutex_unlock(&drv_state.lock);
+
+	len = scnprintf(buf, size,
+		"switches: %lu\navg_us: %u\nmax_us: %u\n"
+		"vdd_set: %lu\nvdd_skipped: %lu\n"
+		"axi_set: %lu\naxi_deferred: %lu\n",
+		st.count, st.avg_us, st.max_us, st.vdd_set, st.vdd_skipped,
+		st.axi_set, st.axi_deferred);
+	for (i = 0; i < SWITCH_HIST_BUCKETS - 1; i++)
+		len += scnprintf(buf + len, size - len, "  <%6u us: %lu\n",
+				 1U << i, st.hist[i]);
+	len += scnprintf(buf + len, size - len, " >=%6u us: %lu\n",
+			 1U << (i - 1), st.hist[i]);
+	return len;
+}
+
 static int acpuclk_update_freq_tbl(unsigned int acpu_khz, unsigned int acpu_vdd)
 {
 	struct clkctl_acpu_speed *s;
@@ -472,6 +619,7 @@ static struct acpuclock_debug_dev acpu_debug_7x30 = {
 	.get_pwrc_ramp_down = acpuclk_get_pwrc_ramp_down,
 	.get_current_vdd = acpuclk_get_current_vdd,
 	.update_freq_tbl = acpuclk_update_freq_tbl,
+	.get_switch_stats = acpuclk_get_switch_stats,
 };
 
 /*----------------------------------------------------------------------------
@@ -539,7 +687,7 @@ static void __init acpuclk_init(void)
 	ebi1_clk = clk_get(NULL, "ebi1_clk");
 	BUG_ON(ebi1_clk == NULL);
 
-	res = clk_set_rate(ebi1_clk, s->axi_clk_hz);
+	res = acpuclk_set_axi_rate(s->axi_clk_hz, 1);
 	if (res < 0)
 		pr_warning("Setting AXI min rate failed!\n");
 
@@ -630,6 +778,8 @@ void __init msm_acpu_clock_init(struct msm_acpu_clock_platform_data *clkdata)
 	pr_info("acpu_clock_init()\n");
 
 	mutex_init(&drv_state.lock);
+	spin_lock_init(&drv_state.axi_lock);
+	INIT_DELAYED_WORK(&drv_state.axi_drop_work, acpuclk_axi_drop_work);
 	drv_state.acpu_switch_time_us = clkdata->acpu_switch_time_us;
 	drv_state.vdd_switch_time_us = clkdata->vdd_switch_time_us;
 	drv_state.wfi_ramp_down = 1;
@@ -23,6 +23,7 @@ enum {
 	ATTR_CURRENT_VDD,
 	ATTR_WFI_RAMP_DOWN,
 	ATTR_PWRC_RAMP_DOWN,
+	ATTR_SWITCH_STATS,
 };
 
 #define DEBUG_BUFMAX 4096
@@ -113,6 +114,12 @@ static ssize_t debug_read(struct file *file, char __user *buf,
 		bsize = sprintf(debug_buffer,
 			"%d\n", acpu_debug_dev->get_pwrc_ramp_down());
 		break;
+	case ATTR_SWITCH_STATS:
+		if (!acpu_debug_dev->get_switch_stats)
+			return -EINVAL;
+		bsize = acpu_debug_dev->get_switch_stats(debug_buffer,
+			DEBUG_BUFMAX);
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -155,6 +162,8 @@ static int __init acpuclock_debugfs_init(void)
 		(void *)ATTR_WFI_RAMP_DOWN, &debug_ops);
 	debugfs_create_file("pwrc_ramp_down", 0600, dent,
 		(void *)ATTR_PWRC_RAMP_DOWN, &debug_ops);
+	debugfs_create_file("switch_stats", 0400, dent,
+		(void *)ATTR_SWITCH_STATS, &debug_ops);
 	return 0;
 }
 
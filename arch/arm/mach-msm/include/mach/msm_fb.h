@@ -21,6 +21,7 @@
 
 struct mddi_info;
 struct mdp_device;
+struct msm_sync_fence;
 
 /* output interface format */
 #define MSM_MDP_OUT_IF_FMT_RGB565 0
@@ -250,6 +251,11 @@ struct mdp_device {
 	void (*dma_wait)(struct mdp_device *mdp, int interface);
 	int (*blit)(struct mdp_device *mdp, struct fb_info *fb,
 		    struct mdp_blit_req *req);
+	/* queue the blits, returns a fence from linux/msm_sync.h */
+	struct msm_sync_fence *(*blit_async)(struct mdp_device *mdp,
+					     struct fb_info *fb,
+					     struct mdp_blit_req *reqs,
+					     int count);
 #ifdef CONFIG_FB_MSM_OVERLAY
 	int (*overlay_get)(struct mdp_device *mdp, struct fb_info *fb,
 		    struct mdp_overlay *req);
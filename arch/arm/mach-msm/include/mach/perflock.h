@@ -20,6 +20,8 @@
 #define __ARCH_ARM_MACH_PERF_LOCK_H
 
 #include <linux/list.h>
+#include <linux/plist.h>
+#include <linux/ktime.h>
 
 /*
  * Performance level determine differnt EBI1 rate
@@ -32,11 +34,27 @@ enum {
 	PERF_LOCK_INVALID,
 };
 
+/*
+ * A floor lock keeps the cpu at or above the speed of its level, a
+ * ceiling lock keeps it at or below.  The governor picks the speed inside
+ * the band left by all active locks.
+ */
+enum {
+	PERF_LOCK_TYPE_FLOOR,
+	PERF_LOCK_TYPE_CEILING,
+};
+
 struct perf_lock {
 	struct list_head link;
+	struct plist_node qos_node;
 	unsigned int flags;
 	unsigned int level;
+	unsigned int type;
 	const char *name;
+	/* Residency statistics, reported in debugfs */
+	unsigned long count;
+	ktime_t last_active;
+	ktime_t total_time;
 };
 
 struct perflock_platform_data {
@@ -49,6 +67,8 @@ static inline void __init perflock_init(
 	struct perflock_platform_data *pdata) { return; }
 static inline void perf_lock_init(struct perf_lock *lock,
 	unsigned int level, const char *name) { return; }
+static inline void perf_lock_init_type(struct perf_lock *lock,
+	unsigned int type, unsigned int level, const char *name) { return; }
 static inline void perf_lock(struct perf_lock *lock) { return; }
 static inline void perf_unlock(struct perf_lock *lock) { return; }
 static inline int is_perf_lock_active(struct perf_lock *lock) { return 0; }
@@ -57,6 +77,8 @@ static inline int is_perf_locked(void) { return 0; }
 extern void __init perflock_init(struct perflock_platform_data *pdata);
 extern void perf_lock_init(struct perf_lock *lock,
 	unsigned int level, const char *name);
+extern void perf_lock_init_type(struct perf_lock *lock,
+	unsigned int type, unsigned int level, const char *name);
 extern void perf_lock(struct perf_lock *lock);
 extern void perf_unlock(struct perf_lock *lock);
 extern int is_perf_lock_active(struct perf_lock *lock);
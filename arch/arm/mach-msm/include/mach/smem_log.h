@@ -47,6 +47,7 @@
 #define SMIOC_BINARY 0x00000002
 #define SMIOC_LOG 0x00000003
 #define SMIOC_STATIC_LOG 0x00000004
+#define SMIOC_BINARY_STREAM 0x00000005
 
 /* Event indentifier format:
  * bit  31-28 is processor ID 8 => apps, 4 => Q6, 0 => modem
@@ -227,6 +227,10 @@ void __print_resource(struct npa_resource *r)
 			rname, r->active_max);
 	pr_info("NPA: Resource [%s] Active headroom: [%u]\n",
 			rname, r->active_headroom);
+	pr_info("NPA: Resource [%s] Requests: [%u] Driver calls: [%u] "
+			"Events published: [%u]\n",
+			rname, r->request_count, r->driver_count,
+			r->publish_count);
 }
 EXPORT_SYMBOL(__print_resource);
 
@@ -292,18 +296,20 @@ static struct npa_resource *__get_resource(const char *resource_name)
 	return NULL;
 }
 
-static int __is_active_resource(struct npa_resource *resource)
+static void sorted_client_remove(struct npa_client *client)
 {
-	struct npa_resource *res_itr = NULL;
-
-	if (resource && !list_empty(&active_list)) {
-		list_for_each_entry(res_itr, &active_list, list) {
-			if (resource == res_itr)
-				return 1;
-		}
+	if (!RB_EMPTY_NODE(&client->node)) {
+		rb_erase(&client->node, &client->resource->requests);
+		RB_CLEAR_NODE(&client->node);
 	}
+}
 
-	return 0;
+/* Resources are flagged when moved to the active list, so checking does not
+ * require walking the list.
+ */
+static int __is_active_resource(struct npa_resource *resource)
+{
+	return resource && resource->active;
 }
 
 static struct npa_resource *active_resource(const char *resource_name)
@@ -591,7 +597,8 @@ static void publish_resource_state(struct npa_resource *resource)
 		"NPA: Queueing work for resource [%s]\n",
 		resource->definition->name);
 
-	queue_work(npa_wq, &resource->work);
+	if (queue_work(npa_wq, &resource->work))
+		resource->publish_count++;
 }
 
 /* Activate this resource and all other resources that are part of this node.
@@ -641,6 +648,7 @@ static int activate_node(struct npa_resource *resource)
 		write_lock(&list_lock);
 		list_del(&def->resource->list); /* Remove from waiting list */
 		list_add(&def->resource->list, &active_list);
+		def->resource->active = 1;
 		write_unlock(&list_lock);
 		def->resource->active_state =
 			def->resource->node->driver_fn(def->resource, &dummy,
@@ -670,12 +678,16 @@ static void request_state(struct npa_resource *resource,
 		struct npa_client *client, unsigned int state)
 {
 	unsigned int new_state;
+	unsigned int old_state;
+	int report_all;
+	int changed = 0;
 
 	npa_log(NPA_LOG_MASK_CLIENT, resource,
 		"NPA: Resource [%s] client [%s] requested state [%u]\n",
 		resource->definition->name, client->name, state);
 
 	RESOURCE_LOCK(resource);
+	resource->request_count++;
 	PENDING_STATE(client) = state;
 	new_state = resource->active_plugin->update_fn(resource, client);
 	ACTIVE_STATE(client) = PENDING_STATE(client);
@@ -684,14 +696,17 @@ static void request_state(struct npa_resource *resource,
 	if (new_state > resource->active_max)
 		new_state = resource->active_max;
 
-	if ((resource->definition->attributes &
-				NPA_RESOURCE_REPORT_ALL_REQS) ||
-				new_state != resource->active_state) {
+	report_all = resource->definition->attributes &
+				NPA_RESOURCE_REPORT_ALL_REQS;
+	if (report_all || new_state != resource->active_state) {
+		old_state = resource->active_state;
 		resource->active_state =
 			resource->node->driver_fn(resource, client,
 					new_state);
 		resource->active_headroom = resource->active_max -
 						resource->active_state;
+		resource->driver_count++;
+		changed = report_all || resource->active_state != old_state;
 	}
 	RESOURCE_UNLOCK(resource);
 
@@ -699,7 +714,12 @@ static void request_state(struct npa_resource *resource,
 		"NPA: Resource [%s] state set to [%u]\n",
 		resource->definition->name, resource->active_state);
 
-	publish_resource_state(resource);
+	/* Requests that leave the resource state alone have nothing to
+	 * report. Back to back changes coalesce into one update work, which
+	 * reads the latest state when it runs.
+	 */
+	if (changed)
+		publish_resource_state(resource);
 }
 
 /* Return if any dependency of this resource is still not active.
@@ -1052,6 +1072,7 @@ struct npa_client *npa_create_sync_client(const char *resource_name,
 		return ERR_PTR(-ENOMEM);;
 	}
 	INIT_LIST_HEAD(&client->list);
+	RB_CLEAR_NODE(&client->node);
 	client->name = client_name;
 	client->resource_name = resource_name;
 	client->resource = resource;
@@ -1085,6 +1106,7 @@ void npa_destroy_client(struct npa_client *client)
 		RESOURCE_LOCK(resource);
 		if (resource->active_plugin->destroy_client_fn)
 			resource->active_plugin->destroy_client_fn(client);
+		sorted_client_remove(client);
 		list_del(&client->list);
 		RESOURCE_UNLOCK(resource);
 		kfree(client);
@@ -1374,6 +1396,40 @@ EXPORT_SYMBOL(npa_set_event_watermarks);
 /* Pre-defined NPA update functions.
  * Currently we only consider "required" client requests.
  */
+
+/* Non-zero required client states are kept sorted in the resource's
+ * requests tree, so min and max aggregation reads the ends of the tree
+ * instead of walking every client on each request.
+ */
+static void sorted_client_update(struct npa_resource *resource,
+		struct npa_client *client, unsigned int state)
+{
+	struct rb_node **p = &resource->requests.rb_node;
+	struct rb_node *parent = NULL;
+	struct npa_client *cl_itr = NULL;
+
+	if (!RB_EMPTY_NODE(&client->node)) {
+		if (client->sorted_state == state)
+			return;
+		rb_erase(&client->node, &resource->requests);
+		RB_CLEAR_NODE(&client->node);
+	}
+
+	if (!state)
+		return;
+
+	while (*p) {
+		parent = *p;
+		cl_itr = rb_entry(parent, struct npa_client, node);
+		if (state < cl_itr->sorted_state)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	client->sorted_state = state;
+	rb_link_node(&client->node, parent, p);
+	rb_insert_color(&client->node, &resource->requests);
+}
 static unsigned int binary_update(struct npa_resource *resource,
 					struct npa_client *client)
 {
@@ -1405,35 +1461,18 @@ static unsigned int binary_update(struct npa_resource *resource,
 static unsigned int min_update(struct npa_resource *resource,
 					struct npa_client *client)
 {
-	struct npa_client *cl_itr = NULL;
-	unsigned int val = PENDING_STATE(client);
+	struct rb_node *first = NULL;
+	unsigned int val = 0;
 
 	__print_client_states(resource);
 
 	if (!(client->type & NPA_CLIENT_REQUIRED))
 		return resource->active_state;
 
-	if (val && (resource->active_state == ACTIVE_STATE(client)) &&
-		(val <= ACTIVE_STATE(client))) {
-
-		npa_log(NPA_LOG_MASK_PLUGIN, resource,
-			"NPA: Min plugin: Current request [%u] is min for "
-			"resource [%s]\n",
-			val, resource->definition->name);
-
-		return val;
-	}
-
-	list_for_each_entry(cl_itr, &resource->clients, list) {
-		if (!(cl_itr->type & NPA_CLIENT_REQUIRED))
-			continue;
-		if ((cl_itr != client) && ACTIVE_STATE(cl_itr)) {
-			if (!val)
-				val = ACTIVE_STATE(cl_itr);
-			if (ACTIVE_STATE(cl_itr) < val)
-				val = ACTIVE_STATE(cl_itr);
-		}
-	}
+	sorted_client_update(resource, client, PENDING_STATE(client));
+	first = rb_first(&resource->requests);
+	if (first)
+		val = rb_entry(first, struct npa_client, node)->sorted_state;
 
 	npa_log(NPA_LOG_MASK_PLUGIN, resource,
 		"NPA: Min plugin: Calculated [%u] for resource [%s] "
@@ -1446,36 +1485,18 @@ static unsigned int min_update(struct npa_resource *resource,
 static unsigned int max_update(struct npa_resource *resource,
 					struct npa_client *client)
 {
-	struct npa_client *cl_itr = NULL;
-	unsigned int val = PENDING_STATE(client);
+	struct rb_node *last = NULL;
+	unsigned int val = 0;
 
 	__print_client_states(resource);
 
 	if (!(client->type & NPA_CLIENT_REQUIRED))
 		return resource->active_state;
 
-	if ((val != 0) &&
-		(resource->active_state == ACTIVE_STATE(client)) &&
-		(val >= ACTIVE_STATE(client))) {
-
-		npa_log(NPA_LOG_MASK_PLUGIN, resource,
-			"NPA: Max plugin: Current request [%u] is max for "
-			"resource [%s]\n",
-			val, resource->definition->name);
-
-		return val;
-	}
-
-	list_for_each_entry(cl_itr, &resource->clients, list) {
-		if (!(cl_itr->type & NPA_CLIENT_REQUIRED))
-			continue;
-		if ((cl_itr != client) && ACTIVE_STATE(cl_itr)) {
-			if (!val)
-				val = ACTIVE_STATE(cl_itr);
-			if (ACTIVE_STATE(cl_itr) > val)
-				val = ACTIVE_STATE(cl_itr);
-		}
-	}
+	sorted_client_update(resource, client, PENDING_STATE(client));
+	last = rb_last(&resource->requests);
+	if (last)
+		val = rb_entry(last, struct npa_client, node)->sorted_state;
 
 	npa_log(NPA_LOG_MASK_PLUGIN, resource,
 		"NPA: Max plugin: Calculated [%u] for resource [%s] "
@@ -34,6 +34,7 @@
 #define NPA_RESOURCE_H
 
 #include <linux/workqueue.h>
+#include <linux/rbtree.h>
 #include "npa.h"
 
 #define ACTIVE_REQUEST		0
@@ -215,6 +216,12 @@ struct npa_resource {
 	struct mutex			*resource_lock; /* Node lock */
 	unsigned int			level; /* Resource depth for locks */
 	struct work_struct		work;
+	struct rb_root			requests; /* Non-zero required client
+						   * states, sorted */
+	int				active; /* On the active list */
+	unsigned int			request_count;
+	unsigned int			driver_count;
+	unsigned int			publish_count;
 };
 
 /* NPA work structure */
@@ -235,6 +242,8 @@ struct npa_client {
 	struct list_head		list; /* Part of resource's clients */
 	enum npa_client_type 		type;
 	struct npa_work_request 	work[2]; 	/* Active and Pending */
+	struct rb_node			node; /* Part of resource's requests */
+	unsigned int			sorted_state; /* Key in requests */
 	void 				*resource_data; /* Place holder for
 							 * resource to
 							 * associate data */
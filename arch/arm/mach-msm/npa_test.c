@@ -0,0 +1,147 @@
+/* arch/arm/mach-msm/npa_test.c
+ *
+ * NPA request throughput test, run once during bootup against synthetic
+ * nodes, so no remote processor is needed.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+
+#include <asm/div64.h>
+
+#include "npa.h"
+#include "npa_resource.h"
+
+#define TEST_NPA_CLIENTS	64
+#define TEST_NPA_LOOPS		10000
+
+static unsigned int test_npa_driver_fn(struct npa_resource *resource,
+		struct npa_client *client, unsigned int state)
+{
+	return state;
+}
+
+static struct npa_resource_definition test_npa_resources[] = {
+	{
+		.name = "/npa/test/max",
+		.units = "units",
+		.attributes = NPA_RESOURCE_DEFAULT,
+		.max = UINT_MAX,
+		.plugin = &npa_max_plugin,
+	},
+	{
+		.name = "/npa/test/min",
+		.units = "units",
+		.attributes = NPA_RESOURCE_DEFAULT,
+		.max = UINT_MAX,
+		.plugin = &npa_min_plugin,
+	},
+	{
+		.name = "/npa/test/sum",
+		.units = "units",
+		.attributes = NPA_RESOURCE_DEFAULT,
+		.max = UINT_MAX,
+		.plugin = &npa_sum_plugin,
+	},
+};
+
+static struct npa_node_definition test_npa_node = {
+	.name = "/node/npa/test",
+	.attributes = NPA_NODE_DEFAULT,
+	.driver_fn = test_npa_driver_fn,
+	.resources = test_npa_resources,
+	.resource_count = ARRAY_SIZE(test_npa_resources),
+};
+
+static unsigned int test_npa_initial_state[] = { 0, 0, 0 };
+
+static void __init test_npa_run(struct npa_resource_definition *def,
+		struct npa_client **clients)
+{
+	struct npa_resource *resource = def->resource;
+	unsigned int requests = resource->request_count;
+	unsigned int driver = resource->driver_count;
+	unsigned int publish = resource->publish_count;
+	ktime_t start;
+	u64 ns;
+	int i;
+
+	for (i = 0; i < TEST_NPA_CLIENTS; i++) {
+		clients[i] = npa_create_sync_client(def->name, "npa_test",
+				NPA_CLIENT_REQUIRED);
+		if (IS_ERR(clients[i])) {
+			pr_err("npa test: %s: client create failed %ld\n",
+					def->name, PTR_ERR(clients[i]));
+			goto destroy;
+		}
+		npa_issue_required_request(clients[i], i + 1);
+	}
+
+	/* Mostly unchanged aggregates, with the top client moving every
+	 * eighth request, the way bus and clock votes usually behave.
+	 */
+	start = ktime_get();
+	for (i = 0; i < TEST_NPA_LOOPS; i++) {
+		if (i & 7)
+			npa_issue_required_request(
+				clients[i % (TEST_NPA_CLIENTS - 1)],
+				(i % (TEST_NPA_CLIENTS - 1)) + 1);
+		else
+			npa_issue_required_request(
+				clients[TEST_NPA_CLIENTS - 1],
+				TEST_NPA_CLIENTS + (i & 8));
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	do_div(ns, TEST_NPA_LOOPS);
+
+	pr_info("npa test: %s: %d clients, %llu ns/request, state %u, "
+			"%u requests, %u driver calls, %u events published\n",
+			def->name, TEST_NPA_CLIENTS, ns, resource->active_state,
+			resource->request_count - requests,
+			resource->driver_count - driver,
+			resource->publish_count - publish);
+
+	i = TEST_NPA_CLIENTS;
+destroy:
+	while (i--)
+		npa_destroy_client(clients[i]);
+}
+
+static int __init test_npa(void)
+{
+	struct npa_client **clients;
+	int ret;
+	int i;
+
+	clients = kzalloc(sizeof(*clients) * TEST_NPA_CLIENTS, GFP_KERNEL);
+	if (!clients)
+		return -ENOMEM;
+
+	ret = npa_define_node(&test_npa_node, test_npa_initial_state,
+			NULL, NULL);
+	if (ret) {
+		pr_err("npa test: node define failed %d\n", ret);
+		goto done;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(test_npa_resources); i++)
+		test_npa_run(&test_npa_resources[i], clients);
+
+done:
+	kfree(clients);
+	return ret;
+}
+late_initcall(test_npa);
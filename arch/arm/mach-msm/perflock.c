@@ -22,6 +22,7 @@
 #include <linux/earlysuspend.h>
 #include <linux/cpufreq.h>
 #include <linux/timer.h>
+#include <linux/seq_file.h>
 #include <mach/perflock.h>
 #include "proc_comm.h"
 #include "acpuclock.h"
@@ -41,10 +42,19 @@ static LIST_HEAD(active_perf_locks);
 static LIST_HEAD(inactive_perf_locks);
 static DEFINE_SPINLOCK(list_lock);
 static DEFINE_SPINLOCK(policy_update_lock);
+/*
+ * Active locks of each type ordered by priority, like pm_qos requests:
+ * floor locks use -level so the highest floor comes first, ceiling locks
+ * use level so the lowest ceiling comes first.  Protected by list_lock.
+ */
+static struct plist_head floor_locks = PLIST_HEAD_INIT(floor_locks, list_lock);
+static struct plist_head ceiling_locks =
+	PLIST_HEAD_INIT(ceiling_locks, list_lock);
 static int initialized;
 static unsigned int *perf_acpu_table;
 static unsigned int table_size;
 static unsigned int curr_lock_speed;
+static unsigned int curr_ceiling_speed;
 static struct cpufreq_policy *cpufreq_policy;
 
 #ifdef CONFIG_PERF_LOCK_DEBUG
@@ -57,6 +67,7 @@ module_param_call(debug_mask, param_set_int, param_get_int,
 		&debug_mask, S_IWUSR | S_IRUGO);
 
 static unsigned int get_perflock_speed(void);
+static unsigned int get_perflock_ceiling(void);
 static void print_active_locks(void);
 
 #ifdef CONFIG_PERFLOCK_SCREEN_POLICY
@@ -182,6 +193,7 @@ static int perflock_notifier_call(struct notifier_block *self,
 {
 	struct cpufreq_policy *policy = data;
 	unsigned int lock_speed;
+	unsigned int ceiling_speed;
 	unsigned long irqflags;
 
 	spin_lock_irqsave(&policy_update_lock, irqflags);
@@ -215,23 +227,33 @@ static int perflock_notifier_call(struct notifier_block *self,
 			screen_off_policy_req--;
 		}
 #endif
+		/*
+		 * Floor locks raise the minimum and ceiling locks lower the
+		 * maximum; the governor keeps scaling inside what is left.
+		 * A ceiling wins over a conflicting floor.
+		 */
 		lock_speed = get_perflock_speed() / 1000;
-		if (lock_speed) {
+		ceiling_speed = get_perflock_ceiling() / 1000;
+		policy->min = policy_min;
+		policy->max = policy_max;
+		if (ceiling_speed && ceiling_speed < policy->max)
+			policy->max = ceiling_speed;
+		if (lock_speed > policy->min)
 			policy->min = lock_speed;
-			policy->max = lock_speed;
-			if (debug_mask & PERF_CPUFREQ_LOCK_DEBUG) {
-				pr_info("%s: cpufreq lock speed %d\n",
-					__func__, lock_speed);
+		if (policy->min > policy->max)
+			policy->min = policy->max;
+
+		if (debug_mask & PERF_CPUFREQ_LOCK_DEBUG) {
+			if (lock_speed || ceiling_speed) {
+				pr_info("%s: cpufreq lock floor %d ceiling %d\n",
+					__func__, lock_speed, ceiling_speed);
 				print_active_locks();
-			}
-		} else {
-			policy->min = policy_min;
-			policy->max = policy_max;
-			if (debug_mask & PERF_CPUFREQ_LOCK_DEBUG)
+			} else
 				pr_info("%s: cpufreq recover policy %d %d\n",
 					__func__, policy->min, policy->max);
 		}
 		curr_lock_speed = lock_speed;
+		curr_ceiling_speed = ceiling_speed;
 	}
 	spin_unlock_irqrestore(&policy_update_lock, irqflags);
 
@@ -242,24 +264,46 @@ static struct notifier_block perflock_notifier = {
 	.notifier_call = perflock_notifier_call,
 };
 
-static unsigned int get_perflock_speed(void)
+static unsigned int get_perflock_level(struct plist_head *head)
 {
 	unsigned long irqflags;
-	struct perf_lock *lock;
-	unsigned int perf_level = 0;
-
-	/* Get the maxmimum perf level. */
-	if (list_empty(&active_perf_locks))
-		return 0;
+	int level = -1;
 
 	spin_lock_irqsave(&list_lock, irqflags);
-	list_for_each_entry(lock, &active_perf_locks, link) {
-		if (lock->level > perf_level)
-			perf_level = lock->level;
-	}
+	if (!plist_head_empty(head))
+		level = plist_first_entry(head, struct perf_lock,
+					  qos_node)->level;
 	spin_unlock_irqrestore(&list_lock, irqflags);
 
-	return perf_acpu_table[perf_level];
+	return level;
+}
+
+/* Speed of the highest active floor lock, 0 if none. */
+static unsigned int get_perflock_speed(void)
+{
+	int level = get_perflock_level(&floor_locks);
+
+	return level < 0 ? 0 : perf_acpu_table[level];
+}
+
+/* Speed of the lowest active ceiling lock, 0 if none. */
+static unsigned int get_perflock_ceiling(void)
+{
+	int level = get_perflock_level(&ceiling_locks);
+
+	return level < 0 ? 0 : perf_acpu_table[level];
+}
+
+static int perflock_changed(void)
+{
+	return curr_lock_speed != get_perflock_speed() / 1000 ||
+		curr_ceiling_speed != get_perflock_ceiling() / 1000;
+}
+
+static struct plist_head *perf_lock_head(struct perf_lock *lock)
+{
+	return lock->type == PERF_LOCK_TYPE_CEILING ?
+		&ceiling_locks : &floor_locks;
 }
 
 static void print_active_locks(void)
@@ -269,43 +313,68 @@ static void print_active_locks(void)
 
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_for_each_entry(lock, &active_perf_locks, link) {
-		pr_info("active perf lock '%s'\n", lock->name);
+		pr_info("active perf lock '%s'%s\n", lock->name,
+			lock->type == PERF_LOCK_TYPE_CEILING ?
+			" (ceiling)" : "");
 	}
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
 /**
- * perf_lock_init - acquire a perf lock
+ * perf_lock_init_type - acquire a floor or ceiling perf lock
  * @lock: perf lock to acquire
+ * @type: PERF_LOCK_TYPE_FLOOR or PERF_LOCK_TYPE_CEILING
  * @level: performance level of @lock
  * @name: the name of @lock
  *
- * Acquire @lock with @name and @level. (It doesn't activate the lock.)
+ * Acquire @lock with @name, @type and @level. (It doesn't activate the lock.)
  */
-void perf_lock_init(struct perf_lock *lock,
+void perf_lock_init_type(struct perf_lock *lock, unsigned int type,
 			unsigned int level, const char *name)
 {
 	unsigned long irqflags = 0;
 
 	WARN_ON(!name);
 	WARN_ON(level >= PERF_LOCK_INVALID);
+	WARN_ON(type > PERF_LOCK_TYPE_CEILING);
 	WARN_ON(lock->flags & PERF_LOCK_INITIALIZED);
 
 	if ((!name) || (level >= PERF_LOCK_INVALID) ||
+			(type > PERF_LOCK_TYPE_CEILING) ||
 			(lock->flags & PERF_LOCK_INITIALIZED)) {
-		pr_err("%s: ERROR \"%s\" flags %x level %d\n",
-			__func__, name, lock->flags, level);
+		pr_err("%s: ERROR \"%s\" flags %x type %d level %d\n",
+			__func__, name, lock->flags, type, level);
 		return;
 	}
 	lock->name = name;
 	lock->flags = PERF_LOCK_INITIALIZED;
 	lock->level = level;
+	lock->type = type;
+	lock->count = 0;
+	lock->total_time = ktime_set(0, 0);
 
 	INIT_LIST_HEAD(&lock->link);
+	plist_node_init(&lock->qos_node,
+		type == PERF_LOCK_TYPE_CEILING ? level : -level);
 	spin_lock_irqsave(&list_lock, irqflags);
 	list_add(&lock->link, &inactive_perf_locks);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
+EXPORT_SYMBOL(perf_lock_init_type);
+
+/**
+ * perf_lock_init - acquire a perf lock
+ * @lock: perf lock to acquire
+ * @level: performance level of @lock
+ * @name: the name of @lock
+ *
+ * Acquire a floor lock with @name and @level. (It doesn't activate the lock.)
+ */
+void perf_lock_init(struct perf_lock *lock,
+			unsigned int level, const char *name)
+{
+	perf_lock_init_type(lock, PERF_LOCK_TYPE_FLOOR, level, name);
+}
 EXPORT_SYMBOL(perf_lock_init);
 
 /**
@@ -327,17 +396,20 @@ void perf_lock(struct perf_lock *lock)
 		pr_info("%s: '%s', flags %d level %d\n",
 			__func__, lock->name, lock->flags, lock->level);
 	if (lock->flags & PERF_LOCK_ACTIVE) {
+		spin_unlock_irqrestore(&list_lock, irqflags);
 		pr_err("%s: over-locked\n", __func__);
 		return;
 	}
 	lock->flags |= PERF_LOCK_ACTIVE;
+	lock->count++;
+	lock->last_active = ktime_get();
 	list_del(&lock->link);
 	list_add(&lock->link, &active_perf_locks);
+	plist_add(&lock->qos_node, perf_lock_head(lock));
 	spin_unlock_irqrestore(&list_lock, irqflags);
 
 	/* Update cpufreq policy - scaling_min/scaling_max */
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000)))
+	if (cpufreq_policy && perflock_changed())
 		cpufreq_update_policy(cpufreq_policy->cpu);
 }
 EXPORT_SYMBOL(perf_lock);
@@ -348,8 +420,7 @@ static void do_expire_perf_locks(struct work_struct *work)
 	if (debug_mask & PERF_EXPIRE_DEBUG)
 		pr_info("%s: timed out to unlock\n", __func__);
 
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000))) {
+	if (cpufreq_policy && perflock_changed()) {
 		if (debug_mask & PERF_EXPIRE_DEBUG)
 			pr_info("%s: update cpufreq policy\n", __func__);
 		cpufreq_update_policy(cpufreq_policy->cpu);
@@ -375,17 +446,20 @@ void perf_unlock(struct perf_lock *lock)
 		pr_info("%s: '%s', flags %d level %d\n",
 			__func__, lock->name, lock->flags, lock->level);
 	if (!(lock->flags & PERF_LOCK_ACTIVE)) {
+		spin_unlock_irqrestore(&list_lock, irqflags);
 		pr_err("%s: under-locked\n", __func__);
 		return;
 	}
 	lock->flags &= ~PERF_LOCK_ACTIVE;
+	lock->total_time = ktime_add(lock->total_time,
+		ktime_sub(ktime_get(), lock->last_active));
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_perf_locks);
+	plist_del(&lock->qos_node, perf_lock_head(lock));
 	spin_unlock_irqrestore(&list_lock, irqflags);
 
 	/* Prevent lock/unlock quickly, add a timeout to release perf_lock */
-	if (cpufreq_policy &&
-			(curr_lock_speed != (get_perflock_speed() / 1000)))
+	if (cpufreq_policy && perflock_changed())
 		schedule_delayed_work(&work_expire_perf_locks,
 			PERF_UNLOCK_DELAY);
 }
@@ -414,6 +488,64 @@ int is_perf_locked(void)
 }
 EXPORT_SYMBOL(is_perf_locked);
 
+#ifdef CONFIG_DEBUG_FS
+static void perflock_stats_show_one(struct seq_file *m,
+				    struct perf_lock *lock, ktime_t now)
+{
+	ktime_t total = lock->total_time;
+
+	if (lock->flags & PERF_LOCK_ACTIVE)
+		total = ktime_add(total, ktime_sub(now, lock->last_active));
+
+	seq_printf(m, "%-24s %-7s %5u %6s %8lu %12lld\n", lock->name,
+		   lock->type == PERF_LOCK_TYPE_CEILING ? "ceiling" : "floor",
+		   lock->level < table_size ?
+			perf_acpu_table[lock->level] / 1000 : 0,
+		   lock->flags & PERF_LOCK_ACTIVE ? "yes" : "no",
+		   lock->count, ktime_to_ms(total));
+}
+
+static int perflock_stats_show(struct seq_file *m, void *unused)
+{
+	unsigned long irqflags;
+	struct perf_lock *lock;
+	ktime_t now = ktime_get();
+
+	seq_printf(m, "floor %u ceiling %u (kHz, 0 = none)\n",
+		   curr_lock_speed, curr_ceiling_speed);
+	seq_printf(m, "%-24s %-7s %5s %6s %8s %12s\n", "name", "type",
+		   "kHz", "active", "count", "active_ms");
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	list_for_each_entry(lock, &active_perf_locks, link)
+		perflock_stats_show_one(m, lock, now);
+	list_for_each_entry(lock, &inactive_perf_locks, link)
+		perflock_stats_show_one(m, lock, now);
+	spin_unlock_irqrestore(&list_lock, irqflags);
+
+	return 0;
+}
+
+static int perflock_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, perflock_stats_show, NULL);
+}
+
+static const struct file_operations perflock_stats_fops = {
+	.open		= perflock_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init perflock_debugfs_init(void)
+{
+	debugfs_create_file("perflock", S_IRUGO, NULL, NULL,
+			    &perflock_stats_fops);
+	return 0;
+}
+late_initcall(perflock_debugfs_init);
+#endif
 
 #ifdef CONFIG_PERFLOCK_BOOT_LOCK
 /* Stop cpufreq and lock cpu, shorten boot time. */
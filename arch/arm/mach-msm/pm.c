@@ -27,6 +27,7 @@
 #include <linux/reboot.h>
 #include <linux/earlysuspend.h>
 #include <linux/pm_qos_params.h>
+#include <linux/ktime.h>
 #include <mach/msm_iomap.h>
 #include <mach/system.h>
 #include <asm/io.h>
@@ -662,11 +663,17 @@ static int msm_pm_idle_spin(void)
 	return 0;
 }
 
-void arch_idle(void)
+/*
+ * Enter the deepest idle mode no deeper than @idle_sleep_mode that the
+ * next timer event, idle wakelocks and pending interrupts allow.  Returns
+ * the mode actually entered, or -1 if idle was not attempted.
+ */
+static int msm_pm_idle(int idle_sleep_mode)
 {
 	bool allow[MSM_PM_SLEEP_MODE_NR];
 	int64_t sleep_time;
 	int low_power = 0;
+	int entered = MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT;
 	int ret;
 	int i;
 #ifdef CONFIG_MSM_IDLE_STATS
@@ -676,7 +683,7 @@ void arch_idle(void)
 #endif
 
 	if (msm_pm_reset_vector == NULL)
-		return;
+		return -1;
 
 	sleep_time = msm_timer_enter_idle();
 #ifdef CONFIG_MSM_IDLE_STATS
@@ -688,7 +695,7 @@ void arch_idle(void)
 	for (i = 0; i < MSM_PM_SLEEP_MODE_NR; i++)
 		allow[i] = true;
 
-	switch (msm_pm_idle_sleep_mode) {
+	switch (idle_sleep_mode) {
 	case MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT:
 		allow[MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT] =
 			false;
@@ -707,7 +714,7 @@ void arch_idle(void)
 	case MSM_PM_SLEEP_MODE_POWER_COLLAPSE:
 		break;
 	default:
-		pr_err("idle sleep mode is invalid: %d\n", msm_pm_idle_sleep_mode);
+		pr_err("idle sleep mode is invalid: %d\n", idle_sleep_mode);
 #ifdef CONFIG_MSM_IDLE_STATS
 		exit_stat = MSM_PM_STAT_IDLE_SPIN;
 #endif
@@ -757,7 +764,9 @@ void arch_idle(void)
 			printk("sleep_time too big %lld\n", sleep_time);
 			sleep_time = 0x6DDD000;
 		}
-		ret = msm_sleep(msm_pm_idle_sleep_mode, sleep_time, 1);
+		ret = msm_sleep(idle_sleep_mode, sleep_time, 1);
+		if (!ret)
+			entered = idle_sleep_mode;
 #ifdef CONFIG_MSM_IDLE_STATS
 		if (ret)
 			exit_stat = MSM_PM_STAT_IDLE_FAILED_SLEEP;
@@ -766,6 +775,8 @@ void arch_idle(void)
 #endif
 	} else if (allow[MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE]) {
 		ret = msm_pm_power_collapse_standalone();
+		if (!ret)
+			entered = MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE;
 #ifdef CONFIG_MSM_IDLE_STATS
 		if (ret)
 			exit_stat = MSM_PM_STAT_IDLE_FAILED_STANDALONE_POWER_COLLAPSE;
@@ -804,6 +815,9 @@ void arch_idle(void)
 		    && acpuclk_set_rate(saved_rate, SETRATE_SWFI) < 0)
 			printk(KERN_ERR "msm_sleep(): clk_set_rate %ld "
 			       "failed\n", saved_rate);
+		if (saved_rate)
+			entered =
+			    MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT;
 #ifdef CONFIG_MSM_IDLE_STATS
 		exit_stat = MSM_PM_STAT_IDLE_WFI;
 #endif
@@ -820,8 +834,154 @@ abort_idle:
 	t2 = ktime_to_ns(ktime_get());
 	msm_pm_add_stat(exit_stat, t2 - t1);
 #endif
+	return entered;
+}
+
+void arch_idle(void)
+{
+	msm_pm_idle(msm_pm_idle_sleep_mode);
 }
 
+#ifdef CONFIG_CPU_IDLE
+/*
+ * cpuidle driver: one state per idle-enabled sleep mode, shallowest first.
+ * The cpuidle governor (menu) picks a state from its prediction of the
+ * idle length, which it corrects from the residency of past idle periods,
+ * instead of always trying the deepest mode the next timer allows.
+ * idle_sleep_mode still caps the deepest state that is entered.
+ */
+static const struct {
+	int mode;
+	const char *name;
+	const char *desc;
+} msm_cpuidle_modes[] = {
+	{ MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT, "wfi",
+		"wait for interrupt" },
+	{ MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT, "ramp_down",
+		"ramp down and wfi" },
+	{ MSM_PM_SLEEP_MODE_POWER_COLLAPSE_STANDALONE, "standalone_pc",
+		"standalone power collapse" },
+	{ MSM_PM_SLEEP_MODE_APPS_SLEEP, "apps_sleep",
+		"apps sleep" },
+	{ MSM_PM_SLEEP_MODE_POWER_COLLAPSE, "pc",
+		"power collapse" },
+};
+
+static struct cpuidle_driver msm_cpuidle_driver = {
+	.name = "msm_idle",
+	.owner = THIS_MODULE,
+};
+
+static DEFINE_PER_CPU(struct cpuidle_device, msm_cpuidle_devs);
+
+/*
+ * Position of @mode in msm_cpuidle_modes[], i.e. how deep it is.  Suspend
+ * power collapse ranks with power collapse, as in msm_pm_idle().
+ */
+static int msm_cpuidle_depth(int mode)
+{
+	int i;
+
+	if (mode == MSM_PM_SLEEP_MODE_POWER_COLLAPSE_SUSPEND)
+		mode = MSM_PM_SLEEP_MODE_POWER_COLLAPSE;
+	for (i = 0; i < ARRAY_SIZE(msm_cpuidle_modes); i++)
+		if (msm_cpuidle_modes[i].mode == mode)
+			return i;
+	return -1;
+}
+
+static struct cpuidle_state *msm_cpuidle_find_state(
+	struct cpuidle_device *dev, int mode)
+{
+	int i;
+
+	for (i = 0; i < dev->state_count; i++)
+		if ((int)cpuidle_get_statedata(&dev->states[i]) == mode)
+			return &dev->states[i];
+	return NULL;
+}
+
+static int msm_cpuidle_enter(struct cpuidle_device *dev,
+			     struct cpuidle_state *state)
+{
+	ktime_t start;
+	int mode;
+	int cap;
+
+	/*
+	 * Step down to the deepest registered state allowed by
+	 * idle_sleep_mode, which need not have a state of its own.  The
+	 * shallowest state is always allowed.
+	 */
+	cap = msm_cpuidle_depth(msm_pm_idle_sleep_mode);
+	while (state > &dev->states[0] &&
+	       msm_cpuidle_depth((int)cpuidle_get_statedata(state)) > cap)
+		state--;
+
+	start = ktime_get();
+	mode = msm_pm_idle((int)cpuidle_get_statedata(state));
+
+	/*
+	 * msm_pm_idle() falls back to a shallower mode when a wakelock,
+	 * a pending interrupt or the next timer rules out the chosen one;
+	 * account the period to the mode really entered.
+	 */
+	dev->last_state = msm_cpuidle_find_state(dev, mode) ? : state;
+
+	local_irq_enable();
+	return (int)ktime_to_us(ktime_sub(ktime_get(), start));
+}
+
+static int __init msm_cpuidle_init(void)
+{
+	struct cpuidle_device *dev;
+	int cpu;
+	int i;
+	int ret;
+
+	ret = cpuidle_register_driver(&msm_cpuidle_driver);
+	if (ret)
+		return ret;
+
+	for_each_possible_cpu(cpu) {
+		dev = &per_cpu(msm_cpuidle_devs, cpu);
+		dev->cpu = cpu;
+		dev->state_count = 0;
+
+		for (i = 0; i < ARRAY_SIZE(msm_cpuidle_modes); i++) {
+			int mode = msm_cpuidle_modes[i].mode;
+			struct msm_pm_platform_data *pm_mode =
+				&msm_pm_modes[mode];
+			struct cpuidle_state *state =
+				&dev->states[dev->state_count];
+
+			if (!pm_mode->supported || !pm_mode->idle_enabled)
+				continue;
+
+			strlcpy(state->name, msm_cpuidle_modes[i].name,
+				CPUIDLE_NAME_LEN);
+			strlcpy(state->desc, msm_cpuidle_modes[i].desc,
+				CPUIDLE_DESC_LEN);
+			state->exit_latency = pm_mode->latency;
+			state->target_residency = pm_mode->residency;
+			state->flags = CPUIDLE_FLAG_TIME_VALID;
+			state->enter = msm_cpuidle_enter;
+			cpuidle_set_statedata(state, (void *)mode);
+			dev->state_count++;
+		}
+
+		ret = cpuidle_register_device(dev);
+		if (ret) {
+			pr_err("%s: failed to register cpuidle device for "
+				"cpu %d: %d\n", __func__, cpu, ret);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+#endif
+
 static int msm_pm_enter(suspend_state_t state)
 {
 	msm_sleep(msm_pm_sleep_mode, msm_pm_max_sleep_time, 0);
@@ -1140,6 +1300,10 @@ static int __init msm_pm_init(void)
 #endif
 
 	boot_lock_nohalt();
+#ifdef CONFIG_CPU_IDLE
+	if (msm_cpuidle_init())
+		pr_err("%s: cpuidle unavailable, using arch_idle\n", __func__);
+#endif
 	return 0;
 }
 
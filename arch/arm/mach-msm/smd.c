@@ -185,7 +185,8 @@ static int check_for_modem_crash(void)
 
 /* the spinlock is used to synchronize between the
  * irq handler and code that mutates the channel
- * list or fiddles with channel state
+ * lists; channel state and fifos are covered by
+ * each channel's own lock
  */
 DEFINE_SPINLOCK(smd_lock);
 DEFINE_SPINLOCK(smem_lock);
@@ -243,6 +244,7 @@ struct smd_channel {
 	unsigned n;
 
 	struct list_head ch_list;
+	spinlock_t lock;
 
 	void *priv;
 	void (*notify)(void *priv, unsigned flags);
@@ -265,6 +267,22 @@ LIST_HEAD(smd_ch_closed_list);
 LIST_HEAD(smd_ch_list_modem);
 LIST_HEAD(smd_ch_list_dsp);
 
+/* channels are never freed once allocated, so the irq
+ * handlers can find a signalled channel by its cid
+ */
+#define SMD_CHANNELS		64
+#define SMD_LOOPBACK_CID	SMD_CHANNELS
+#define SMD_CH_TABLE_SIZE	(SMD_CHANNELS + 2)
+
+static struct smd_channel *smd_ch_table[SMD_CH_TABLE_SIZE];
+static DECLARE_BITMAP(smd_modem_pending, SMD_CH_TABLE_SIZE);
+static DECLARE_BITMAP(smd_dsp_pending, SMD_CH_TABLE_SIZE);
+
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+static LIST_HEAD(smd_ch_list_loopback);
+static DECLARE_BITMAP(smd_loopback_pending, SMD_CH_TABLE_SIZE);
+#endif
+
 static unsigned char smd_ch_allocated[64];
 static struct work_struct probe_work;
 
@@ -513,13 +531,70 @@ static void smd_state_change(struct smd_channel *ch,
 		break;
 	}
 }
-static void handle_smd_irq(struct list_head *list, void (*notify)(void))
+
+static unsigned long *smd_ch_pending(struct smd_channel *ch)
+{
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+	if (ch->type == SMD_TYPE_LOOPBACK)
+		return smd_loopback_pending;
+#endif
+	if (ch->type == SMD_TYPE_APPS_MODEM)
+		return smd_modem_pending;
+	return smd_dsp_pending;
+}
+
+static inline int smd_ch_signalled(struct smd_channel *ch)
+{
+	if (ch->recv->state != ch->last_state)
+		return 1;
+	if (ch_is_open(ch))
+		return ch->recv->fHEAD || ch->recv->fTAIL || ch->recv->fSTATE;
+	return 0;
+}
+
+/* Called with the channel lock held. Returns non-zero if the
+ * remote side should be interrupted.
+ */
+static int handle_smd_ch(struct smd_channel *ch)
+{
+	unsigned ch_flags = 0;
+	unsigned tmp;
+
+	if (ch_is_open(ch)) {
+		if (ch->recv->fHEAD) {
+			ch->recv->fHEAD = 0;
+			ch_flags |= 1;
+		}
+		if (ch->recv->fTAIL) {
+			ch->recv->fTAIL = 0;
+			ch_flags |= 2;
+		}
+		if (ch->recv->fSTATE) {
+			ch->recv->fSTATE = 0;
+			ch_flags |= 4;
+		}
+	}
+	tmp = ch->recv->state;
+	if (tmp != ch->last_state && ch->type != SMD_TYPE_LOOPBACK)
+		smd_state_change(ch, ch->last_state, tmp);
+	if (ch_flags) {
+		ch->update_state(ch);
+		ch->notify(ch->priv, SMD_EVENT_DATA);
+	}
+	return ch_flags;
+}
+
+/* Marks the signalled channels of an edge under smd_lock, then
+ * services each of them under its own lock only, so the notify
+ * callbacks of one channel do not hold off the others.
+ */
+static void handle_smd_irq(struct list_head *list, unsigned long *pending,
+			   void (*notify)(void))
 {
 	unsigned long flags;
 	struct smd_channel *ch;
 	int do_notify = 0;
-	unsigned ch_flags;
-	unsigned tmp;
+	unsigned n;
 #ifdef CONFIG_BUILD_CIQ
 	/* put here to make sure we got the disable/enable index */
 	if (!msm_smd_ciq_info)
@@ -527,60 +602,68 @@ static void handle_smd_irq(struct list_head *list, void (*notify)(void))
 #endif
 	spin_lock_irqsave(&smd_lock, flags);
 	list_for_each_entry(ch, list, ch_list) {
-		ch_flags = 0;
-		if (ch_is_open(ch)) {
-			if (ch->recv->fHEAD) {
-				ch->recv->fHEAD = 0;
-				ch_flags |= 1;
-				do_notify |= 1;
-			}
-			if (ch->recv->fTAIL) {
-				ch->recv->fTAIL = 0;
-				ch_flags |= 2;
-				do_notify |= 1;
-			}
-			if (ch->recv->fSTATE) {
-				ch->recv->fSTATE = 0;
-				ch_flags |= 4;
-				do_notify |= 1;
-			}
-		}
-		tmp = ch->recv->state;
-		if (tmp != ch->last_state)
-			smd_state_change(ch, ch->last_state, tmp);
-		if (ch_flags) {
-			ch->update_state(ch);
-			ch->notify(ch->priv, SMD_EVENT_DATA);
-		}
+		if (smd_ch_signalled(ch))
+			set_bit(ch->n, pending);
 	}
+	spin_unlock_irqrestore(&smd_lock, flags);
+
+	for_each_set_bit(n, pending, SMD_CH_TABLE_SIZE) {
+		ch = smd_ch_table[n];
+		spin_lock_irqsave(&ch->lock, flags);
+		/* smd_close() clears the bit of a channel it takes away */
+		if (test_and_clear_bit(n, pending))
+			do_notify |= handle_smd_ch(ch);
+		spin_unlock_irqrestore(&ch->lock, flags);
+	}
+
 	if (do_notify)
 		notify();
-	spin_unlock_irqrestore(&smd_lock, flags);
 	do_smd_probe();
 }
 
 static irqreturn_t smd_modem_irq_handler(int irq, void *data)
 {
-	handle_smd_irq(&smd_ch_list_modem, notify_modem_smd);
+	handle_smd_irq(&smd_ch_list_modem, smd_modem_pending,
+		       notify_modem_smd);
 	return IRQ_HANDLED;
 }
 
 #if defined(CONFIG_QDSP6)
 static irqreturn_t smd_dsp_irq_handler(int irq, void *data)
 {
-	handle_smd_irq(&smd_ch_list_dsp, notify_dsp_smd);
+	handle_smd_irq(&smd_ch_list_dsp, smd_dsp_pending, notify_dsp_smd);
 	return IRQ_HANDLED;
 }
 #endif
 
 static void smd_fake_irq_handler(unsigned long arg)
 {
-	handle_smd_irq(&smd_ch_list_modem, notify_modem_smd);
-	handle_smd_irq(&smd_ch_list_dsp, notify_dsp_smd);
+	handle_smd_irq(&smd_ch_list_modem, smd_modem_pending,
+		       notify_modem_smd);
+	handle_smd_irq(&smd_ch_list_dsp, smd_dsp_pending, notify_dsp_smd);
 }
 
 static DECLARE_TASKLET(smd_fake_irq_tasklet, smd_fake_irq_handler, 0);
 
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+/* The two loopback endpoints share a kernel buffer instead of
+ * shared memory, and a tasklet stands in for the remote interrupt.
+ */
+static void smd_loopback_irq_handler(unsigned long arg);
+static DECLARE_TASKLET(smd_loopback_tasklet, smd_loopback_irq_handler, 0);
+
+static void notify_loopback_smd(void)
+{
+	tasklet_schedule(&smd_loopback_tasklet);
+}
+
+static void smd_loopback_irq_handler(unsigned long arg)
+{
+	handle_smd_irq(&smd_ch_list_loopback, smd_loopback_pending,
+		       notify_loopback_smd);
+}
+#endif
+
 static inline int smd_need_int(struct smd_channel *ch)
 {
 	if (ch_is_open(ch)) {
@@ -627,7 +710,7 @@ void smd_kick(smd_channel_t *ch)
 	unsigned long flags;
 	unsigned tmp;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	spin_lock_irqsave(&ch->lock, flags);
 	ch->update_state(ch);
 	tmp = ch->recv->state;
 	if (tmp != ch->last_state) {
@@ -639,7 +722,7 @@ void smd_kick(smd_channel_t *ch)
 	}
 	ch->notify(ch->priv, SMD_EVENT_DATA);
 	ch->notify_other_cpu();
-	spin_unlock_irqrestore(&smd_lock, flags);
+	spin_unlock_irqrestore(&ch->lock, flags);
 }
 
 static int smd_is_packet(int chn, unsigned type)
@@ -771,10 +854,10 @@ static int smd_packet_read(smd_channel_t *ch, void *data, int len)
 	if (r > 0)
 		ch->notify_other_cpu();
 
-	spin_lock_irqsave(&smd_lock, flags);
+	spin_lock_irqsave(&ch->lock, flags);
 	ch->current_packet -= r;
 	update_packet_state(ch);
-	spin_unlock_irqrestore(&smd_lock, flags);
+	spin_unlock_irqrestore(&ch->lock, flags);
 
 	return r;
 }
@@ -837,6 +920,13 @@ static unsigned smd_alloc_channel(const char *name, uint32_t cid, uint32_t type)
 		return -EAGAIN;
 	}
 	ch->n = cid;
+	spin_lock_init(&ch->lock);
+
+	if (cid >= SMD_CHANNELS) {
+		pr_err("[SMD]smd_alloc_channel() cid %d out of range\n", cid);
+		kfree(ch);
+		return -EINVAL;
+	}
 
 	if (smd_alloc_v2(ch) && smd_alloc_v1(ch)) {
 		kfree(ch);
@@ -879,6 +969,8 @@ static unsigned smd_alloc_channel(const char *name, uint32_t cid, uint32_t type)
 	pr_info("[SMD]smd_alloc_channel() cid=%02d size=%05d '%s'\n",
 		ch->n, ch->fifo_size, ch->name);
 
+	smd_ch_table[ch->n] = ch;
+
 	mutex_lock(&smd_creation_mutex);
 	list_add(&ch->ch_list, &smd_ch_closed_list);
 	mutex_unlock(&smd_creation_mutex);
@@ -887,6 +979,76 @@ static unsigned smd_alloc_channel(const char *name, uint32_t cid, uint32_t type)
 	return 0;
 }
 
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+static int smd_alloc_loopback_channel(const char *name, unsigned cid,
+		struct smd_half_channel *send, unsigned char *send_data,
+		struct smd_half_channel *recv, unsigned char *recv_data)
+{
+	struct smd_channel *ch;
+
+	ch = kzalloc(sizeof(struct smd_channel), GFP_KERNEL);
+	if (ch == 0) {
+		pr_err("[SMD]smd_alloc_loopback_channel() out of memory\n");
+		return -ENOMEM;
+	}
+	ch->n = cid;
+	spin_lock_init(&ch->lock);
+
+	ch->send = send;
+	ch->recv = recv;
+	ch->send_data = send_data;
+	ch->recv_data = recv_data;
+	ch->fifo_size = SMD_BUF_SIZE;
+	ch->fifo_mask = ch->fifo_size - 1;
+	ch->type = SMD_TYPE_LOOPBACK;
+	ch->notify_other_cpu = notify_loopback_smd;
+
+	ch->read = smd_stream_read;
+	ch->write = smd_stream_write;
+	ch->read_avail = smd_stream_read_avail;
+	ch->write_avail = smd_stream_write_avail;
+	ch->update_state = update_stream_state;
+
+	strlcpy(ch->name, name, sizeof(ch->name));
+	ch->pdev.name = ch->name;
+	ch->pdev.id = ch->type;
+
+	pr_info("[SMD]smd_alloc_loopback_channel() cid=%02d size=%05d '%s'\n",
+		ch->n, ch->fifo_size, ch->name);
+
+	smd_ch_table[ch->n] = ch;
+
+	mutex_lock(&smd_creation_mutex);
+	list_add(&ch->ch_list, &smd_ch_closed_list);
+	mutex_unlock(&smd_creation_mutex);
+
+	platform_device_register(&ch->pdev);
+	return 0;
+}
+
+/* LOOPBACK_A and LOOPBACK_B are the two ends of one stream channel
+ * living in kernel memory, for benchmarking the SMD core without a
+ * remote processor.
+ */
+static void smd_alloc_loopback_channels(void)
+{
+	struct smd_shared_v1 *shared;
+
+	shared = kzalloc(sizeof(*shared), GFP_KERNEL);
+	if (!shared) {
+		pr_err("[SMD]smd_alloc_loopback_channels() out of memory\n");
+		return;
+	}
+
+	smd_alloc_loopback_channel("LOOPBACK_A", SMD_LOOPBACK_CID,
+				   &shared->ch0, shared->data0,
+				   &shared->ch1, shared->data1);
+	smd_alloc_loopback_channel("LOOPBACK_B", SMD_LOOPBACK_CID + 1,
+				   &shared->ch1, shared->data1,
+				   &shared->ch0, shared->data0);
+}
+#endif
+
 static void do_nothing_notify(void *priv, unsigned flags)
 {
 }
@@ -935,15 +1097,29 @@ int smd_open(const char *name, smd_channel_t **_ch,
 
 	*_ch = ch;
 
-	spin_lock_irqsave(&smd_lock, flags);
+	spin_lock_irqsave(&ch->lock, flags);
+	if (ch->type == SMD_TYPE_LOOPBACK) {
+		/* there is no remote side to go through the handshake */
+		ch->last_state = SMD_SS_OPENED;
+		ch->send->fDSR = 1;
+		ch->send->fCTS = 1;
+		ch->send->fCD = 1;
+		ch->send->state = SMD_SS_OPENED;
+	} else {
+		smd_state_change(ch, ch->last_state, SMD_SS_OPENING);
+	}
+	spin_unlock_irqrestore(&ch->lock, flags);
 
+	spin_lock_irqsave(&smd_lock, flags);
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+	if (ch->type == SMD_TYPE_LOOPBACK)
+		list_add(&ch->ch_list, &smd_ch_list_loopback);
+	else
+#endif
 	if (ch->type == SMD_APPS_MODEM)
 		list_add(&ch->ch_list, &smd_ch_list_modem);
 	else
 		list_add(&ch->ch_list, &smd_ch_list_dsp);
-
-	smd_state_change(ch, ch->last_state, SMD_SS_OPENING);
-
 	spin_unlock_irqrestore(&smd_lock, flags);
 
 	return 0;
@@ -962,11 +1138,15 @@ int smd_close(smd_channel_t *ch)
 	ch->recv->tail = 0;
 
 	spin_lock_irqsave(&smd_lock, flags);
-	ch->notify = do_nothing_notify;
 	list_del(&ch->ch_list);
-	ch_set_state(ch, SMD_SS_CLOSED);
 	spin_unlock_irqrestore(&smd_lock, flags);
 
+	spin_lock_irqsave(&ch->lock, flags);
+	ch->notify = do_nothing_notify;
+	clear_bit(ch->n, smd_ch_pending(ch));
+	ch_set_state(ch, SMD_SS_CLOSED);
+	spin_unlock_irqrestore(&ch->lock, flags);
+
 	mutex_lock(&smd_creation_mutex);
 	list_add(&ch->ch_list, &smd_ch_closed_list);
 	mutex_unlock(&smd_creation_mutex);
@@ -988,9 +1168,9 @@ int smd_write_atomic(smd_channel_t *ch, const void *data, int len)
 {
 	unsigned long flags;
 	int res;
-	spin_lock_irqsave(&smd_lock, flags);
+	spin_lock_irqsave(&ch->lock, flags);
 	res = ch->write(ch, data, len);
-	spin_unlock_irqrestore(&smd_lock, flags);
+	spin_unlock_irqrestore(&ch->lock, flags);
 	if(fifo_almost_full == 1) {
 		if(dbg_condition(ch->name))
 			printk("[SMD][dzt] %s: res=%d\n", __FUNCTION__, res);
@@ -1296,6 +1476,10 @@ static int msm_smd_probe(struct platform_device *pdev)
 
 	do_smd_probe();
 
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+	smd_alloc_loopback_channels();
+#endif
+
 	msm_check_for_modem_crash = check_for_modem_crash;
 
 	msm_init_last_radio_log(THIS_MODULE);
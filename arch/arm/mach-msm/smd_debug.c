@@ -20,8 +20,13 @@
 #include <linux/earlysuspend.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
+#include <linux/completion.h>
+#include <linux/ktime.h>
 
 #include <mach/msm_iomap.h>
+#include <mach/msm_smd.h>
+
+#include <asm/div64.h>
 
 #include "smd_private.h"
 #include "smd_debug.h"
@@ -378,6 +383,80 @@ static int debug_read_alloc_tbl(char *buf, int max)
 	return i;
 }
 
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+#define LOOPBACK_MSG_SIZE	512
+#define LOOPBACK_MSGS		2048
+
+static char loopback_msg[LOOPBACK_MSG_SIZE];
+
+static void debug_loopback_notify(void *priv, unsigned event)
+{
+	if (event == SMD_EVENT_DATA)
+		complete(priv);
+}
+
+/* Sends messages from LOOPBACK_A to LOOPBACK_B one at a time and
+ * reports the throughput and the write to read latency.
+ */
+static int debug_read_loopback(char *buf, int max)
+{
+	struct completion rx;
+	smd_channel_t *a, *b;
+	ktime_t start, sent;
+	u64 total_ns, lat_ns, lat_sum = 0, lat_max = 0, rate;
+	int i, r = 0;
+
+	init_completion(&rx);
+	if (smd_open("LOOPBACK_A", &a, NULL, NULL))
+		return scnprintf(buf, max, "LOOPBACK_A not available\n");
+	if (smd_open("LOOPBACK_B", &b, &rx, debug_loopback_notify)) {
+		smd_close(a);
+		return scnprintf(buf, max, "LOOPBACK_B not available\n");
+	}
+
+	start = ktime_get();
+	for (i = 0; i < LOOPBACK_MSGS; i++) {
+		sent = ktime_get();
+		if (smd_write(a, loopback_msg, LOOPBACK_MSG_SIZE) !=
+		    LOOPBACK_MSG_SIZE) {
+			r = -EIO;
+			break;
+		}
+		while (smd_read_avail(b) < LOOPBACK_MSG_SIZE) {
+			if (!wait_for_completion_timeout(&rx, HZ)) {
+				r = -ETIMEDOUT;
+				break;
+			}
+		}
+		if (r)
+			break;
+		smd_read(b, loopback_msg, LOOPBACK_MSG_SIZE);
+
+		lat_ns = ktime_to_ns(ktime_sub(ktime_get(), sent));
+		lat_sum += lat_ns;
+		if (lat_ns > lat_max)
+			lat_max = lat_ns;
+	}
+	total_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	smd_close(b);
+	smd_close(a);
+
+	if (r)
+		return scnprintf(buf, max, "failed at message %d: %d\n",
+				 i, r);
+
+	rate = (u64)LOOPBACK_MSGS * LOOPBACK_MSG_SIZE * 1000000;
+	do_div(rate, 1 + (u32)(total_ns >> 10));
+	do_div(lat_sum, LOOPBACK_MSGS);
+
+	return scnprintf(buf, max,
+			 "%d x %d bytes: %llu KB/s, latency avg %llu ns "
+			 "max %llu ns\n", LOOPBACK_MSGS, LOOPBACK_MSG_SIZE,
+			 rate >> 10, lat_sum, lat_max);
+}
+#endif
+
 #define DEBUG_BUFMAX 4096
 static char debug_buffer[DEBUG_BUFMAX];
 
@@ -532,6 +611,9 @@ static int __init smd_debugfs_init(void)
 	debug_create("version", 0444, dent, debug_read_version);
 	debug_create("tbl", 0444, dent, debug_read_alloc_tbl);
 	debug_create("build", 0444, dent, debug_read_build_id);
+#ifdef CONFIG_MSM_SMD_LOOPBACK
+	debug_create("loopback", 0400, dent, debug_read_loopback);
+#endif
 #if CONFIG_SMD_OFFSET_TCXO_STAT
 	sleep_stat = get_smem_sleep_stat();
 	negate_client_stat = get_smem_negate_client_stat();
@@ -65,6 +65,7 @@ struct smd_channel {
 	unsigned n;
 
 	struct list_head ch_list;
+	spinlock_t lock;
 
 	void *priv;
 	void (*notify)(void *priv, unsigned flags);
@@ -302,6 +302,7 @@ typedef enum {
 #define SMD_TYPE_APPS_MODEM	0x000
 #define SMD_TYPE_APPS_DSP	0x001
 #define SMD_TYPE_MODEM_DSP	0x002
+#define SMD_TYPE_LOOPBACK	0x0FF
 
 #define SMD_KIND_MASK		0xF00
 #define SMD_KIND_UNKNOWN	0x000
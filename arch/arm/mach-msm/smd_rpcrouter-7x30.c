@@ -18,7 +18,6 @@
 /* TODO: handle cases where smd_write() will tempfail due to full fifo */
 /* TODO: thread priority? schedule a work to bump it? */
 /* TODO: maybe make server_list_lock a mutex */
-/* TODO: pool fragments to avoid kmalloc/kfree churn */
 
 #include <linux/module.h>
 #include <linux/kernel.h>
@@ -39,6 +38,12 @@
 #include <linux/platform_device.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
+#include <linux/mempool.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
 
 #include <asm/byteorder.h>
 #include <mach/smem_log.h>
@@ -131,6 +136,13 @@ if (smd_rpcrouter_debug_mask & NTFY_MSG) \
 static LIST_HEAD(local_endpoints);
 static LIST_HEAD(remote_endpoints);
 
+/* Endpoint lookups on the receive and write paths go through these;
+ * the lists above are kept for the walks done on server restart.
+ */
+#define RR_EPT_HASH_BITS	5
+static struct hlist_head local_endpoints_hash[1 << RR_EPT_HASH_BITS];
+static struct hlist_head remote_endpoints_hash[1 << RR_EPT_HASH_BITS];
+
 static LIST_HEAD(server_list);
 
 static smd_channel_t *smd_channel;
@@ -148,6 +160,48 @@ static struct workqueue_struct *rpcrouter_workqueue;
 static struct wake_lock rpcrouter_wake_lock;
 static int rpcrouter_need_len;
 
+/* Fragments and packet headers come from reserved pools so the read
+ * worker never has to spin on kmalloc.  Fragment pool elements are
+ * plain kmalloc'd buffers, because msm_rpc_read() hands single fragment
+ * messages to its callers, who release them with kfree().
+ */
+#define RR_POOL_MIN	8
+
+static mempool_t *rr_frag_pool;
+static mempool_t *rr_packet_pool;
+static struct kmem_cache *rr_packet_cache;
+
+static struct {
+	atomic_t messages;
+	atomic_t fragments;
+	atomic_t dropped;
+	atomic_t smd_bytes;	/* copied out of the SMD fifo */
+	atomic_t copy_bytes;	/* copied again to reassemble messages */
+} rr_rx_stats;
+
+struct rr_reply_waiter {
+	struct hlist_node node;
+	uint32_t xid; /* be32 */
+	struct rr_packet *pkt;
+	wait_queue_head_t wait;
+};
+
+/* msm_rpc_call_reply() latency, per remote program.  Bucket 0 counts
+ * calls under 1us, bucket n those of at least 2^(n-1) us.
+ */
+#define RR_CALL_STATS_BITS	5
+#define RR_CALL_LAT_BUCKETS	16
+
+struct rr_call_stats {
+	uint32_t prog;
+	unsigned count;
+	unsigned max_us;
+	unsigned hist[RR_CALL_LAT_BUCKETS];
+};
+
+static struct rr_call_stats rr_call_stats[1 << RR_CALL_STATS_BITS];
+static DEFINE_SPINLOCK(rr_call_stats_lock);
+
 static atomic_t next_xid = ATOMIC_INIT(1);
 static atomic_t pm_mid = ATOMIC_INIT(1);
 
@@ -363,6 +417,8 @@ struct msm_rpc_endpoint *msm_rpcrouter_create_local_endpoint(dev_t dev)
 
 	spin_lock_irqsave(&local_endpoints_lock, flags);
 	list_add_tail(&ept->list, &local_endpoints);
+	hlist_add_head(&ept->hash, &local_endpoints_hash[
+			       hash_32(ept->cid, RR_EPT_HASH_BITS)]);
 	spin_unlock_irqrestore(&local_endpoints_lock, flags);
 	return ept;
 }
@@ -397,7 +453,10 @@ int msm_rpcrouter_destroy_local_endpoint(struct msm_rpc_endpoint *ept)
 
 	wake_lock_destroy(&ept->read_q_wake_lock);
 	wake_lock_destroy(&ept->reply_q_wake_lock);
+	spin_lock_irqsave(&local_endpoints_lock, flags);
 	list_del(&ept->list);
+	hlist_del(&ept->hash);
+	spin_unlock_irqrestore(&local_endpoints_lock, flags);
 	kfree(ept);
 	return 0;
 }
@@ -419,6 +478,8 @@ static int rpcrouter_create_remote_endpoint(uint32_t pid, uint32_t cid)
 
 	spin_lock_irqsave(&remote_endpoints_lock, flags);
 	list_add_tail(&new_c->list, &remote_endpoints);
+	hlist_add_head(&new_c->hash, &remote_endpoints_hash[
+			       hash_32(pid ^ cid, RR_EPT_HASH_BITS)]);
 	new_c->quota_restart_state = RESTART_NORMAL;
 	spin_unlock_irqrestore(&remote_endpoints_lock, flags);
 	return 0;
@@ -427,10 +488,12 @@ static int rpcrouter_create_remote_endpoint(uint32_t pid, uint32_t cid)
 static struct msm_rpc_endpoint *rpcrouter_lookup_local_endpoint(uint32_t cid)
 {
 	struct msm_rpc_endpoint *ept;
+	struct hlist_node *n;
 	unsigned long flags;
 
 	spin_lock_irqsave(&local_endpoints_lock, flags);
-	list_for_each_entry(ept, &local_endpoints, list) {
+	hlist_for_each_entry(ept, n, &local_endpoints_hash[
+				     hash_32(cid, RR_EPT_HASH_BITS)], hash) {
 		if (ept->cid == cid) {
 			spin_unlock_irqrestore(&local_endpoints_lock, flags);
 			return ept;
@@ -444,10 +507,12 @@ static struct rr_remote_endpoint *rpcrouter_lookup_remote_endpoint(uint32_t pid,
 								   uint32_t cid)
 {
 	struct rr_remote_endpoint *ept;
+	struct hlist_node *n;
 	unsigned long flags;
 
 	spin_lock_irqsave(&remote_endpoints_lock, flags);
-	list_for_each_entry(ept, &remote_endpoints, list) {
+	hlist_for_each_entry(ept, n, &remote_endpoints_hash[
+				     hash_32(pid ^ cid, RR_EPT_HASH_BITS)], hash) {
 		if ((ept->pid == pid) && (ept->cid == cid)) {
 			spin_unlock_irqrestore(&remote_endpoints_lock, flags);
 			return ept;
@@ -627,6 +692,7 @@ static int process_control_msg(union rr_control_msg *msg, int len)
 		if (r_ept) {
 			spin_lock_irqsave(&remote_endpoints_lock, flags);
 			list_del(&r_ept->list);
+			hlist_del(&r_ept->hash);
 			spin_unlock_irqrestore(&remote_endpoints_lock, flags);
 			kfree(r_ept);
 		}
@@ -698,6 +764,16 @@ static void *rr_malloc(unsigned sz)
 	return ptr;
 }
 
+static struct rr_fragment *rr_alloc_frag(void)
+{
+	return mempool_alloc(rr_frag_pool, GFP_KERNEL);
+}
+
+void msm_rpcrouter_free_frag(struct rr_fragment *frag)
+{
+	mempool_free(frag, rr_frag_pool);
+}
+
 /* TODO: deal with channel teardown / restore */
 static int rr_read(void *data, int len)
 {
@@ -754,6 +830,38 @@ static char *type_to_str(int i)
 
 static uint32_t r2r_buf[RPCROUTER_MSGSIZE_MAX];
 
+static inline struct hlist_head *rr_reply_waiters(
+	struct msm_rpc_endpoint *ept, uint32_t xid)
+{
+	return &ept->reply_waiters[hash_32(xid, RPCROUTER_XID_HASH_BITS)];
+}
+
+/* Hand a reply straight to the msm_rpc_call_reply() caller waiting
+ * for its xid, so it is the only task woken.  Call with read_q_lock.
+ */
+static int rr_deliver_reply(struct msm_rpc_endpoint *ept,
+			    struct rr_packet *pkt)
+{
+	struct rpc_reply_hdr *reply = (void *) pkt->first->data;
+	struct rr_reply_waiter *waiter;
+	struct hlist_node *n;
+
+	if (pkt->length < (3 * sizeof(uint32_t)) || reply->type == 0)
+		return 0;
+
+	hlist_for_each_entry(waiter, n, rr_reply_waiters(ept, reply->xid),
+			     node) {
+		if (waiter->xid == reply->xid) {
+			hlist_del_init(&waiter->node);
+			waiter->pkt = pkt;
+			ept->replies_delivered++;
+			wake_up(&waiter->wait);
+			return 1;
+		}
+	}
+	return 0;
+}
+
 static void do_read_data(struct work_struct *work)
 {
 	struct rr_header hdr;
@@ -803,11 +911,27 @@ static void do_read_data(struct work_struct *work)
 
 	hdr.size -= sizeof(pm);
 
-	frag = rr_malloc(hdr.size + sizeof(*frag));
+	/* Find the destination before allocating anything, so messages
+	 * for closed endpoints are drained without touching the pool and
+	 * everything else is read once, straight into the fragment that
+	 * gets queued on the endpoint.
+	 */
+	ept = rpcrouter_lookup_local_endpoint(hdr.dst_cid);
+	if (!ept) {
+		DIAG("no local ept for cid %08x\n", hdr.dst_cid);
+		if (rr_read(r2r_buf, hdr.size))
+			goto fail_io;
+		atomic_inc(&rr_rx_stats.dropped);
+		goto done;
+	}
+
+	frag = rr_alloc_frag();
 	frag->next = NULL;
 	frag->length = hdr.size;
 	if (rr_read(frag->data, hdr.size))
 		goto fail_io;
+	atomic_inc(&rr_rx_stats.fragments);
+	atomic_add(hdr.size, &rr_rx_stats.smd_bytes);
 
 #if defined(CONFIG_MSM_ONCRPCROUTER_DEBUG)
 	if ((smd_rpcrouter_debug_mask & RAW_PMR) &&
@@ -844,13 +968,6 @@ static void do_read_data(struct work_struct *work)
 	}
 #endif
 
-	ept = rpcrouter_lookup_local_endpoint(hdr.dst_cid);
-	if (!ept) {
-		DIAG("no local ept for cid %08x\n", hdr.dst_cid);
-		kfree(frag);
-		goto done;
-	}
-
 	/* See if there is already a partial packet that matches our mid
 	 * and if so, append this fragment to that packet.
 	 */
@@ -876,7 +993,7 @@ static void do_read_data(struct work_struct *work)
 	 * the incomplete list if this fragment is not a last fragment,
 	 * otherwise put it on the read queue.
 	 */
-	pkt = rr_malloc(sizeof(struct rr_packet));
+	pkt = mempool_alloc(rr_packet_pool, GFP_KERNEL);
 	pkt->first = frag;
 	pkt->last = frag;
 	memcpy(&pkt->hdr, &hdr, sizeof(hdr));
@@ -888,11 +1005,14 @@ static void do_read_data(struct work_struct *work)
 	}
 
 packet_complete:
+	atomic_inc(&rr_rx_stats.messages);
 	spin_lock_irqsave(&ept->read_q_lock, flags);
 	D("%s: take read lock on ept %p\n", __func__, ept);
 	wake_lock(&ept->read_q_wake_lock);
-	list_add_tail(&pkt->list, &ept->read_q);
-	wake_up(&ept->wait_q);
+	if (!rr_deliver_reply(ept, pkt)) {
+		list_add_tail(&pkt->list, &ept->read_q);
+		wake_up(&ept->wait_q);
+	}
 	spin_unlock_irqrestore(&ept->read_q_lock, flags);
 done:
 
@@ -1372,42 +1492,41 @@ int msm_rpc_write(struct msm_rpc_endpoint *ept, void *buffer, int count)
 }
 EXPORT_SYMBOL(msm_rpc_write);
 
+static void *rr_frag_to_buffer(struct rr_fragment *frag, int len)
+{
+	struct rr_fragment *next;
+	char *buf, *ptr;
+
+	/* fragments belong to rr_frag_pool while callers kfree() what
+	 * they get back, so even single-fragment messages are copied
+	 */
+	buf = rr_malloc(len);
+	atomic_add(len, &rr_rx_stats.copy_bytes);
+
+	for (ptr = buf; frag != NULL; frag = next) {
+		memcpy(ptr, frag->data, frag->length);
+		next = frag->next;
+		ptr += frag->length;
+		msm_rpcrouter_free_frag(frag);
+	}
+
+	return buf;
+}
+
 /*
  * NOTE: It is the responsibility of the caller to kfree buffer
  */
 int msm_rpc_read(struct msm_rpc_endpoint *ept, void **buffer,
 		 unsigned user_len, long timeout)
 {
-	struct rr_fragment *frag, *next;
-	char *buf;
+	struct rr_fragment *frag;
 	int rc;
 
 	rc = __msm_rpc_read(ept, &frag, user_len, timeout);
 	if (rc <= 0)
 		return rc;
 
-	/* single-fragment messages conveniently can be
-	 * returned as-is (the buffer is at the front)
-	 */
-	if (frag->next == 0) {
-		*buffer = (void *) frag;
-		return rc;
-	}
-
-	/* multi-fragment messages, we have to do it the
-	 * hard way, which is rather disgusting right now
-	 */
-	buf = rr_malloc(rc);
-	*buffer = buf;
-
-	while (frag != NULL) {
-		memcpy(buf, frag->data, frag->length);
-		next = frag->next;
-		buf += frag->length;
-		kfree(frag);
-		frag = next;
-	}
-
+	*buffer = rr_frag_to_buffer(frag, rc);
 	return rc;
 }
 EXPORT_SYMBOL(msm_rpc_read);
@@ -1422,6 +1541,158 @@ int msm_rpc_call(struct msm_rpc_endpoint *ept, uint32_t proc,
 }
 EXPORT_SYMBOL(msm_rpc_call);
 
+static void rr_free_packet(struct rr_packet *pkt)
+{
+	struct rr_fragment *frag, *next;
+
+	for (frag = pkt->first; frag != NULL; frag = next) {
+		next = frag->next;
+		msm_rpcrouter_free_frag(frag);
+	}
+	mempool_free(pkt, rr_packet_pool);
+}
+
+static void rr_release_read_wake_lock(struct msm_rpc_endpoint *ept)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ept->read_q_lock, flags);
+	if (list_empty(&ept->read_q) && !ept->replies_delivered) {
+		D("%s: release read lock on ept %p\n", __func__, ept);
+		wake_unlock(&ept->read_q_wake_lock);
+	}
+	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+}
+
+/* Drop replies left on the read queue by calls that timed out.  Every
+ * reply to a live call is handed to its waiter by xid, so any reply
+ * still queued here is stale.  Requests and callbacks for the server
+ * side of the endpoint stay queued for msm_rpc_read().
+ */
+static void rr_flush_stale_replies(struct msm_rpc_endpoint *ept)
+{
+	struct rr_packet *pkt, *tmp;
+	struct rpc_reply_hdr *reply;
+	unsigned long flags;
+	LIST_HEAD(stale);
+
+	spin_lock_irqsave(&ept->read_q_lock, flags);
+	list_for_each_entry_safe(pkt, tmp, &ept->read_q, list) {
+		reply = (void *) pkt->first->data;
+		if (pkt->length < (3 * sizeof(uint32_t)) || reply->type == 0)
+			continue;
+		list_move_tail(&pkt->list, &stale);
+	}
+	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+
+	if (list_empty(&stale))
+		return;
+
+	list_for_each_entry_safe(pkt, tmp, &stale, list)
+		rr_free_packet(pkt);
+	rr_release_read_wake_lock(ept);
+}
+
+static void rr_add_reply_waiter(struct msm_rpc_endpoint *ept,
+				struct rr_reply_waiter *waiter, uint32_t xid)
+{
+	unsigned long flags;
+
+	waiter->xid = xid;
+	waiter->pkt = NULL;
+	init_waitqueue_head(&waiter->wait);
+
+	spin_lock_irqsave(&ept->read_q_lock, flags);
+	hlist_add_head(&waiter->node, rr_reply_waiters(ept, xid));
+	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+}
+
+/* Unhash the waiter, returning its reply if one was delivered. */
+static struct rr_packet *rr_take_reply(struct msm_rpc_endpoint *ept,
+				       struct rr_reply_waiter *waiter)
+{
+	struct rr_packet *pkt;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ept->read_q_lock, flags);
+	pkt = waiter->pkt;
+	if (pkt)
+		ept->replies_delivered--;
+	else
+		hlist_del(&waiter->node);
+	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+	return pkt;
+}
+
+static int rr_reply_arrived(struct msm_rpc_endpoint *ept,
+			    struct rr_reply_waiter *waiter)
+{
+	unsigned long flags;
+	int ret;
+
+	spin_lock_irqsave(&ept->read_q_lock, flags);
+	ret = waiter->pkt != NULL;
+	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+	return ret;
+}
+
+static struct rr_packet *rr_wait_reply(struct msm_rpc_endpoint *ept,
+				       struct rr_reply_waiter *waiter,
+				       long timeout)
+{
+	struct rr_packet *pkt;
+	long rc;
+
+	if (timeout < 0)
+		timeout = MAX_SCHEDULE_TIMEOUT;
+
+	if (ept->flags & MSM_RPC_UNINTERRUPTIBLE)
+		rc = wait_event_timeout(waiter->wait,
+					rr_reply_arrived(ept, waiter),
+					timeout);
+	else
+		rc = wait_event_interruptible_timeout(waiter->wait,
+					rr_reply_arrived(ept, waiter),
+					timeout);
+
+	pkt = rr_take_reply(ept, waiter);
+	if (pkt)
+		return pkt;
+	if (!msm_rpc_clear_netreset(ept))
+		return ERR_PTR(-ENETRESET);
+	if (rc < 0)
+		return ERR_PTR(rc);
+	return ERR_PTR(-ETIMEDOUT);
+}
+
+static void rr_account_call(uint32_t prog, ktime_t start)
+{
+	struct rr_call_stats *stats;
+	unsigned long flags;
+	unsigned us, bucket;
+	unsigned i, slot;
+
+	us = ktime_to_us(ktime_sub(ktime_get(), start));
+	bucket = us ? min(ilog2(us) + 1, RR_CALL_LAT_BUCKETS - 1) : 0;
+	slot = hash_32(prog, RR_CALL_STATS_BITS);
+
+	spin_lock_irqsave(&rr_call_stats_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(rr_call_stats); i++) {
+		stats = &rr_call_stats[(slot + i) &
+				       (ARRAY_SIZE(rr_call_stats) - 1)];
+		if (stats->count == 0)
+			stats->prog = prog;
+		if (stats->prog != prog)
+			continue;
+		stats->count++;
+		stats->hist[bucket]++;
+		if (us > stats->max_us)
+			stats->max_us = us;
+		break;
+	}
+	spin_unlock_irqrestore(&rr_call_stats_lock, flags);
+}
+
 int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
 		       void *_request, int request_size,
 		       void *_reply, int reply_size,
@@ -1429,6 +1700,9 @@ int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
 {
 	struct rpc_request_hdr *req = _request;
 	struct rpc_reply_hdr *reply;
+	struct rr_reply_waiter waiter;
+	struct rr_packet *pkt;
+	ktime_t start;
 	int rc;
 
 	if (request_size < sizeof(*req))
@@ -1444,50 +1718,46 @@ int msm_rpc_call_reply(struct msm_rpc_endpoint *ept, uint32_t proc,
 	req->vers = ept->dst_vers;
 	req->procedure = cpu_to_be32(proc);
 
-	rc = msm_rpc_write(ept, req, request_size);
-	if (rc < 0)
-		return rc;
+	/* The waiter is hashed before the call goes out, so the reply
+	 * is handed to us no matter how quickly it comes back.  A reply
+	 * arriving after we gave up lands on the read queue and is
+	 * dropped by the next call.
+	 */
+	rr_flush_stale_replies(ept);
+	rr_add_reply_waiter(ept, &waiter, req->xid);
 
-	for (;;) {
-		rc = msm_rpc_read(ept, (void *) &reply, -1, timeout);
-		if (rc < 0)
-			return rc;
-		if (rc < (3 * sizeof(uint32_t))) {
-			rc = -EIO;
-			break;
-		}
-		/* we should not get CALL packets -- ignore them */
-		if (reply->type == 0) {
-			kfree(reply);
-			continue;
-		}
-		/* If an earlier call timed out, we could get the (no
-		 * longer wanted) reply for it.  Ignore replies that
-		 * we don't expect.
-		 */
-		if (reply->xid != req->xid) {
-			kfree(reply);
-			continue;
-		}
-		if (reply->reply_stat != 0) {
-			rc = -EPERM;
-			break;
-		}
-		if (reply->data.acc_hdr.accept_stat != 0) {
-			rc = -EINVAL;
-			break;
-		}
-		if (_reply == NULL) {
-			rc = 0;
-			break;
-		}
-		if (rc > reply_size) {
-			rc = -ENOMEM;
-		} else {
-			memcpy(_reply, reply, rc);
+	start = ktime_get();
+	rc = msm_rpc_write(ept, req, request_size);
+	if (rc < 0) {
+		pkt = rr_take_reply(ept, &waiter);
+		if (pkt) {
+			rr_free_packet(pkt);
+			rr_release_read_wake_lock(ept);
 		}
-		break;
+		return rc;
 	}
+
+	pkt = rr_wait_reply(ept, &waiter, timeout);
+	if (IS_ERR(pkt))
+		return PTR_ERR(pkt);
+	rr_account_call(be32_to_cpu(ept->dst_prog), start);
+
+	rc = pkt->length;
+	reply = rr_frag_to_buffer(pkt->first, rc);
+	mempool_free(pkt, rr_packet_pool);
+	rr_release_read_wake_lock(ept);
+
+	if (reply->reply_stat != 0)
+		rc = -EPERM;
+	else if (reply->data.acc_hdr.accept_stat != 0)
+		rc = -EINVAL;
+	else if (_reply == NULL)
+		rc = 0;
+	else if (rc > reply_size)
+		rc = -ENOMEM;
+	else
+		memcpy(_reply, reply, rc);
+
 	kfree(reply);
 	return rc;
 }
@@ -1598,19 +1868,14 @@ int __msm_rpc_read(struct msm_rpc_endpoint *ept,
 		set_pend_reply(ept, reply);
 	}
 
-	kfree(pkt);
+	mempool_free(pkt, rr_packet_pool);
 
 		IO("READ on ept %p (%d bytes)\n", ept, rc);
 
  read_release_lock:
 
 	/* release read wakelock after taking reply wakelock */
-	spin_lock_irqsave(&ept->read_q_lock, flags);
-	if (list_empty(&ept->read_q)) {
-		D("%s: release read lock on ept %p\n", __func__, ept);
-		wake_unlock(&ept->read_q_wake_lock);
-	}
-	spin_unlock_irqrestore(&ept->read_q_lock, flags);
+	rr_release_read_wake_lock(ept);
 
 	return rc;
 }
@@ -1814,6 +2079,114 @@ int msm_rpcrouter_close(void)
 	return smd_close(smd_channel);
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static int rr_rx_stats_show(struct seq_file *s, void *unused)
+{
+	unsigned messages = atomic_read(&rr_rx_stats.messages);
+	unsigned smd_bytes = atomic_read(&rr_rx_stats.smd_bytes);
+	unsigned copy_bytes = atomic_read(&rr_rx_stats.copy_bytes);
+
+	seq_printf(s, "messages:   %u\n", messages);
+	seq_printf(s, "fragments:  %u\n", atomic_read(&rr_rx_stats.fragments));
+	seq_printf(s, "dropped:    %u\n", atomic_read(&rr_rx_stats.dropped));
+	seq_printf(s, "smd bytes:  %u\n", smd_bytes);
+	seq_printf(s, "copy bytes: %u\n", copy_bytes);
+	if (messages)
+		seq_printf(s, "bytes copied per message: %u\n",
+			   (smd_bytes + copy_bytes) / messages);
+	return 0;
+}
+
+static int rr_rx_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rr_rx_stats_show, NULL);
+}
+
+static const struct file_operations rr_rx_stats_fops = {
+	.open		= rr_rx_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int rr_call_stats_show(struct seq_file *s, void *unused)
+{
+	struct rr_call_stats *stats;
+	unsigned long flags;
+	int i, n;
+
+	spin_lock_irqsave(&rr_call_stats_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(rr_call_stats); i++) {
+		stats = &rr_call_stats[i];
+		if (!stats->count)
+			continue;
+		seq_printf(s, "prog %08x: %u calls, max %uus\n",
+			   stats->prog, stats->count, stats->max_us);
+		for (n = 0; n < RR_CALL_LAT_BUCKETS; n++)
+			if (stats->hist[n])
+				seq_printf(s, "  >= %6uus: %u\n",
+					   n ? 1U << (n - 1) : 0,
+					   stats->hist[n]);
+	}
+	spin_unlock_irqrestore(&rr_call_stats_lock, flags);
+	return 0;
+}
+
+static int rr_call_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rr_call_stats_show, NULL);
+}
+
+static const struct file_operations rr_call_stats_fops = {
+	.open		= rr_call_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void rr_debugfs_init(void)
+{
+	debugfs_create_file("rpcrouter_rx_stats", S_IRUGO, NULL, NULL,
+			    &rr_rx_stats_fops);
+	debugfs_create_file("rpcrouter_call_latency", S_IRUGO, NULL, NULL,
+			    &rr_call_stats_fops);
+}
+#else
+static void rr_debugfs_init(void) {}
+#endif
+
+static int rr_create_pools(void)
+{
+	rr_frag_pool = mempool_create_kmalloc_pool(RR_POOL_MIN,
+						   sizeof(struct rr_fragment));
+	if (!rr_frag_pool)
+		return -ENOMEM;
+
+	rr_packet_cache = KMEM_CACHE(rr_packet, 0);
+	if (!rr_packet_cache)
+		goto fail_frag_pool;
+
+	rr_packet_pool = mempool_create_slab_pool(RR_POOL_MIN,
+						  rr_packet_cache);
+	if (!rr_packet_pool)
+		goto fail_packet_cache;
+
+	return 0;
+
+ fail_packet_cache:
+	kmem_cache_destroy(rr_packet_cache);
+ fail_frag_pool:
+	mempool_destroy(rr_frag_pool);
+	return -ENOMEM;
+}
+
+static void rr_destroy_pools(void)
+{
+	mempool_destroy(rr_packet_pool);
+	kmem_cache_destroy(rr_packet_cache);
+	mempool_destroy(rr_frag_pool);
+}
+
 static int msm_rpcrouter_probe(struct platform_device *pdev)
 {
 	int rc;
@@ -1826,9 +2199,15 @@ static int msm_rpcrouter_probe(struct platform_device *pdev)
 	init_waitqueue_head(&smd_wait);
 	wake_lock_init(&rpcrouter_wake_lock, WAKE_LOCK_SUSPEND, "SMD_RPCCALL");
 
+	rc = rr_create_pools();
+	if (rc < 0)
+		return rc;
+
 	rpcrouter_workqueue = create_singlethread_workqueue("rpcrouter");
-	if (!rpcrouter_workqueue)
-		return -ENOMEM;
+	if (!rpcrouter_workqueue) {
+		rc = -ENOMEM;
+		goto fail_destroy_pools;
+	}
 
 	rc = msm_rpcrouter_init_devices();
 	if (rc < 0)
@@ -1840,6 +2219,7 @@ static int msm_rpcrouter_probe(struct platform_device *pdev)
 	if (rc < 0)
 		goto fail_remove_devices;
 
+	rr_debugfs_init();
 	queue_work(rpcrouter_workqueue, &work_read_data);
 	return 0;
 
@@ -1847,6 +2227,8 @@ static int msm_rpcrouter_probe(struct platform_device *pdev)
 	msm_rpcrouter_exit_devices();
  fail_destroy_workqueue:
 	destroy_workqueue(rpcrouter_workqueue);
+ fail_destroy_pools:
+	rr_destroy_pools();
 	return rc;
 }
 
@@ -25,6 +25,7 @@
 #include <linux/types.h>
 #include <linux/list.h>
 #include <linux/cdev.h>
+#include <linux/slab.h>
 #include <linux/platform_device.h>
 #include <linux/wakelock.h>
 
@@ -150,6 +151,9 @@ struct rr_remote_endpoint {
 	wait_queue_head_t quota_wait;
 
 	struct list_head list;
+#if defined(CONFIG_ARCH_MSM7X30)
+	struct hlist_node hash;
+#endif
 };
 
 #if defined(CONFIG_ARCH_MSM7X30)
@@ -163,8 +167,15 @@ struct msm_rpc_reply {
 };
 #endif
 
+#if defined(CONFIG_ARCH_MSM7X30)
+#define RPCROUTER_XID_HASH_BITS		3
+#endif
+
 struct msm_rpc_endpoint {
 	struct list_head list;
+#if defined(CONFIG_ARCH_MSM7X30)
+	struct hlist_node hash;
+#endif
 
 	/* incomplete packets waiting for assembly */
 	struct list_head incomplete;
@@ -214,6 +225,13 @@ struct msm_rpc_endpoint {
 	spinlock_t reply_q_lock;
 	uint32_t reply_cnt;
 	struct wake_lock reply_q_wake_lock;
+
+	/* callers of msm_rpc_call_reply() waiting for their reply,
+	 * hashed by xid, and replies handed to them but not yet
+	 * consumed; both under read_q_lock
+	 */
+	struct hlist_head reply_waiters[1 << RPCROUTER_XID_HASH_BITS];
+	int replies_delivered;
 #endif
 	/* device node if this endpoint is accessed via userspace */
 	dev_t dev;
@@ -239,6 +257,12 @@ void msm_rpcrouter_exit_devices(void);
 void get_requesting_client(struct msm_rpc_endpoint *ept, uint32_t xid,
 			   struct msm_rpc_client_info *clnt_info);
 int msm_rpc_clear_netreset(struct msm_rpc_endpoint *ept);
+void msm_rpcrouter_free_frag(struct rr_fragment *frag);
+#else
+static inline void msm_rpcrouter_free_frag(struct rr_fragment *frag)
+{
+	kfree(frag);
+}
 #endif
 
 extern dev_t msm_rpcrouter_devno;
@@ -95,7 +95,7 @@ static ssize_t rpcrouter_read(struct file *filp, char __user *buf,
 		}
 		buf += frag->length;
 		next = frag->next;
-		kfree(frag);
+		msm_rpcrouter_free_frag(frag);
 		frag = next;
 	}
 
@@ -69,6 +69,9 @@
 #include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/percpu.h>
+#include <linux/timer.h>
 
 #include <mach/msm_iomap.h>
 #include <mach/smem_log.h>
@@ -1010,18 +1013,148 @@ static void smem_log_event_from_user(struct smem_log_inst *inst,
 	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
 }
 
+/* Copy n (1 or 2) items to the log at its current index, never
+ * splitting a pair across the end of the log.  Call with the log's
+ * remote spinlock held.
+ */
+static void _smem_log_put(struct smem_log_inst *inst,
+			  struct smem_log_item *item, int n)
+{
+	uint32_t idx;
+	uint32_t next_idx;
+
+	idx = *inst->idx;
+
+	if (idx <= inst->num - n) {
+		memcpy(&inst->events[idx],
+		       item, n * sizeof(*item));
+	}
+
+	next_idx = idx + n;
+	if (next_idx >= inst->num)
+		next_idx = 0;
+	*inst->idx = next_idx;
+}
+
+#if defined(CONFIG_MSM_SMEM_LOG_BATCH)
+/* Events for the general log are staged per cpu and copied to shared
+ * memory in batches, so the remote spinlock is taken once per batch
+ * rather than once per event.  Batches are flushed when full, by a
+ * deferrable timer, and before the log is read.
+ */
+#define SMEM_LOG_BATCH_SIZE 32
+#define SMEM_LOG_BATCH_DELAY (HZ / 10)
+
+struct smem_log_batch_rec {
+	int n;
+	struct smem_log_item item[2];
+};
+
+struct smem_log_batch {
+	spinlock_t lock;
+	int count;
+	struct smem_log_batch_rec rec[SMEM_LOG_BATCH_SIZE];
+};
+
+static DEFINE_PER_CPU(struct smem_log_batch, smem_log_batch) = {
+	.lock = __SPIN_LOCK_UNLOCKED(smem_log_batch.lock),
+};
+
+static struct timer_list smem_log_flush_timer;
+
+/* Call with b->lock held */
+static void smem_log_flush_batch(struct smem_log_batch *b)
+{
+	unsigned long flags;
+	int i;
+
+	if (!b->count)
+		return;
+
+	remote_spin_lock_irqsave(inst[GEN].remote_spinlock, flags);
+	for (i = 0; i < b->count; i++)
+		_smem_log_put(&inst[GEN], b->rec[i].item, b->rec[i].n);
+	remote_spin_unlock_irqrestore(inst[GEN].remote_spinlock, flags);
+
+	b->count = 0;
+}
+
+static void smem_log_flush(void)
+{
+	struct smem_log_batch *b;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		b = &per_cpu(smem_log_batch, cpu);
+		spin_lock_irqsave(&b->lock, flags);
+		smem_log_flush_batch(b);
+		spin_unlock_irqrestore(&b->lock, flags);
+	}
+}
+
+static void smem_log_flush_timer_fn(unsigned long data)
+{
+	smem_log_flush();
+}
+
+static void smem_log_batch_items(struct smem_log_item *item, int n)
+{
+	struct smem_log_batch *b;
+	struct smem_log_batch_rec *rec;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	b = &__get_cpu_var(smem_log_batch);
+	spin_lock(&b->lock);
+
+	rec = &b->rec[b->count++];
+	rec->n = n;
+	memcpy(rec->item, item, n * sizeof(*item));
+
+	if (b->count == SMEM_LOG_BATCH_SIZE)
+		smem_log_flush_batch(b);
+	else if (!timer_pending(&smem_log_flush_timer))
+		mod_timer(&smem_log_flush_timer,
+			  jiffies + SMEM_LOG_BATCH_DELAY);
+
+	spin_unlock(&b->lock);
+	local_irq_restore(flags);
+}
+
+static void smem_log_batch_init(void)
+{
+	init_timer_deferrable(&smem_log_flush_timer);
+	smem_log_flush_timer.function = smem_log_flush_timer_fn;
+}
+#else
+static void smem_log_flush(void) {}
+static void smem_log_batch_init(void) {}
+#endif
+
+static void smem_log_write_items(struct smem_log_inst *inst,
+				 struct smem_log_item *item, int n)
+{
+	unsigned long flags;
+
+#if defined(CONFIG_MSM_SMEM_LOG_BATCH)
+	if (inst->which_log == GEN && inst->events) {
+		smem_log_batch_items(item, n);
+		return;
+	}
+#endif
+
+	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
+	_smem_log_put(inst, item, n);
+	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
+}
+
 static void _smem_log_event(
-	struct smem_log_item __iomem *events,
-	uint32_t __iomem *_idx,
-	remote_spinlock_t *lock,
-	int num,
+	struct smem_log_inst *inst,
 	uint32_t id, uint32_t data1, uint32_t data2,
 	uint32_t data3)
 {
 	struct smem_log_item item;
-	uint32_t idx;
-	uint32_t next_idx;
-	unsigned long flags;
 
 	item.timetick = read_timestamp();
 	item.identifier = id;
@@ -1029,36 +1162,16 @@ static void _smem_log_event(
 	item.data2 = data2;
 	item.data3 = data3;
 
-	remote_spin_lock_irqsave(lock, flags);
-
-	idx = *_idx;
-
-	if (idx < num) {
-		memcpy(&events[idx],
-		       &item, sizeof(item));
-	}
-
-	next_idx = idx + 1;
-	if (next_idx >= num)
-		next_idx = 0;
-	*_idx = next_idx;
-
-	remote_spin_unlock_irqrestore(lock, flags);
+	smem_log_write_items(inst, &item, 1);
 }
 
 static void _smem_log_event6(
-	struct smem_log_item __iomem *events,
-	uint32_t __iomem *_idx,
-	remote_spinlock_t *lock,
-	int num,
+	struct smem_log_inst *inst,
 	uint32_t id, uint32_t data1, uint32_t data2,
 	uint32_t data3, uint32_t data4, uint32_t data5,
 	uint32_t data6)
 {
 	struct smem_log_item item[2];
-	uint32_t idx;
-	uint32_t next_idx;
-	unsigned long flags;
 
 	item[0].timetick = read_timestamp();
 	item[0].identifier = id;
@@ -1071,59 +1184,41 @@ static void _smem_log_event6(
 	item[1].data2 = data5;
 	item[1].data3 = data6;
 
-	remote_spin_lock_irqsave(lock, flags);
-
-	idx = *_idx;
-
-	if (idx < (num-1)) {
-		memcpy(&events[idx],
-		       &item, sizeof(item));
-	}
-
-	next_idx = idx + 2;
-	if (next_idx >= num)
-		next_idx = 0;
-	*_idx = next_idx;
-
-	remote_spin_unlock_irqrestore(lock, flags);
+	smem_log_write_items(inst, item, 2);
 }
 
 void smem_log_event(uint32_t id, uint32_t data1, uint32_t data2,
 		    uint32_t data3)
 {
-	_smem_log_event(inst[GEN].events, inst[GEN].idx,
-			inst[GEN].remote_spinlock, SMEM_LOG_NUM_ENTRIES,
-			id, data1, data2, data3);
+	_smem_log_event(&inst[GEN], id, data1, data2, data3);
 }
 
 void smem_log_event6(uint32_t id, uint32_t data1, uint32_t data2,
 		     uint32_t data3, uint32_t data4, uint32_t data5,
 		     uint32_t data6)
 {
-	_smem_log_event6(inst[GEN].events, inst[GEN].idx,
-			 inst[GEN].remote_spinlock, SMEM_LOG_NUM_ENTRIES,
-			 id, data1, data2, data3, data4, data5, data6);
+	_smem_log_event6(&inst[GEN], id, data1, data2, data3,
+			 data4, data5, data6);
 }
 
 void smem_log_event_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 		    uint32_t data3)
 {
-	_smem_log_event(inst[STA].events, inst[STA].idx,
-			inst[STA].remote_spinlock, SMEM_LOG_NUM_STATIC_ENTRIES,
-			id, data1, data2, data3);
+	_smem_log_event(&inst[STA], id, data1, data2, data3);
 }
 
 void smem_log_event6_to_static(uint32_t id, uint32_t data1, uint32_t data2,
 		     uint32_t data3, uint32_t data4, uint32_t data5,
 		     uint32_t data6)
 {
-	_smem_log_event6(inst[STA].events, inst[STA].idx,
-			 inst[STA].remote_spinlock, SMEM_LOG_NUM_STATIC_ENTRIES,
-			 id, data1, data2, data3, data4, data5, data6);
+	_smem_log_event6(&inst[STA], id, data1, data2, data3,
+			 data4, data5, data6);
 }
 
 static int _smem_log_init(void)
 {
+	smem_log_batch_init();
+
 	inst[GEN].which_log = GEN;
 	inst[GEN].events =
 		(struct smem_log_item *)smem_alloc(SMEM_SMEM_LOG_EVENTS,
@@ -1193,6 +1288,7 @@ static ssize_t smem_log_read_bin(struct file *fp, char __user *buf,
 
 	inst = fp->private_data;
 
+	smem_log_flush();
 	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
 
 	orig_idx = *inst->idx;
@@ -1243,6 +1339,7 @@ static ssize_t smem_log_read(struct file *fp, char __user *buf,
 
 	inst = fp->private_data;
 
+	smem_log_flush();
 	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
 
 	orig_idx = *inst->idx;
@@ -1290,6 +1387,63 @@ static ssize_t smem_log_read(struct file *fp, char __user *buf,
 	return ret;
 }
 
+/* Binary stream mode: each read returns the entries logged since the
+ * previous read, oldest first; the first read returns the whole log.
+ * The file position holds the index of the next entry to return,
+ * plus one.
+ */
+static ssize_t smem_log_read_stream(struct file *fp, char __user *buf,
+				    size_t count, loff_t *pos)
+{
+	struct smem_log_inst *inst;
+	struct smem_log_item *items;
+	unsigned long flags;
+	int idx, start, avail, n, i;
+	ssize_t ret;
+
+	inst = fp->private_data;
+	if (!inst->events || !inst->idx)
+		return -ENODEV;
+
+	n = min_t(size_t, count / sizeof(*items), inst->num);
+	if (!n)
+		return -EINVAL;
+
+	items = kmalloc(n * sizeof(*items), GFP_KERNEL);
+	if (!items)
+		return -ENOMEM;
+
+	smem_log_flush();
+	remote_spin_lock_irqsave(inst->remote_spinlock, flags);
+
+	idx = *inst->idx;
+	if (idx >= inst->num)
+		idx = 0;
+
+	if (*pos > 0 && *pos <= inst->num) {
+		start = *pos - 1;
+		avail = (idx - start + inst->num) % inst->num;
+	} else {
+		start = idx;
+		avail = inst->num;
+	}
+
+	n = min(n, avail);
+	for (i = 0; i < n; i++)
+		items[i] = inst->events[(start + i) % inst->num];
+
+	remote_spin_unlock_irqrestore(inst->remote_spinlock, flags);
+
+	*pos = (start + n) % inst->num + 1;
+
+	ret = n * sizeof(*items);
+	if (copy_to_user(buf, items, ret))
+		ret = -EFAULT;
+
+	kfree(items);
+	return ret;
+}
+
 static ssize_t smem_log_write_bin(struct file *fp, const char __user *buf,
 			 size_t count, loff_t *pos)
 {
@@ -1414,6 +1568,15 @@ static const struct file_operations smem_log_bin_fops = {
 	.ioctl = smem_log_ioctl,
 };
 
+static const struct file_operations smem_log_stream_fops = {
+	.owner = THIS_MODULE,
+	.read = smem_log_read_stream,
+	.write = smem_log_write_bin,
+	.open = smem_log_open,
+	.release = smem_log_release,
+	.ioctl = smem_log_ioctl,
+};
+
 static int smem_log_ioctl(struct inode *ip, struct file *fp,
 			  unsigned int cmd, unsigned long arg)
 {
@@ -1432,6 +1595,10 @@ static int smem_log_ioctl(struct inode *ip, struct file *fp,
 		} else if (arg == SMIOC_BINARY) {
 			D("%s set bin mode\n", __func__);
 			fp->f_op = &smem_log_bin_fops;
+		} else if (arg == SMIOC_BINARY_STREAM) {
+			D("%s set bin stream mode\n", __func__);
+			fp->f_op = &smem_log_stream_fops;
+			fp->f_pos = 0;
 		} else {
 			return -EINVAL;
 		}
@@ -1467,6 +1634,7 @@ static int _debug_dump(int log, char *buf, int max)
 	if (!inst[log].events)
 		return 0;
 
+	smem_log_flush();
 	remote_spin_lock_irqsave(inst[log].remote_spinlock, flags);
 
 	orig_idx = *inst[log].idx;
@@ -1538,6 +1706,7 @@ static int _debug_dump_sym(int log, char *buf, int max)
 				       voter_d2_syms[k].str);
 	i += scnprintf(buf + i, max - i, "\n");
 
+	smem_log_flush();
 	remote_spin_lock_irqsave(inst[log].remote_spinlock, flags);
 
 	orig_idx = *inst[log].idx;
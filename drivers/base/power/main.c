@@ -23,6 +23,7 @@
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
 #include <linux/resume-trace.h>
+#include <linux/suspend.h>
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/async.h>
@@ -175,15 +176,11 @@ void device_pm_move_last(struct device *dev)
 
 static ktime_t initcall_debug_start(struct device *dev)
 {
-	ktime_t calltime = ktime_set(0, 0);
-
-	if (initcall_debug) {
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i\n",
 				dev_name(dev), task_pid_nr(current));
-		calltime = ktime_get();
-	}
 
-	return calltime;
+	return ktime_get();
 }
 
 static void initcall_debug_report(struct device *dev, ktime_t calltime,
@@ -289,6 +286,7 @@ static int pm_op(struct device *dev,
 	}
 
 	initcall_debug_report(dev, calltime, error);
+	suspend_stats_device(dev, calltime, state.event == PM_EVENT_RESUME);
 
 	return error;
 }
@@ -309,12 +307,11 @@ static int pm_noirq_op(struct device *dev,
 	int error = 0;
 	ktime_t calltime, delta, rettime;
 
-	if (initcall_debug) {
+	if (initcall_debug)
 		pr_info("calling  %s+ @ %i, parent: %s\n",
 				dev_name(dev), task_pid_nr(current),
 				dev->parent ? dev_name(dev->parent) : "none");
-		calltime = ktime_get();
-	}
+	calltime = ktime_get();
 
 	switch (state.event) {
 #ifdef CONFIG_SUSPEND
@@ -374,6 +371,7 @@ static int pm_noirq_op(struct device *dev,
 			dev_name(dev), error,
 			(unsigned long long)ktime_to_ns(delta) >> 10);
 	}
+	suspend_stats_device(dev, calltime, state.event == PM_EVENT_RESUME);
 
 	return error;
 }
@@ -528,6 +526,7 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
 	suspend_report_result(cb, error);
 
 	initcall_debug_report(dev, calltime, error);
+	suspend_stats_device(dev, calltime, 1);
 
 	return error;
 }
@@ -898,6 +897,7 @@ static int legacy_suspend(struct device *dev, pm_message_t state,
 	suspend_report_result(cb, error);
 
 	initcall_debug_report(dev, calltime, error);
+	suspend_stats_device(dev, calltime, 0);
 
 	return error;
 }
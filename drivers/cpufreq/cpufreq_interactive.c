@@ -27,9 +27,15 @@
 #include <linux/workqueue.h>
 #include <linux/kthread.h>
 #include <linux/mutex.h>
+#include <linux/input.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
 
 #include <asm/cputime.h>
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/cpufreq_interactive.h>
+
 static atomic_t active_count = ATOMIC_INIT(0);
 
 struct cpufreq_interactive_cpuinfo {
@@ -66,6 +72,17 @@ static u64 hispeed_freq;
 #define DEFAULT_GO_HISPEED_LOAD 95
 static unsigned long go_hispeed_load;
 
+/*
+ * Target load for each frequency range, as "load freq:load freq:load ...".
+ * Below go_hispeed_load the speed is scaled so that the load at the new
+ * frequency approaches the target load of the current one.
+ */
+#define DEFAULT_TARGET_LOAD 100
+static unsigned int default_target_loads[] = {DEFAULT_TARGET_LOAD};
+static spinlock_t target_loads_lock;
+static unsigned int *target_loads = default_target_loads;
+static int ntarget_loads = ARRAY_SIZE(default_target_loads);
+
 /*
  * The minimum amount of time to spend at a frequency before we can ramp down.
  */
@@ -78,6 +95,16 @@ static unsigned long min_sample_time;
 #define DEFAULT_TIMER_RATE 20 * USEC_PER_MSEC
 static unsigned long timer_rate;
 
+/*
+ * Hold at least hispeed_freq while boost is set, or until the end of the
+ * last boost pulse (boostpulse sysfs write or input event).
+ */
+#define DEFAULT_BOOSTPULSE_DURATION 80 * USEC_PER_MSEC
+static int boost_val;
+static unsigned long boostpulse_duration_val;
+static u64 boostpulse_endtime;
+static int input_boost_val = 1;
+
 static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		unsigned int event);
 
@@ -91,6 +118,22 @@ struct cpufreq_governor cpufreq_gov_interactive = {
 	.owner = THIS_MODULE,
 };
 
+static unsigned int freq_to_targetload(unsigned int freq)
+{
+	int i;
+	unsigned int ret;
+	unsigned long flags;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+
+	for (i = 0; i < ntarget_loads - 1 && freq >= target_loads[i+1]; i += 2)
+		;
+
+	ret = target_loads[i];
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return ret;
+}
+
 static void cpufreq_interactive_timer(unsigned long data)
 {
 	unsigned int delta_idle;
@@ -105,6 +148,7 @@ static void cpufreq_interactive_timer(unsigned long data)
 	unsigned int new_freq;
 	unsigned int index;
 	unsigned long flags;
+	int boosted;
 
 	smp_rmb();
 
@@ -163,15 +207,24 @@ static void cpufreq_interactive_timer(unsigned long data)
 	if (load_since_change > cpu_load)
 		cpu_load = load_since_change;
 
+	boosted = boost_val || pcpu->timer_run_time < boostpulse_endtime;
+
 	if (cpu_load >= go_hispeed_load) {
 		if (pcpu->policy->cur == pcpu->policy->min)
 			new_freq = hispeed_freq;
 		else
 			new_freq = pcpu->policy->max * cpu_load / 100;
 	} else {
-		new_freq = pcpu->policy->cur * cpu_load / 100;
+		new_freq = pcpu->policy->cur * cpu_load /
+			freq_to_targetload(pcpu->policy->cur);
 	}
 
+	if (boosted && new_freq < hispeed_freq)
+		new_freq = hispeed_freq;
+
+	if (new_freq > pcpu->policy->max)
+		new_freq = pcpu->policy->max;
+
 	if (cpufreq_frequency_table_target(pcpu->policy, pcpu->freq_table,
 					   new_freq, CPUFREQ_RELATION_H,
 					   &index)) {
@@ -181,6 +234,8 @@ static void cpufreq_interactive_timer(unsigned long data)
 	}
 
 	new_freq = pcpu->freq_table[index].frequency;
+	trace_cpufreq_interactive_target(data, cpu_load, pcpu->target_freq,
+					 new_freq, boosted);
 
 	if (pcpu->target_freq == new_freq)
 		goto rearm_if_notmax;
@@ -380,6 +435,8 @@ static int cpufreq_interactive_up_task(void *data)
 							max_freq,
 							CPUFREQ_RELATION_H);
 			mutex_unlock(&set_speed_lock);
+			trace_cpufreq_interactive_up(cpu, pcpu->target_freq,
+						     pcpu->policy->cur);
 
 			pcpu->freq_change_time_in_idle =
 				get_cpu_idle_time_us(cpu,
@@ -427,12 +484,269 @@ static void cpufreq_interactive_freq_down(struct work_struct *work)
 						CPUFREQ_RELATION_H);
 
 		mutex_unlock(&set_speed_lock);
+		trace_cpufreq_interactive_down(cpu, pcpu->target_freq,
+					       pcpu->policy->cur);
 		pcpu->freq_change_time_in_idle =
 			get_cpu_idle_time_us(cpu,
 					     &pcpu->freq_change_time);
 	}
 }
 
+/*
+ * Raise every CPU running this governor to at least hispeed_freq right
+ * away through the up task, instead of waiting for the next timer sample
+ * to notice the load.  Called from atomic context by the input handler.
+ */
+static void cpufreq_interactive_boost(void)
+{
+	int i;
+	int anyboost = 0;
+	unsigned long flags;
+	struct cpufreq_interactive_cpuinfo *pcpu;
+
+	spin_lock_irqsave(&up_cpumask_lock, flags);
+
+	for_each_online_cpu(i) {
+		unsigned int boost_freq;
+
+		pcpu = &per_cpu(cpuinfo, i);
+		smp_rmb();
+
+		if (!pcpu->governor_enabled)
+			continue;
+
+		/* Stay inside the band left by policy limits (perflock) */
+		boost_freq = min_t(unsigned int, hispeed_freq,
+				   pcpu->policy->max);
+
+		if (pcpu->target_freq < boost_freq) {
+			pcpu->target_freq = boost_freq;
+			cpumask_set_cpu(i, &up_cpumask);
+			anyboost = 1;
+		}
+	}
+
+	spin_unlock_irqrestore(&up_cpumask_lock, flags);
+
+	if (anyboost)
+		wake_up_process(up_task);
+}
+
+static void cpufreq_interactive_boostpulse(const char *source)
+{
+	boostpulse_endtime = ktime_to_us(ktime_get()) + boostpulse_duration_val;
+	trace_cpufreq_interactive_boost(source);
+	cpufreq_interactive_boost();
+}
+
+#ifdef CONFIG_INPUT
+static void cpufreq_interactive_input_event(struct input_handle *handle,
+					    unsigned int type,
+					    unsigned int code, int value)
+{
+	if (!input_boost_val || !atomic_read(&active_count))
+		return;
+
+	/* touch down and finger motion, not releases or pressure */
+	switch (type) {
+	case EV_KEY:
+		if (code != BTN_TOUCH || !value)
+			return;
+		break;
+	case EV_ABS:
+		if (code != ABS_X && code != ABS_Y &&
+		    code != ABS_MT_POSITION_X && code != ABS_MT_POSITION_Y)
+			return;
+		break;
+	default:
+		return;
+	}
+
+	/*
+	 * A touch stream reports several events per sample; only extend
+	 * the pulse once half of it has elapsed.
+	 */
+	if (boostpulse_endtime >
+	    ktime_to_us(ktime_get()) + boostpulse_duration_val / 2)
+		return;
+
+	cpufreq_interactive_boostpulse("input");
+}
+
+static int cpufreq_interactive_input_connect(struct input_handler *handler,
+					     struct input_dev *dev,
+					     const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int error;
+
+	handle = kzalloc(sizeof(struct input_handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "cpufreq_interactive";
+
+	error = input_register_handle(handle);
+	if (error)
+		goto err_free_handle;
+
+	error = input_open_device(handle);
+	if (error)
+		goto err_unregister_handle;
+
+	return 0;
+
+err_unregister_handle:
+	input_unregister_handle(handle);
+err_free_handle:
+	kfree(handle);
+	return error;
+}
+
+static void cpufreq_interactive_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+/*
+ * Touchscreens only: BTN_TOUCH together with single or multitouch
+ * positions.  Sensors such as the compass report ABS_X continuously and
+ * must not keep the boost on.
+ */
+static const struct input_device_id cpufreq_interactive_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_KEY) | BIT_MASK(EV_ABS) },
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) |
+			    BIT_MASK(ABS_MT_POSITION_Y) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_KEYBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_KEY) | BIT_MASK(EV_ABS) },
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+		.absbit = { [BIT_WORD(ABS_X)] =
+			    BIT_MASK(ABS_X) | BIT_MASK(ABS_Y) },
+	},
+	{ },
+};
+
+static struct input_handler cpufreq_interactive_input_handler = {
+	.event		= cpufreq_interactive_input_event,
+	.connect	= cpufreq_interactive_input_connect,
+	.disconnect	= cpufreq_interactive_input_disconnect,
+	.name		= "cpufreq_interactive",
+	.id_table	= cpufreq_interactive_ids,
+};
+
+static int input_handler_registered;
+#endif
+
+static unsigned int *get_tokenized_data(const char *buf, int *num_tokens)
+{
+	const char *cp;
+	int i;
+	int ntokens = 1;
+	unsigned int *tokenized_data;
+	int err = -EINVAL;
+
+	cp = buf;
+	while ((cp = strpbrk(cp + 1, " :")))
+		ntokens++;
+
+	if (!(ntokens & 0x1))
+		goto err;
+
+	tokenized_data = kmalloc(ntokens * sizeof(unsigned int), GFP_KERNEL);
+	if (!tokenized_data) {
+		err = -ENOMEM;
+		goto err;
+	}
+
+	cp = buf;
+	i = 0;
+	while (i < ntokens) {
+		if (sscanf(cp, "%u", &tokenized_data[i++]) != 1)
+			goto err_kfree;
+
+		cp = strpbrk(cp, " :");
+		if (!cp)
+			break;
+		cp++;
+	}
+
+	if (i != ntokens)
+		goto err_kfree;
+
+	*num_tokens = ntokens;
+	return tokenized_data;
+
+err_kfree:
+	kfree(tokenized_data);
+err:
+	return ERR_PTR(err);
+}
+
+static ssize_t show_target_loads(struct kobject *kobj,
+				 struct attribute *attr, char *buf)
+{
+	int i;
+	ssize_t ret = 0;
+	unsigned long flags;
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+
+	for (i = 0; i < ntarget_loads; i++)
+		ret += sprintf(buf + ret, "%u%s", target_loads[i],
+			       i & 0x1 ? ":" : " ");
+
+	/* Replace the trailing separator with a newline. */
+	sprintf(buf + ret - 1, "\n");
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return ret;
+}
+
+static ssize_t store_target_loads(struct kobject *kobj,
+				  struct attribute *attr, const char *buf,
+				  size_t count)
+{
+	int i;
+	int ntokens;
+	unsigned int *new_target_loads;
+	unsigned long flags;
+
+	new_target_loads = get_tokenized_data(buf, &ntokens);
+	if (IS_ERR(new_target_loads))
+		return PTR_ERR(new_target_loads);
+
+	for (i = 0; i < ntokens; i += 2) {
+		if (!new_target_loads[i] || new_target_loads[i] > 100) {
+			kfree(new_target_loads);
+			return -EINVAL;
+		}
+	}
+
+	spin_lock_irqsave(&target_loads_lock, flags);
+	if (target_loads != default_target_loads)
+		kfree(target_loads);
+	target_loads = new_target_loads;
+	ntarget_loads = ntokens;
+	spin_unlock_irqrestore(&target_loads_lock, flags);
+	return count;
+}
+
+static struct global_attr target_loads_attr = __ATTR(target_loads, 0644,
+		show_target_loads, store_target_loads);
+
 static ssize_t show_hispeed_freq(struct kobject *kobj,
 				 struct attribute *attr, char *buf)
 {
@@ -523,11 +837,109 @@ static ssize_t store_timer_rate(struct kobject *kobj,
 static struct global_attr timer_rate_attr = __ATTR(timer_rate, 0644,
 		show_timer_rate, store_timer_rate);
 
+static ssize_t show_boost(struct kobject *kobj, struct attribute *attr,
+			  char *buf)
+{
+	return sprintf(buf, "%d\n", boost_val);
+}
+
+static ssize_t store_boost(struct kobject *kobj, struct attribute *attr,
+			   const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	boost_val = val;
+
+	if (boost_val) {
+		trace_cpufreq_interactive_boost("on");
+		cpufreq_interactive_boost();
+	} else {
+		trace_cpufreq_interactive_unboost("off");
+	}
+
+	return count;
+}
+
+static struct global_attr boost_attr = __ATTR(boost, 0644,
+		show_boost, store_boost);
+
+static ssize_t store_boostpulse(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+
+	cpufreq_interactive_boostpulse("pulse");
+	return count;
+}
+
+static struct global_attr boostpulse_attr = __ATTR(boostpulse, 0200,
+		NULL, store_boostpulse);
+
+static ssize_t show_boostpulse_duration(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", boostpulse_duration_val);
+}
+
+static ssize_t store_boostpulse_duration(struct kobject *kobj,
+			struct attribute *attr, const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	boostpulse_duration_val = val;
+	return count;
+}
+
+static struct global_attr boostpulse_duration_attr = __ATTR(
+		boostpulse_duration, 0644, show_boostpulse_duration,
+		store_boostpulse_duration);
+
+static ssize_t show_input_boost(struct kobject *kobj, struct attribute *attr,
+				char *buf)
+{
+	return sprintf(buf, "%d\n", input_boost_val);
+}
+
+static ssize_t store_input_boost(struct kobject *kobj, struct attribute *attr,
+				 const char *buf, size_t count)
+{
+	int ret;
+	unsigned long val;
+
+	ret = strict_strtoul(buf, 0, &val);
+	if (ret < 0)
+		return ret;
+	input_boost_val = !!val;
+	return count;
+}
+
+static struct global_attr input_boost_attr = __ATTR(input_boost, 0644,
+		show_input_boost, store_input_boost);
+
 static struct attribute *interactive_attributes[] = {
 	&hispeed_freq_attr.attr,
 	&go_hispeed_load_attr.attr,
+	&target_loads_attr.attr,
 	&min_sample_time_attr.attr,
 	&timer_rate_attr.attr,
+	&boost_attr.attr,
+	&boostpulse_attr.attr,
+	&boostpulse_duration_attr.attr,
+	&input_boost_attr.attr,
 	NULL,
 };
 
@@ -607,12 +1019,26 @@ static int cpufreq_governor_interactive(struct cpufreq_policy *policy,
 		break;
 
 	case CPUFREQ_GOV_LIMITS:
+		mutex_lock(&set_speed_lock);
 		if (policy->max < policy->cur)
 			__cpufreq_driver_target(policy,
 					policy->max, CPUFREQ_RELATION_H);
 		else if (policy->min > policy->cur)
 			__cpufreq_driver_target(policy,
 					policy->min, CPUFREQ_RELATION_L);
+
+		/*
+		 * Restart from the clamped speed so the next sample scales
+		 * inside the new band instead of against a stale target.
+		 */
+		for_each_cpu(j, policy->cpus) {
+			pcpu = &per_cpu(cpuinfo, j);
+			pcpu->target_freq = policy->cur;
+			pcpu->freq_change_time_in_idle =
+				get_cpu_idle_time_us(j,
+						     &pcpu->freq_change_time);
+		}
+		mutex_unlock(&set_speed_lock);
 		break;
 	}
 	return 0;
@@ -647,6 +1073,7 @@ static int __init cpufreq_interactive_init(void)
 	go_hispeed_load = DEFAULT_GO_HISPEED_LOAD;
 	min_sample_time = DEFAULT_MIN_SAMPLE_TIME;
 	timer_rate = DEFAULT_TIMER_RATE;
+	boostpulse_duration_val = DEFAULT_BOOSTPULSE_DURATION;
 
 	/* Initalize per-cpu timers */
 	for_each_possible_cpu(i) {
@@ -676,9 +1103,16 @@ static int __init cpufreq_interactive_init(void)
 
 	spin_lock_init(&up_cpumask_lock);
 	spin_lock_init(&down_cpumask_lock);
+	spin_lock_init(&target_loads_lock);
 	mutex_init(&set_speed_lock);
 
 	idle_notifier_register(&cpufreq_interactive_idle_nb);
+#ifdef CONFIG_INPUT
+	if (input_register_handler(&cpufreq_interactive_input_handler))
+		pr_warning("cpufreq_interactive: input boost unavailable\n");
+	else
+		input_handler_registered = 1;
+#endif
 
 	return cpufreq_register_governor(&cpufreq_gov_interactive);
 
@@ -696,6 +1130,10 @@ module_init(cpufreq_interactive_init);
 static void __exit cpufreq_interactive_exit(void)
 {
 	cpufreq_unregister_governor(&cpufreq_gov_interactive);
+#ifdef CONFIG_INPUT
+	if (input_handler_registered)
+		input_unregister_handler(&cpufreq_interactive_input_handler);
+#endif
 	kthread_stop(up_task);
 	put_task_struct(up_task);
 	destroy_workqueue(down_wq);
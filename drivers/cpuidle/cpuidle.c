@@ -92,6 +92,20 @@ static void cpuidle_idle_call(void)
 	target_state->time += (unsigned long long)dev->last_residency;
 	target_state->usage++;
 
+	/*
+	 * Count entries where the state was too deep for the idle period
+	 * that followed, or where the next deeper state would have paid off.
+	 */
+	if (target_state->flags & CPUIDLE_FLAG_TIME_VALID) {
+		unsigned int residency = max(dev->last_residency, 0);
+
+		if (residency < target_state->target_residency)
+			target_state->above++;
+		else if (target_state < &dev->states[dev->state_count - 1] &&
+			 residency >= (target_state + 1)->target_residency)
+			target_state->below++;
+	}
+
 	/* give the governor an opportunity to reflect on the outcome */
 	if (cpuidle_curr_governor->reflect)
 		cpuidle_curr_governor->reflect(dev);
@@ -516,6 +516,7 @@ int bma150_probe(struct i2c_client *client, const struct i2c_device_id *id)
 #ifdef EARLY_SUSPEND_BMA
 	bma->early_suspend.suspend = bma150_early_suspend;
 	bma->early_suspend.resume = bma150_early_resume;
+	bma->early_suspend.async = true;
 	register_early_suspend(&bma->early_suspend);
 #endif
 
@@ -2105,6 +2105,7 @@ static int cm3628_probe(struct i2c_client *client,
 			EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	lpi->early_suspend.suspend = cm3628_early_suspend;
 	lpi->early_suspend.resume = cm3628_late_resume;
+	lpi->early_suspend.async = true;
 	register_early_suspend(&lpi->early_suspend);
 
 	D("[PS][CM3628] %s: Probe success!\n", __func__);
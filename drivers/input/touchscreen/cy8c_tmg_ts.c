@@ -323,6 +323,7 @@ static int cy8c_ts_probe(struct i2c_client *client,
 	ts->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	ts->early_suspend.suspend = cy8c_ts_early_suspend;
 	ts->early_suspend.resume = cy8c_ts_late_resume;
+	ts->early_suspend.async = true;
 	register_early_suspend(&ts->early_suspend);
 #endif
 
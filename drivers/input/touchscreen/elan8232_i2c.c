@@ -674,6 +674,7 @@ static int ekt8232_probe(
 	ekt_data.early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
 	ekt_data.early_suspend.suspend = elan_ts_early_suspend;
 	ekt_data.early_suspend.resume = elan_ts_late_resume;
+	ekt_data.early_suspend.async = true;
 	register_early_suspend(&ekt_data.early_suspend);
 #endif
 	touch_sysfs_init();
@@ -1438,6 +1438,7 @@ static int elan_ktf2k_ts_probe(struct i2c_client *client,
 	ts->early_suspend.level = EARLY_SUSPEND_LEVEL_STOP_DRAWING - 1;
 	ts->early_suspend.suspend = elan_ktf2k_ts_early_suspend;
 	ts->early_suspend.resume = elan_ktf2k_ts_late_resume;
+	ts->early_suspend.async = true;
 	register_early_suspend(&ts->early_suspend);
 #endif
 
@@ -37,6 +37,7 @@
 #include <linux/debugfs.h>
 #include <linux/io.h>
 #include <linux/memory.h>
+#include <linux/ktime.h>
 
 #include <asm/cacheflush.h>
 #include <asm/div64.h>
@@ -67,6 +68,16 @@ static unsigned int msmsdcc_piopoll = 1;
 static unsigned int msmsdcc_sdioirq = 1;
 static unsigned long msmsdcc_irqtime;
 
+/*
+ * Transfers of at least this many bytes go through the data mover;
+ * anything smaller (or not a multiple of the FIFO size) uses PIO.
+ */
+static unsigned int msmsdcc_dma_thresh = MCI_FIFOSIZE;
+module_param_named(dma_thresh, msmsdcc_dma_thresh, uint, 0644);
+MODULE_PARM_DESC(dma_thresh, "Minimum transfer size in bytes for DMA");
+module_param_named(piopoll, msmsdcc_piopoll, uint, 0644);
+MODULE_PARM_DESC(piopoll, "Spin for FIFO status in the PIO irq handler");
+
 #define DUMMY_52_STATE_NONE		0
 #define DUMMY_52_STATE_SENT		1
 
@@ -456,6 +467,7 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 	struct msmsdcc_host *host = (struct msmsdcc_host *)data;
 	unsigned long		flags;
 	struct mmc_request	*mrq;
+	ktime_t			start = ktime_get();
 
 	spin_lock_irqsave(&host->lock, flags);
 	mrq = host->curr.mrq;
@@ -501,6 +513,10 @@ msmsdcc_dma_complete_tlet(unsigned long data)
 	host->dma.sg = NULL;
 	host->dma.busy = 0;
 
+	if (!mrq->data->error)
+		host->stats.dma_bytes += host->curr.xfer_size;
+	host->stats.dma_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
 	if (host->curr.got_dataend || mrq->data->error) {
 
 		if (mrq->data->error && !(host->curr.got_dataend)) {
@@ -558,7 +574,8 @@ static int validate_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	if (host->dma.channel == -1)
 		return -ENOENT;
 
-	if ((data->blksz * data->blocks) < MCI_FIFOSIZE)
+	if ((data->blksz * data->blocks) < max(msmsdcc_dma_thresh,
+					       (unsigned int)MCI_FIFOSIZE))
 		return -EINVAL;
 	if ((data->blksz * data->blocks) % MCI_FIFOSIZE)
 		return -EINVAL;
@@ -730,6 +747,7 @@ msmsdcc_start_data(struct msmsdcc_host *host, struct mmc_data *data,
 	unsigned int datactrl, timeout;
 	unsigned long long clks;
 	unsigned int pio_irqmask = 0;
+	ktime_t start = ktime_get();
 
 	host->curr.data = data;
 	host->curr.xfer_size = data->blksz * data->blocks;
@@ -741,9 +759,11 @@ msmsdcc_start_data(struct msmsdcc_host *host, struct mmc_data *data,
 
 	datactrl = MCI_DPSM_ENABLE | (data->blksz << 4);
 
-	if (!msmsdcc_config_dma(host, data))
+	if (!msmsdcc_config_dma(host, data)) {
 		datactrl |= MCI_DPSM_DMAENABLE;
-	else {
+		host->stats.dma_xfers++;
+	} else {
+		host->stats.pio_xfers++;
 		host->pio.sg = data->sg;
 		host->pio.sg_len = data->sg_len;
 		host->pio.sg_off = 0;
@@ -779,6 +799,8 @@ msmsdcc_start_data(struct msmsdcc_host *host, struct mmc_data *data,
 			host->cmd_c = c;
 		}
 		dsb();
+		host->stats.dma_ns += ktime_to_ns(ktime_sub(ktime_get(),
+							    start));
 		msm_dmov_enqueue_cmd_ext(host->dma.channel, &host->dma.hdr);
 		if (data->flags & MMC_DATA_WRITE)
 			host->prog_scan = 1;
@@ -961,9 +983,11 @@ msmsdcc_pio_irq(int irq, void *dev_id)
 {
 	struct msmsdcc_host	*host = dev_id;
 	uint32_t		status;
+	ktime_t			start;
 
 
 	spin_lock(&host->lock);
+	start = ktime_get();
 	status = msmsdcc_readl(host, MMCISTATUS);
 #if IRQ_DEBUG
 	msmsdcc_print_status(host, "irq1-r", status);
@@ -1040,6 +1064,7 @@ msmsdcc_pio_irq(int irq, void *dev_id)
 		host->pio.sg_off += len;
 		host->curr.xfer_remain -= len;
 		host->curr.data_xfered += len;
+		host->stats.pio_bytes += len;
 		remain -= len;
 
 		if (remain == 0) {
@@ -1066,6 +1091,7 @@ msmsdcc_pio_irq(int irq, void *dev_id)
 	if (!host->curr.xfer_remain)
 		msmsdcc_writel(host, 0, MMCIMASK1);
 
+	host->stats.pio_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 	spin_unlock(&host->lock);
 	return IRQ_HANDLED;
 }
@@ -2215,6 +2241,20 @@ msmsdcc_dbg_state_read(struct file *file, char __user *ubuf,
 			      host->curr.data_xfered, host->dma.sg);
 	}
 
+	i += scnprintf(buf + i, max - i, "REQS: %u CMDS: %u POLL: %u/%u\n",
+		       host->stats.reqs, host->stats.cmds,
+		       host->stats.cmdpoll_hits, host->stats.cmdpoll_misses);
+	i += scnprintf(buf + i, max - i,
+		       "PIO : %u xfers %llu bytes %llu ns\n",
+		       host->stats.pio_xfers, host->stats.pio_bytes,
+		       host->stats.pio_ns);
+	i += scnprintf(buf + i, max - i,
+		       "DMA : %u xfers %llu bytes %llu ns\n",
+		       host->stats.dma_xfers, host->stats.dma_bytes,
+		       host->stats.dma_ns);
+	i += scnprintf(buf + i, max - i, "DMA threshold: %u bytes\n",
+		       msmsdcc_dma_thresh);
+
 	return simple_read_from_buffer(ubuf, count, ppos, buf, i);
 }
 
@@ -216,6 +216,12 @@ struct msmsdcc_stats {
 	unsigned int cmds;
 	unsigned int cmdpoll_hits;
 	unsigned int cmdpoll_misses;
+	unsigned int pio_xfers;
+	unsigned int dma_xfers;
+	unsigned long long pio_bytes;
+	unsigned long long dma_bytes;
+	unsigned long long pio_ns;	/* CPU time spent moving PIO data */
+	unsigned long long dma_ns;	/* CPU time spent setting up/completing DMA */
 };
 
 struct msmsdcc_host {
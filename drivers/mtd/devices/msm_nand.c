@@ -32,7 +32,8 @@
 
 #include "msm_nand.h"
 
-#define MSM_NAND_DMA_BUFFER_SIZE SZ_4K
+/* a batched read takes ~3KB, leave room for the other operations */
+#define MSM_NAND_DMA_BUFFER_SIZE SZ_8K
 #define MSM_NAND_DMA_BUFFER_SLOTS \
 	(MSM_NAND_DMA_BUFFER_SIZE / (sizeof(((atomic_t *)0)->counter) * 8))
 
@@ -43,6 +44,9 @@
 
 #define VERBOSE 0
 
+/* Number of pages chained into a single data mover command list on reads */
+#define MSM_NAND_READ_BATCH 4
+
 struct msm_nand_chip {
 	struct device *dev;
 	wait_queue_head_t wait_queue;
@@ -375,13 +379,9 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 	struct msm_nand_chip *chip = mtd->priv;
 
 	struct {
-		dmov_s cmd[8 * 5 + 3];
+		dmov_s cmd[MSM_NAND_READ_BATCH * 8 * 5 + 3];
 		unsigned cmdptr;
 		struct {
-			uint32_t cmd;
-			uint32_t addr0;
-			uint32_t addr1;
-			uint32_t chipsel;
 			uint32_t cfg0;
 			uint32_t cfg1;
 			uint32_t exec;
@@ -390,15 +390,22 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 			uint32_t ecccfg_restore;
 #endif
 			struct {
-				uint32_t flash_status;
-				uint32_t buffer_status;
-			} result[8];
+				uint32_t cmd;
+				uint32_t addr0;
+				uint32_t addr1;
+				uint32_t chipsel;
+				struct {
+					uint32_t flash_status;
+					uint32_t buffer_status;
+				} result[8];
+			} page[MSM_NAND_READ_BATCH];
 		} data;
 	} *dma_buffer;
 	dmov_s *cmd;
-	unsigned n;
+	unsigned n, b, batch;
 	unsigned page = from >> chip->page_shift;
 	uint32_t oob_len = ops->ooblen;
+	uint32_t oob_len_left[MSM_NAND_READ_BATCH];
 	uint32_t sectordatasize;
 	uint32_t sectoroobsize;
 	int err, pageerr;
@@ -417,6 +424,8 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 	unsigned long uncorrected_noalloc = 0;
 	unsigned long *uncorrected = &uncorrected_noalloc;
 
+	BUILD_BUG_ON(sizeof(*dma_buffer) > MSM_NAND_DMA_BUFFER_SIZE / 2);
+
 	if (from & (mtd->writesize - 1)) {
 		pr_err("%s: unsupported from, 0x%llx\n",
 		       __func__, from);
@@ -509,18 +518,17 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 		oob_col >>= 1;
 
 	err = 0;
-	while (page_count-- > 0) {
+	while (page_count > 0) {
+		batch = min(page_count, (unsigned)MSM_NAND_READ_BATCH);
 		cmd = dma_buffer->cmd;
 
-		/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
+		/* CFG0 / CFG1 program values, shared by the whole batch */
 		if (ops->mode != MTD_OOB_RAW) {
-			dma_buffer->data.cmd = MSM_NAND_CMD_PAGE_READ_ECC;
 			dma_buffer->data.cfg0 =
 				(chip->CFG0 & ~(7U << 6)) |
 				((chip->last_sector - start_sector) << 6);
 			dma_buffer->data.cfg1 = chip->CFG1;
 		} else {
-			dma_buffer->data.cmd = MSM_NAND_CMD_PAGE_READ;
 			dma_buffer->data.cfg0 =
 				(MSM_NAND_CFG0_RAW & ~(7U << 6)) |
 				(chip->last_sector << 6);
@@ -528,122 +536,145 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 						(chip->CFG1 & CFG1_WIDE_FLASH);
 		}
 
-		dma_buffer->data.addr0 = (page << 16) | oob_col;
-		/* qc example is (page >> 16) && 0xff !? */
-		dma_buffer->data.addr1 = (page >> 16) & 0xff;
-		/* flash0 + undoc bit */
-		dma_buffer->data.chipsel = 0 | 4;
-
-
 		/* GO bit for the EXEC register */
 		dma_buffer->data.exec = 1;
 
+		BUILD_BUG_ON(8 != ARRAY_SIZE(dma_buffer->data.page[0].result));
 
-		BUILD_BUG_ON(8 != ARRAY_SIZE(dma_buffer->data.result));
-
-		for (n = start_sector; n <= chip->last_sector; n++) {
-			/* flash + buffer status return words */
-			dma_buffer->data.result[n].flash_status = 0xeeeeeeee;
-			dma_buffer->data.result[n].buffer_status = 0xeeeeeeee;
-
-			/* block on cmd ready, then
-			 * write CMD / ADDR0 / ADDR1 / CHIPSEL
-			 * regs in a burst
-			 */
-			cmd->cmd = DST_CRCI_NAND_CMD;
-			cmd->src = msm_virt_to_dma(chip, &dma_buffer->data.cmd);
-			cmd->dst = MSM_NAND_FLASH_CMD;
-			if (n == start_sector)
-				cmd->len = 16;
+		/* chain the reads of up to MSM_NAND_READ_BATCH pages in
+		 * one command list so the controller can start on the
+		 * next page without waiting for us
+		 */
+		for (b = 0; b < batch; b++) {
+			/* CMD / ADDR0 / ADDR1 / CHIPSEL program values */
+			if (ops->mode != MTD_OOB_RAW)
+				dma_buffer->data.page[b].cmd =
+					MSM_NAND_CMD_PAGE_READ_ECC;
 			else
-				cmd->len = 4;
-			cmd++;
-
-			if (n == start_sector) {
-				cmd->cmd = 0;
+				dma_buffer->data.page[b].cmd =
+					MSM_NAND_CMD_PAGE_READ;
+
+			dma_buffer->data.page[b].addr0 =
+				((page + b) << 16) | oob_col;
+			/* qc example is (page >> 16) && 0xff !? */
+			dma_buffer->data.page[b].addr1 =
+				((page + b) >> 16) & 0xff;
+			/* flash0 + undoc bit */
+			dma_buffer->data.page[b].chipsel = 0 | 4;
+
+			for (n = start_sector; n <= chip->last_sector; n++) {
+				/* flash + buffer status return words */
+				dma_buffer->data.page[b].result[n].flash_status =
+					0xeeeeeeee;
+				dma_buffer->data.page[b].result[n].buffer_status =
+					0xeeeeeeee;
+
+				/* block on cmd ready, then
+				 * write CMD / ADDR0 / ADDR1 / CHIPSEL
+				 * regs in a burst
+				 */
+				cmd->cmd = DST_CRCI_NAND_CMD;
 				cmd->src = msm_virt_to_dma(chip,
-							&dma_buffer->data.cfg0);
-				cmd->dst = MSM_NAND_DEV0_CFG0;
-				cmd->len = 8;
+						&dma_buffer->data.page[b].cmd);
+				cmd->dst = MSM_NAND_FLASH_CMD;
+				if (n == start_sector)
+					cmd->len = 16;
+				else
+					cmd->len = 4;
 				cmd++;
-#if SUPPORT_WRONG_ECC_CONFIG
-				if (chip->saved_ecc_buf_cfg !=
-				    chip->ecc_buf_cfg) {
-					dma_buffer->data.ecccfg =
-						chip->ecc_buf_cfg;
+
+				if (b == 0 && n == start_sector) {
 					cmd->cmd = 0;
 					cmd->src = msm_virt_to_dma(chip,
-						      &dma_buffer->data.ecccfg);
-					cmd->dst = MSM_NAND_EBI2_ECC_BUF_CFG;
-					cmd->len = 4;
+							&dma_buffer->data.cfg0);
+					cmd->dst = MSM_NAND_DEV0_CFG0;
+					cmd->len = 8;
 					cmd++;
-				}
+#if SUPPORT_WRONG_ECC_CONFIG
+					if (chip->saved_ecc_buf_cfg !=
+					    chip->ecc_buf_cfg) {
+						dma_buffer->data.ecccfg =
+							chip->ecc_buf_cfg;
+						cmd->cmd = 0;
+						cmd->src = msm_virt_to_dma(chip,
+						      &dma_buffer->data.ecccfg);
+						cmd->dst =
+						      MSM_NAND_EBI2_ECC_BUF_CFG;
+						cmd->len = 4;
+						cmd++;
+					}
 #endif
-			}
-
-			/* kick the execute register */
-			cmd->cmd = 0;
-			cmd->src =
-				msm_virt_to_dma(chip, &dma_buffer->data.exec);
-			cmd->dst = MSM_NAND_EXEC_CMD;
-			cmd->len = 4;
-			cmd++;
-
-			/* block on data ready, then
-			 * read the status register
-			 */
-			cmd->cmd = SRC_CRCI_NAND_DATA;
-			cmd->src = MSM_NAND_FLASH_STATUS;
-			cmd->dst = msm_virt_to_dma(chip,
-						   &dma_buffer->data.result[n]);
-			/* MSM_NAND_FLASH_STATUS + MSM_NAND_BUFFER_STATUS */
-			cmd->len = 8;
-			cmd++;
-
-			/* read data block
-			 * (only valid if status says success)
-			 */
-			if (ops->datbuf) {
-				if (ops->mode != MTD_OOB_RAW)
-					sectordatasize =
-						(n < chip->last_sector) ?
-						516 : chip->last_sectorsz;
-				else
-					sectordatasize = 528;
+				}
 
+				/* kick the execute register */
 				cmd->cmd = 0;
-				cmd->src = MSM_NAND_FLASH_BUFFER;
-				cmd->dst = data_dma_addr_curr;
-				data_dma_addr_curr += sectordatasize;
-				cmd->len = sectordatasize;
+				cmd->src = msm_virt_to_dma(chip,
+						&dma_buffer->data.exec);
+				cmd->dst = MSM_NAND_EXEC_CMD;
+				cmd->len = 4;
 				cmd++;
-			}
 
-			if (ops->oobbuf && (n == chip->last_sector ||
-					    ops->mode != MTD_OOB_AUTO)) {
-				cmd->cmd = 0;
-				if (n == chip->last_sector) {
-					cmd->src = MSM_NAND_FLASH_BUFFER +
-						chip->last_sectorsz;
-					sectoroobsize =
-						(chip->last_sector + 1) * 4;
-					if (ops->mode != MTD_OOB_AUTO)
-						sectoroobsize += 10;
-				} else {
-					cmd->src = MSM_NAND_FLASH_BUFFER + 516;
-					sectoroobsize = 10;
-				}
+				/* block on data ready, then
+				 * read the status register
+				 */
+				cmd->cmd = SRC_CRCI_NAND_DATA;
+				cmd->src = MSM_NAND_FLASH_STATUS;
+				cmd->dst = msm_virt_to_dma(chip,
+					&dma_buffer->data.page[b].result[n]);
+				/* MSM_NAND_FLASH_STATUS +
+				 * MSM_NAND_BUFFER_STATUS
+				 */
+				cmd->len = 8;
+				cmd++;
 
-				cmd->dst = oob_dma_addr_curr;
-				if (sectoroobsize < oob_len)
-					cmd->len = sectoroobsize;
-				else
-					cmd->len = oob_len;
-				oob_dma_addr_curr += cmd->len;
-				oob_len -= cmd->len;
-				if (cmd->len > 0)
+				/* read data block
+				 * (only valid if status says success)
+				 */
+				if (ops->datbuf) {
+					if (ops->mode != MTD_OOB_RAW)
+						sectordatasize =
+						    (n < chip->last_sector) ?
+						    516 : chip->last_sectorsz;
+					else
+						sectordatasize = 528;
+
+					cmd->cmd = 0;
+					cmd->src = MSM_NAND_FLASH_BUFFER;
+					cmd->dst = data_dma_addr_curr;
+					data_dma_addr_curr += sectordatasize;
+					cmd->len = sectordatasize;
 					cmd++;
+				}
+
+				if (ops->oobbuf &&
+				    (n == chip->last_sector ||
+				     ops->mode != MTD_OOB_AUTO)) {
+					cmd->cmd = 0;
+					if (n == chip->last_sector) {
+						cmd->src = MSM_NAND_FLASH_BUFFER
+							+ chip->last_sectorsz;
+						sectoroobsize =
+						   (chip->last_sector + 1) * 4;
+						if (ops->mode != MTD_OOB_AUTO)
+							sectoroobsize += 10;
+					} else {
+						cmd->src = MSM_NAND_FLASH_BUFFER
+							+ 516;
+						sectoroobsize = 10;
+					}
+
+					cmd->dst = oob_dma_addr_curr;
+					if (sectoroobsize < oob_len)
+						cmd->len = sectoroobsize;
+					else
+						cmd->len = oob_len;
+					oob_dma_addr_curr += cmd->len;
+					oob_len -= cmd->len;
+					if (cmd->len > 0)
+						cmd++;
+				}
 			}
+			oob_len_left[b] = oob_len;
 		}
 #if SUPPORT_WRONG_ECC_CONFIG
 		if (chip->saved_ecc_buf_cfg != chip->ecc_buf_cfg) {
@@ -658,7 +689,8 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 		}
 #endif
 
-		BUILD_BUG_ON(8 * 5 + 3 != ARRAY_SIZE(dma_buffer->cmd));
+		BUILD_BUG_ON(MSM_NAND_READ_BATCH * 8 * 5 + 3 !=
+			     ARRAY_SIZE(dma_buffer->cmd));
 		BUG_ON(cmd - dma_buffer->cmd > ARRAY_SIZE(dma_buffer->cmd));
 		dma_buffer->cmd[0].cmd |= CMD_OCB;
 		cmd[-1].cmd |= CMD_OCU | CMD_LC;
@@ -671,62 +703,75 @@ static int msm_nand_read_oob(struct mtd_info *mtd, loff_t from,
 			chip->dma_channel, DMOV_CMD_PTR_LIST | DMOV_CMD_ADDR(
 				msm_virt_to_dma(chip, &dma_buffer->cmdptr)));
 
-		/* if any of the writes failed (0x10), or there
-		 * was a protection violation (0x100), we lose
-		 */
-		pageerr = 0;
-		page_corrected = 0;
-		for (n = start_sector; n <= chip->last_sector; n++) {
-			uint32_t buf_stat =
-				dma_buffer->data.result[n].buffer_status;
-			if (buf_stat & BUF_STAT_UNCORRECTABLE) {
-				total_uncorrected++;
-				uncorrected[BIT_WORD(pages_read)] |=
-							BIT_MASK(pages_read);
-				pageerr = -EBADMSG;
-				break;
+		for (b = 0; b < batch; b++) {
+			/* if any of the writes failed (0x10), or there
+			 * was a protection violation (0x100), we lose
+			 */
+			pageerr = 0;
+			page_corrected = 0;
+			for (n = start_sector; n <= chip->last_sector; n++) {
+				uint32_t buf_stat = dma_buffer->data.page[b].
+						result[n].buffer_status;
+				if (buf_stat & BUF_STAT_UNCORRECTABLE) {
+					total_uncorrected++;
+					uncorrected[BIT_WORD(pages_read)] |=
+						BIT_MASK(pages_read);
+					pageerr = -EBADMSG;
+					break;
+				}
+				if (dma_buffer->data.page[b].result[n].
+				    flash_status & 0x110) {
+					pageerr = -EIO;
+					break;
+				}
+				sector_corrected =
+					buf_stat & BUF_STAT_NUM_ERRS_MASK;
+				page_corrected += sector_corrected;
+				if (sector_corrected > 1)
+					pageerr = -EUCLEAN;
 			}
-			if (dma_buffer->data.result[n].flash_status & 0x110) {
-				pageerr = -EIO;
-				break;
+			if ((!pageerr && page_corrected) ||
+			    pageerr == -EUCLEAN) {
+				total_corrected += page_corrected;
+				/* not thread safe */
+				mtd->ecc_stats.corrected += page_corrected;
 			}
-			sector_corrected =buf_stat & BUF_STAT_NUM_ERRS_MASK;
-			page_corrected += sector_corrected;
-			if (sector_corrected > 1)
-				pageerr = -EUCLEAN;
-		}
-		if ((!pageerr && page_corrected) || pageerr == -EUCLEAN) {
-			total_corrected += page_corrected;
-			/* not thread safe */
-			mtd->ecc_stats.corrected += page_corrected;
-		}
-		if (pageerr && (pageerr != -EUCLEAN || err == 0))
-			err = pageerr;
+			if (pageerr && (pageerr != -EUCLEAN || err == 0))
+				err = pageerr;
 
 #if VERBOSE
-		pr_info("status: %x %x %x %x %x %x %x %x "
-			"%x %x %x %x %x %x %x %x\n",
-			dma_buffer->data.result[0].flash_status,
-			dma_buffer->data.result[0].buffer_status,
-			dma_buffer->data.result[1].flash_status,
-			dma_buffer->data.result[1].buffer_status,
-			dma_buffer->data.result[2].flash_status,
-			dma_buffer->data.result[2].buffer_status,
-			dma_buffer->data.result[3].flash_status,
-			dma_buffer->data.result[3].buffer_status,
-			dma_buffer->data.result[4].flash_status,
-			dma_buffer->data.result[4].buffer_status,
-			dma_buffer->data.result[5].flash_status,
-			dma_buffer->data.result[5].buffer_status,
-			dma_buffer->data.result[6].flash_status,
-			dma_buffer->data.result[6].buffer_status,
-			dma_buffer->data.result[7].flash_status,
-			dma_buffer->data.result[7].buffer_status);
+			pr_info("status: %x %x %x %x %x %x %x %x "
+				"%x %x %x %x %x %x %x %x\n",
+				dma_buffer->data.page[b].result[0].flash_status,
+				dma_buffer->data.page[b].result[0].buffer_status,
+				dma_buffer->data.page[b].result[1].flash_status,
+				dma_buffer->data.page[b].result[1].buffer_status,
+				dma_buffer->data.page[b].result[2].flash_status,
+				dma_buffer->data.page[b].result[2].buffer_status,
+				dma_buffer->data.page[b].result[3].flash_status,
+				dma_buffer->data.page[b].result[3].buffer_status,
+				dma_buffer->data.page[b].result[4].flash_status,
+				dma_buffer->data.page[b].result[4].buffer_status,
+				dma_buffer->data.page[b].result[5].flash_status,
+				dma_buffer->data.page[b].result[5].buffer_status,
+				dma_buffer->data.page[b].result[6].flash_status,
+				dma_buffer->data.page[b].result[6].buffer_status,
+				dma_buffer->data.page[b].result[7].flash_status,
+				dma_buffer->data.page[b].result[7].buffer_status);
 #endif
+			if (err && err != -EUCLEAN && err != -EBADMSG) {
+				/* drop the oob of the pages chained
+				 * after the failing one
+				 */
+				oob_len = oob_len_left[b];
+				break;
+			}
+			pages_read++;
+		}
 		if (err && err != -EUCLEAN && err != -EBADMSG)
 			break;
-		pages_read++;
-		page++;
+		page += batch;
+		page_count -= batch;
 	}
 	msm_nand_release_dma_buffer(chip, dma_buffer, sizeof(*dma_buffer));
 
@@ -1642,8 +1687,8 @@ static int __devinit msm_nand_probe(struct platform_device *pdev)
 	return 0;
 
 out_free_dma_buffer:
-	dma_free_coherent(/*dev*/ NULL, SZ_4K, info->msm_nand.dma_buffer,
-			  info->msm_nand.dma_addr);
+	dma_free_coherent(/*dev*/ NULL, MSM_NAND_DMA_BUFFER_SIZE,
+			  info->msm_nand.dma_buffer, info->msm_nand.dma_addr);
 out_free_info:
 	kfree(info);
 
@@ -1665,7 +1710,7 @@ static int __devexit msm_nand_remove(struct platform_device *pdev)
 			del_mtd_device(&info->mtd);
 
 		msm_nand_release(&info->mtd);
-		dma_free_coherent(/*dev*/ NULL, SZ_4K,
+		dma_free_coherent(/*dev*/ NULL, MSM_NAND_DMA_BUFFER_SIZE,
 				  info->msm_nand.dma_buffer,
 				  info->msm_nand.dma_addr);
 		kfree(info);
@@ -36,6 +36,7 @@ MODULE_PARM_DESC(dev, "MTD device number to use");
 static struct mtd_info *mtd;
 static unsigned char *iobuf;
 static unsigned char *iobuf1;
+static unsigned char *iobuf2;
 static unsigned char *bbt;
 
 static int pgsize;
@@ -92,6 +93,34 @@ static int read_eraseblock_by_page(int ebnum)
 	return err;
 }
 
+/*
+ * Read the whole eraseblock with a single call, which lets drivers that
+ * batch multi-page reads do so, and check it matches the page-by-page
+ * read in iobuf.
+ */
+static int read_eraseblock_bulk(int ebnum)
+{
+	size_t read = 0;
+	int ret;
+	loff_t addr = ebnum * mtd->erasesize;
+
+	memset(iobuf2, 0, mtd->erasesize);
+	ret = mtd->read(mtd, addr, mtd->erasesize, &read, iobuf2);
+	if (ret == -EUCLEAN)
+		ret = 0;
+	if (ret || read != mtd->erasesize) {
+		printk(PRINT_PREF "error: bulk read failed at %#llx\n",
+		       (long long)addr);
+		return ret ? ret : -EINVAL;
+	}
+	if (memcmp(iobuf, iobuf2, mtd->erasesize)) {
+		printk(PRINT_PREF "error: bulk read mismatch at %#llx\n",
+		       (long long)addr);
+		return -EINVAL;
+	}
+	return 0;
+}
+
 static void dump_eraseblock(int ebnum)
 {
 	int i, j, n;
@@ -207,6 +236,11 @@ static int __init mtd_readtest_init(void)
 		printk(PRINT_PREF "error: cannot allocate memory\n");
 		goto out;
 	}
+	iobuf2 = kmalloc(mtd->erasesize, GFP_KERNEL);
+	if (!iobuf2) {
+		printk(PRINT_PREF "error: cannot allocate memory\n");
+		goto out;
+	}
 
 	err = scan_for_bad_eraseblocks();
 	if (err)
@@ -228,6 +262,21 @@ static int __init mtd_readtest_init(void)
 		cond_resched();
 	}
 
+	/* Read all eraseblocks in one go and compare with page reads */
+	printk(PRINT_PREF "testing multi-page read\n");
+	for (i = 0; i < ebcnt; ++i) {
+		int ret;
+
+		if (bbt[i])
+			continue;
+		ret = read_eraseblock_by_page(i);
+		if (!ret)
+			ret = read_eraseblock_bulk(i);
+		if (ret && !err)
+			err = ret;
+		cond_resched();
+	}
+
 	if (err)
 		printk(PRINT_PREF "finished with errors\n");
 	else
@@ -237,6 +286,7 @@ out:
 
 	kfree(iobuf);
 	kfree(iobuf1);
+	kfree(iobuf2);
 	kfree(bbt);
 	put_mtd_device(mtd);
 	if (err)
@@ -39,6 +39,7 @@
 #include <linux/usb/android_composite.h>
 #include <linux/usb/f_mtp.h>
 
+/* msm72k_udc takes at most 16KB (4 dTD pages) per request */
 #define BULK_BUFFER_SIZE           16384
 #define INTR_BUFFER_SIZE           28
 
@@ -53,9 +54,16 @@
 #define STATE_ERROR                 4   /* error from completion routine */
 
 /* number of tx and rx requests to allocate */
-#define TX_REQ_MAX 4
+#define TX_REQ_MAX 16
 #define RX_REQ_MAX 2
 
+/* Bulk IN queue depth, read at bind time.  More requests in flight
+ * keep the endpoint busy while mtp_send_file does the next vfs_read.
+ */
+static unsigned int mtp_tx_reqs = 8;
+module_param(mtp_tx_reqs, uint, S_IRUGO);
+MODULE_PARM_DESC(mtp_tx_reqs, "number of bulk IN requests (1-16)");
+
 /* IO Thread commands */
 #define ANDROID_THREAD_QUIT				1
 #define ANDROID_THREAD_SEND_FILE		2
@@ -398,6 +406,7 @@ static int __init create_bulk_endpoints(struct mtp_dev *dev,
 	struct usb_composite_dev *cdev = dev->cdev;
 	struct usb_request *req;
 	struct usb_ep *ep;
+	unsigned tx_reqs;
 	int i;
 
 	DBG(cdev, "create_bulk_endpoints dev: %p\n", dev);
@@ -439,7 +448,8 @@ static int __init create_bulk_endpoints(struct mtp_dev *dev,
 	dev->ep_intr = ep;
 
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < TX_REQ_MAX; i++) {
+	tx_reqs = clamp(mtp_tx_reqs, 1U, (unsigned)TX_REQ_MAX);
+	for (i = 0; i < tx_reqs; i++) {
 		req = mtp_request_new(dev->ep_in, BULK_BUFFER_SIZE);
 		if (!req)
 			goto fail;
@@ -39,6 +39,7 @@
 #include <asm/atomic.h>
 #include <mach/internal_power_rail.h>
 #include <linux/regulator/consumer.h>
+#include <linux/ktime.h>
 
 #include <linux/ashmem.h>
 
@@ -51,20 +52,17 @@
 #include "kgsl_log.h"
 //#include "kgsl_drm.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/kgsl.h>
+
 #define KGSL_MAX_PRESERVED_BUFFERS		10
 #define KGSL_MAX_SIZE_OF_PRESERVED_BUFFER	0x10000
 
 
 static void kgsl_put_phys_file(struct file *file);
 
-static int kgsl_runpending(struct kgsl_device *device)
-{
-	if (device->flags & KGSL_FLAGS_STARTED)
-		kgsl_cmdstream_memqueue_drain(device);
-
-	return KGSL_SUCCESS;
-}
-
+/* Frees are reclaimed from the timestamp interrupt, this only kicks the
+ * reclaim work in case an interrupt was missed before allocating more. */
 static void kgsl_runpending_all(void)
 {
 	struct kgsl_device *device;
@@ -72,8 +70,8 @@ static void kgsl_runpending_all(void)
 
 	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
 		device = kgsl_driver.devp[i];
-		if (device != NULL)
-			kgsl_runpending(device);
+		if (device != NULL && device->flags & KGSL_FLAGS_STARTED)
+			schedule_work(&device->reclaim_ws);
 	}
 	return;
 }
@@ -82,8 +80,6 @@ static void kgsl_clean_cache_all(struct kgsl_file_private *private)
 {
 	struct kgsl_mem_entry *entry = NULL;
 
-	kgsl_runpending_all();
-
 	list_for_each_entry(entry, &private->mem_list, list) {
 		if (KGSL_MEMFLAGS_CACHE_MASK & entry->memdesc.priv) {
 			    kgsl_cache_range_op((unsigned long)entry->
@@ -165,6 +161,8 @@ int kgsl_setstate(struct kgsl_device *device, uint32_t flags)
 	if (flags && device->ftbl.device_setstate) {
 		status = device->ftbl.device_setstate(device, flags);
 		device->mmu.tlb_flags &= ~flags;
+		if ((flags & KGSL_MMUFLAGS_TLBFLUSH) && device->mmu.hwpagetable)
+			device->mmu.tlb_gen = device->mmu.hwpagetable->tlb_gen;
 	} else
 		status = 0;
 
@@ -481,6 +479,7 @@ static int
 kgsl_init_process_private(struct kgsl_file_private *private)
 {
 	int result = 0;
+	int i;
 #ifdef CONFIG_MSM_KGSL_MMU
 	struct kgsl_device *device = NULL;
 	unsigned long pt_name;
@@ -493,6 +492,10 @@ kgsl_init_process_private(struct kgsl_file_private *private)
 	INIT_LIST_HEAD(&private->mem_list);
 	INIT_LIST_HEAD(&private->preserve_entry_list);
 	private->preserve_list_size = 0;
+	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
+		INIT_LIST_HEAD(&private->free_queue[i]);
+		INIT_LIST_HEAD(&private->reclaim_list[i]);
+	}
 
 #ifdef CONFIG_MSM_KGSL_MMU
 #ifdef CONFIG_KGSL_PER_PROCESS_PAGE_TABLE
@@ -512,6 +515,20 @@ kgsl_init_process_private(struct kgsl_file_private *private)
 static void kgsl_cleanup_process_private(struct kgsl_file_private *private)
 {
 	struct kgsl_mem_entry *entry, *entry_tmp;
+	LIST_HEAD(free_queue);
+	int i;
+
+	/* once off the reclaim lists the reclaim work can no longer reach
+	 * this process, whatever is still queued is freed right here */
+	spin_lock(&kgsl_driver.reclaim_lock);
+	for (i = 0; i < KGSL_DEVICE_MAX; i++) {
+		list_del_init(&private->reclaim_list[i]);
+		list_splice_init(&private->free_queue[i], &free_queue);
+	}
+	spin_unlock(&kgsl_driver.reclaim_lock);
+
+	list_for_each_entry_safe(entry, entry_tmp, &free_queue, free_list)
+		kgsl_remove_mem_entry(entry, false);
 
 	list_for_each_entry_safe(entry, entry_tmp, &private->mem_list, list)
 		kgsl_remove_mem_entry(entry, false);
@@ -858,8 +875,6 @@ static long kgsl_ioctl_device_waittimestamp(struct kgsl_device_private
 	result = dev_priv->device->ftbl.device_waittimestamp(dev_priv->device,
 				     param.timestamp,
 				     param.timeout);
-
-	kgsl_runpending(dev_priv->device);
 done:
 	return result;
 }
@@ -868,7 +883,8 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 				     void __user *arg)
 {
 	int result = 0;
-	struct kgsl_ringbuffer_issueibcmds param;
+	struct kgsl_ringbuffer_issueibcmds param = { 0 };
+	ktime_t start = ktime_get();
 
 	if (copy_from_user(&param, arg, sizeof(param))) {
 		result = -EFAULT;
@@ -907,6 +923,89 @@ static long kgsl_ioctl_rb_issueibcmds(struct kgsl_device_private *dev_priv,
 		goto done;
 	}
 done:
+	trace_kgsl_issueibcmds(param.drawctxt_id, 1, param.timestamp,
+			       param.flags, result,
+			       ktime_to_us(ktime_sub(ktime_get(), start)));
+	return result;
+}
+
+static long kgsl_ioctl_rb_issueiblist(struct kgsl_device_private *dev_priv,
+				      void __user *arg)
+{
+	int result = 0;
+	struct kgsl_ringbuffer_issueiblist param = { 0 };
+	struct kgsl_ibdesc *ibdesc = NULL;
+	ktime_t start = ktime_get();
+	unsigned int i;
+
+	if (copy_from_user(&param, arg, sizeof(param))) {
+		result = -EFAULT;
+		goto done;
+	}
+
+	if (!test_bit(param.drawctxt_id, dev_priv->ctxt_bitmap)) {
+		result = -EINVAL;
+		KGSL_DRV_ERR("invalid drawctxt drawctxt_id %d\n",
+				      param.drawctxt_id);
+		goto done;
+	}
+
+	if (param.numibs == 0 || param.numibs > KGSL_IBLIST_MAX) {
+		result = -EINVAL;
+		KGSL_DRV_ERR("invalid numibs %d\n", param.numibs);
+		goto done;
+	}
+
+	if (dev_priv->device->ftbl.device_issueiblist == NULL) {
+		result = -EINVAL;
+		goto done;
+	}
+
+	ibdesc = kmalloc(param.numibs * sizeof(*ibdesc), GFP_KERNEL);
+	if (ibdesc == NULL) {
+		result = -ENOMEM;
+		goto done;
+	}
+
+	if (copy_from_user(ibdesc, (void __user *)param.ibdesc_addr,
+			   param.numibs * sizeof(*ibdesc))) {
+		result = -EFAULT;
+		goto done;
+	}
+
+	for (i = 0; i < param.numibs; i++) {
+		if (ibdesc[i].gpuaddr == 0 || ibdesc[i].sizedwords == 0 ||
+		    kgsl_sharedmem_find_region(dev_priv->process_priv,
+				ibdesc[i].gpuaddr,
+				ibdesc[i].sizedwords*sizeof(uint32_t)) == NULL) {
+			KGSL_DRV_ERR("invalid cmd buffer ibaddr %08x " \
+					"sizedwords %d\n",
+					ibdesc[i].gpuaddr,
+					ibdesc[i].sizedwords);
+			result = -EINVAL;
+			goto done;
+		}
+	}
+
+	result = dev_priv->device->ftbl.device_issueiblist(dev_priv,
+					     param.drawctxt_id,
+					     ibdesc,
+					     param.numibs,
+					     &param.timestamp,
+					     param.flags);
+
+	if (result != 0)
+		goto done;
+
+	if (copy_to_user(arg, &param, sizeof(param))) {
+		result = -EFAULT;
+		goto done;
+	}
+done:
+	kfree(ibdesc);
+	trace_kgsl_issueibcmds(param.drawctxt_id, param.numibs,
+			       param.timestamp, param.flags, result,
+			       ktime_to_us(ktime_sub(ktime_get(), start)));
 	return result;
 }
 
@@ -962,8 +1061,36 @@ static long kgsl_ioctl_cmdstream_freememontimestamp(struct kgsl_device_private
 							entry,
 							param.timestamp,
 							param.type);
+done:
+	return result;
+}
+
+static long kgsl_ioctl_timestamp_fence(struct kgsl_device_private
+						*dev_priv, void __user *arg)
+{
+	int result = 0;
+	struct kgsl_timestamp_fence param;
+	struct msm_sync_fence *fence;
+
+	if (copy_from_user(&param, arg, sizeof(param))) {
+		result = -EFAULT;
+		goto done;
+	}
 
-	kgsl_runpending(dev_priv->device);
+	fence = kgsl_cmdstream_timestamp_fence(dev_priv->device,
+					       param.timestamp);
+	if (IS_ERR(fence)) {
+		result = PTR_ERR(fence);
+		goto done;
+	}
+
+	param.fence_fd = fence->fd;
+	if (copy_to_user(arg, &param, sizeof(param))) {
+		msm_sync_fence_discard(fence);
+		result = -EFAULT;
+		goto done;
+	}
+	msm_sync_fence_install(fence);
 done:
 	return result;
 }
@@ -1022,47 +1149,66 @@ done:
 	return result;
 }
 
-void kgsl_remove_mem_entry(struct kgsl_mem_entry *entry, bool preserve)
+/* Take an entry that the GPU is done with away from its process.  Small
+ * vmalloc allocations are kept mapped on the preserve list to be reused
+ * by the next allocation of the same size, in which case true is
+ * returned.  Otherwise the entry is unmapped and its memory is left for
+ * kgsl_release_mem_entry().  Caller holds kgsl_driver.reclaim_lock.
+ */
+bool kgsl_detach_mem_entry(struct kgsl_mem_entry *entry, bool preserve)
 {
-	/* If allocation is vmalloc and preserve is requested then save
-	* the allocation in a free list to be used later instead of
-	* freeing it here */
+	/* remove the entry from list and free_list if it exists */
+	if (entry->free_list.prev) {
+		list_del(&entry->free_list);
+		entry->free_list.prev = NULL;
+	}
+	if (entry->list.prev) {
+		list_del(&entry->list);
+		entry->list.prev = NULL;
+	}
+
 	if (KGSL_MEMFLAGS_VMALLOC_MEM & entry->memdesc.priv &&
 		preserve &&
 		entry->priv->preserve_list_size < KGSL_MAX_PRESERVED_BUFFERS &&
 		entry->memdesc.size <= KGSL_MAX_SIZE_OF_PRESERVED_BUFFER) {
-		if (entry->free_list.prev) {
-			list_del(&entry->free_list);
-			entry->free_list.prev = NULL;
-		}
-		if (entry->list.prev) {
-			list_del(&entry->list);
-			entry->list.prev = NULL;
-		}
 		list_add(&entry->list, &entry->priv->preserve_entry_list);
 		entry->priv->preserve_list_size++;
-		return;
+		return true;
 	}
 	kgsl_mmu_unmap(entry->memdesc.pagetable,
 			entry->memdesc.gpuaddr & KGSL_PAGEMASK,
 			entry->memdesc.size);
-	if (KGSL_MEMFLAGS_VMALLOC_MEM & entry->memdesc.priv) {
-		vfree((void *)entry->memdesc.physaddr);
+	if (KGSL_MEMFLAGS_VMALLOC_MEM & entry->memdesc.priv)
 		entry->priv->vmalloc_size -= entry->memdesc.size;
-	} else if (KGSL_MEMFLAGS_HOSTADDR & entry->memdesc.priv &&
+
+	return false;
+}
+
+/* Free the memory behind a detached entry, no lock needs to be held */
+void kgsl_release_mem_entry(struct kgsl_mem_entry *entry)
+{
+	if (KGSL_MEMFLAGS_VMALLOC_MEM & entry->memdesc.priv)
+		kgsl_sharedmem_vunmap((void *)entry->memdesc.physaddr,
+				      entry->memdesc.size);
+	else if (KGSL_MEMFLAGS_HOSTADDR & entry->memdesc.priv &&
 			entry->file_ptr)
 		put_ashmem_file(entry->file_ptr);
 	else
 		kgsl_put_phys_file(entry->file_ptr);
 
-	/* remove the entry from list and free_list if it exists */
-	if (entry->list.prev)
-		list_del(&entry->list);
-	if (entry->free_list.prev)
-		list_del(&entry->free_list);
-
 	kfree(entry);
+}
+
+void kgsl_remove_mem_entry(struct kgsl_mem_entry *entry, bool preserve)
+{
+	bool preserved;
 
+	spin_lock(&kgsl_driver.reclaim_lock);
+	preserved = kgsl_detach_mem_entry(entry, preserve);
+	spin_unlock(&kgsl_driver.reclaim_lock);
+
+	if (!preserved)
+		kgsl_release_mem_entry(entry);
 }
 
 static long kgsl_ioctl_sharedmem_free(struct kgsl_file_private *private,
@@ -1147,6 +1293,7 @@ static long kgsl_ioctl_sharedmem_from_vmalloc(struct kgsl_file_private *private,
 	}
 	len = vma->vm_end - vma->vm_start;
 
+	spin_lock(&kgsl_driver.reclaim_lock);
 	list_for_each_entry_safe(entry, entry_tmp,
 				&private->preserve_entry_list, list) {
 		/* make sure that read only pages aren't accidently
@@ -1156,10 +1303,12 @@ static long kgsl_ioctl_sharedmem_from_vmalloc(struct kgsl_file_private *private,
 		    ((entry->memdesc.priv & KGSL_MEMFLAGS_GPUREADONLY) ==
 		    (param.flags & KGSL_MEMFLAGS_GPUREADONLY))) {
 			list_del(&entry->list);
+			entry->priv->preserve_list_size--;
 			found = 1;
 			break;
 		}
 	}
+	spin_unlock(&kgsl_driver.reclaim_lock);
 
 	if (!found) {
 		entry = kzalloc(sizeof(struct kgsl_mem_entry), GFP_KERNEL);
@@ -1168,15 +1317,14 @@ static long kgsl_ioctl_sharedmem_from_vmalloc(struct kgsl_file_private *private,
 			goto error;
 		}
 
-		/* allocate memory and map it to user space */
-		vmalloc_area = vmalloc_user(len);
+		/* allocate memory and map it to user space, the pages
+		 * come zeroed and clean from the kgsl page pool */
+		vmalloc_area = kgsl_sharedmem_vmap(len);
 		if (!vmalloc_area) {
 			KGSL_MEM_ERR("vmalloc failed\n");
 			result = -ENOMEM;
 			goto error_free_entry;
 		}
-		kgsl_cache_range_op((unsigned int)vmalloc_area, len,
-			KGSL_MEMFLAGS_CACHE_INV | KGSL_MEMFLAGS_VMALLOC_MEM);
 
 		result =
 		    kgsl_mmu_map(private->pagetable,
@@ -1196,12 +1344,13 @@ static long kgsl_ioctl_sharedmem_from_vmalloc(struct kgsl_file_private *private,
 			    (param.flags & KGSL_MEMFLAGS_GPUREADONLY);
 		entry->memdesc.physaddr = (unsigned long)vmalloc_area;
 		entry->priv = private;
+		spin_lock(&kgsl_driver.reclaim_lock);
 		private->vmalloc_size += len;
+		spin_unlock(&kgsl_driver.reclaim_lock);
 
 	} else {
 		KGSL_MEM_INFO("Reusing memory entry: %x, size: %x\n",
 				(unsigned int)entry, entry->memdesc.size);
-		entry->priv->preserve_list_size--;
 		vmalloc_area = (void *)entry->memdesc.physaddr;
 	}
 
@@ -1231,7 +1380,7 @@ error_unmap_entry:
 		       entry->memdesc.size);
 
 error_free_vmalloc:
-	vfree(vmalloc_area);
+	kgsl_sharedmem_vunmap(vmalloc_area, len);
 
 error_free_entry:
 	kfree(entry);
@@ -1437,6 +1586,7 @@ static int kgsl_ioctl_map_user_mem(struct kgsl_file_private *private,
 		result = -EFAULT;
 		goto error_unmap_entry;
 	}
+	entry->priv = private;
 	list_add(&entry->list, &private->mem_list);
 	return result;
 
@@ -1525,6 +1675,7 @@ static long kgsl_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
 		break;
 
 	case IOCTL_KGSL_RINGBUFFER_ISSUEIBCMDS:
+	case IOCTL_KGSL_RINGBUFFER_ISSUEIBLIST:
 #ifdef CONFIG_MSM_KGSL_MMU
 		if (kgsl_cache_enable)
 			kgsl_clean_cache_all(dev_priv->process_priv);
@@ -1532,8 +1683,12 @@ static long kgsl_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
 #ifdef CONFIG_MSM_KGSL_DRM
 		kgsl_gpu_mem_flush(DRM_KGSL_GEM_CACHE_OP_TO_DEV);
 #endif
-		result =
-		    kgsl_ioctl_rb_issueibcmds(dev_priv, (void __user *)arg);
+		if (cmd == IOCTL_KGSL_RINGBUFFER_ISSUEIBLIST)
+			result = kgsl_ioctl_rb_issueiblist(dev_priv,
+							(void __user *)arg);
+		else
+			result = kgsl_ioctl_rb_issueibcmds(dev_priv,
+							(void __user *)arg);
 #ifdef CONFIG_MSM_KGSL_DRM
 		kgsl_gpu_mem_flush(DRM_KGSL_GEM_CACHE_OP_FROM_DEV);
 #endif
@@ -1551,6 +1706,11 @@ static long kgsl_ioctl(struct file *filep, unsigned int cmd, unsigned long arg)
 						    (void __user *)arg);
 		break;
 
+	case IOCTL_KGSL_TIMESTAMP_FENCE:
+		result = kgsl_ioctl_timestamp_fence(dev_priv,
+						    (void __user *)arg);
+		break;
+
 	case IOCTL_KGSL_DRAWCTXT_CREATE:
 		result = kgsl_ioctl_drawctxt_create(dev_priv,
 							(void __user *)arg);
@@ -1692,6 +1852,7 @@ static const struct file_operations kgsl_fops = {
 
 struct kgsl_driver kgsl_driver = {
 	.mutex = __MUTEX_INITIALIZER(kgsl_driver.mutex),
+	.reclaim_lock = __SPIN_LOCK_UNLOCKED(kgsl_driver.reclaim_lock),
 };
 
 static void kgsl_device_unregister(void)
@@ -2080,6 +2241,7 @@ static int __devinit kgsl_platform_probe(struct platform_device *pdev)
 		result = -ENOMEM;
 		goto done;
 	}
+	kgsl_mmu_selftest(kgsl_driver.global_pt);
 done:
 	if (result)
 		kgsl_driver_cleanup();
@@ -34,6 +34,7 @@
 #include <linux/platform_device.h>
 #include <linux/clk.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/cdev.h>
 #include <linux/regulator/consumer.h>
 
@@ -111,6 +112,11 @@ struct kgsl_driver {
 	struct mutex pt_mutex;
 
 	struct kgsl_pagetable *global_pt;
+
+	/* protects the per-process free queues and preserve lists, the
+	 * device reclaim lists and vmalloc_size, so that memory can be
+	 * reclaimed without holding the driver mutex */
+	spinlock_t reclaim_lock;
 };
 
 extern struct kgsl_driver kgsl_driver;
@@ -160,6 +166,8 @@ while (1) { \
 #endif
 
 void kgsl_remove_mem_entry(struct kgsl_mem_entry *entry, bool preserve);
+bool kgsl_detach_mem_entry(struct kgsl_mem_entry *entry, bool preserve);
+void kgsl_release_mem_entry(struct kgsl_mem_entry *entry);
 
 int kgsl_pwrctrl(unsigned int pwrflag);
 void kgsl_timer(unsigned long data);
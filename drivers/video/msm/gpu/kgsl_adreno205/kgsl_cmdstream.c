@@ -21,14 +21,56 @@
 #include "kgsl_sharedmem.h"
 #include "kgsl_yamato.h"
 
+static void kgsl_cmdstream_reclaim_work(struct work_struct *work);
+
+/* Runs from the timestamp interrupt of the device */
+static int kgsl_cmdstream_ts_notify(struct notifier_block *nb,
+				    unsigned long id, void *data)
+{
+	struct kgsl_device *device = container_of(nb, struct kgsl_device,
+						  ts_nb);
+	uint32_t timestamp;
+	bool fences = false;
+
+	if (device->timeline) {
+		msm_sync_timeline_signal(device->timeline,
+			device->ftbl.device_cmdstream_readtimestamp(device,
+						KGSL_TIMESTAMP_RETIRED));
+		fences = msm_sync_timeline_pending(device->timeline,
+						   &timestamp);
+	}
+
+	if (fences || !list_empty(&device->reclaim_list))
+		schedule_work(&device->reclaim_ws);
+
+	return NOTIFY_OK;
+}
+
 int kgsl_cmdstream_init(struct kgsl_device *device)
 {
-	return 0;
+	INIT_LIST_HEAD(&device->reclaim_list);
+	INIT_WORK(&device->reclaim_ws, kgsl_cmdstream_reclaim_work);
+	device->ts_nb.notifier_call = kgsl_cmdstream_ts_notify;
+
+	/* fences are optional, the device works the same without them */
+	device->timeline = msm_sync_timeline_create(
+			device->id == KGSL_DEVICE_G12 ? "kgsl-2d" : "kgsl-3d");
+	if (IS_ERR(device->timeline))
+		device->timeline = NULL;
+
+	return kgsl_register_ts_notifier(device, &device->ts_nb);
 }
 
 int kgsl_cmdstream_close(struct kgsl_device *device)
 {
-	return 0;
+	int status = kgsl_unregister_ts_notifier(device, &device->ts_nb);
+
+	if (device->timeline) {
+		msm_sync_timeline_destroy(device->timeline);
+		device->timeline = NULL;
+	}
+
+	return status;
 }
 
 uint32_t
@@ -52,43 +94,167 @@ kgsl_cmdstream_readtimestamp(struct kgsl_device *device,
 	return timestamp;
 }
 
-void kgsl_cmdstream_memqueue_drain(struct kgsl_device *device)
+/* Free every entry whose timestamp has retired from the free queues
+ * this device has, oldest first.  Only kgsl_driver.reclaim_lock is taken
+ * and only for the list walk and the pte clears, the memory itself is
+ * given back after dropping it.  Returns true, and the oldest timestamp
+ * still waited for in *pending, when some entries have not retired yet.
+ */
+static bool kgsl_cmdstream_reclaim(struct kgsl_device *device,
+				   uint32_t *pending)
 {
+	struct kgsl_file_private *private, *private_tmp;
 	struct kgsl_mem_entry *entry, *entry_tmp;
+	struct list_head *queue;
 	uint32_t ts_processed;
-	struct kgsl_ringbuffer *rb = &device->ringbuffer;
+	bool waiting = false;
+	LIST_HEAD(done);
+
+	if (list_empty(&device->reclaim_list))
+		return false;
 
 	/* get current EOP timestamp */
 	ts_processed = device->ftbl.device_cmdstream_readtimestamp(
 					device,
 					KGSL_TIMESTAMP_RETIRED);
 
-	list_for_each_entry_safe(entry, entry_tmp, &rb->memqueue, free_list) {
-		/*NOTE: this assumes that the free list is sorted by
-		 * timestamp, but I'm not yet sure that it is a valid
-		 * assumption
-		 */
-		if (!timestamp_cmp(ts_processed, entry->free_timestamp))
-			break;
-		KGSL_MEM_DBG("ts_processed %d ts_free %d gpuaddr %x)\n",
-			     ts_processed, entry->free_timestamp,
-			     entry->memdesc.gpuaddr);
-		kgsl_remove_mem_entry(entry, true);
+	spin_lock(&kgsl_driver.reclaim_lock);
+	list_for_each_entry_safe(private, private_tmp, &device->reclaim_list,
+				 reclaim_list[device->id]) {
+		queue = &private->free_queue[device->id];
+		list_for_each_entry_safe(entry, entry_tmp, queue, free_list) {
+			if (!timestamp_cmp(ts_processed,
+					   entry->free_timestamp)) {
+				if (!waiting || timestamp_cmp(*pending,
+						entry->free_timestamp))
+					*pending = entry->free_timestamp;
+				waiting = true;
+				break;
+			}
+			KGSL_MEM_DBG("ts_processed %d ts_free %d gpuaddr %x)\n",
+				     ts_processed, entry->free_timestamp,
+				     entry->memdesc.gpuaddr);
+			if (!kgsl_detach_mem_entry(entry, true))
+				list_add_tail(&entry->free_list, &done);
+		}
+		if (list_empty(queue))
+			list_del_init(&private->reclaim_list[device->id]);
 	}
+	spin_unlock(&kgsl_driver.reclaim_lock);
+
+	list_for_each_entry_safe(entry, entry_tmp, &done, free_list)
+		kgsl_release_mem_entry(entry);
+
+	return waiting;
 }
 
+static void kgsl_cmdstream_reclaim_work(struct work_struct *work)
+{
+	struct kgsl_device *device = container_of(work, struct kgsl_device,
+						  reclaim_ws);
+	uint32_t timestamp, fence_ts;
+	bool waiting;
+
+	waiting = kgsl_cmdstream_reclaim(device, &timestamp);
+	if (device->timeline &&
+	    msm_sync_timeline_pending(device->timeline, &fence_ts)) {
+		if (!waiting || timestamp_cmp(timestamp, fence_ts))
+			timestamp = fence_ts;
+		waiting = true;
+	}
+
+	if (!waiting || device->ftbl.device_request_ts_interrupt == NULL)
+		return;
+
+	/* The timestamp compare only fires once, for the lowest timestamp
+	 * armed, so arm it again for what is left.  A device that is not
+	 * started or is asleep has nothing in flight to wait for.
+	 */
+	mutex_lock(&kgsl_driver.mutex);
+	if (device->flags & KGSL_FLAGS_STARTED &&
+	    device->hwaccess_blocked == KGSL_FALSE &&
+	    device->ftbl.device_request_ts_interrupt(device, timestamp)) {
+		if (device->timeline)
+			msm_sync_timeline_signal(device->timeline,
+				device->ftbl.device_cmdstream_readtimestamp(
+					device, KGSL_TIMESTAMP_RETIRED));
+		schedule_work(&device->reclaim_ws);
+	}
+	mutex_unlock(&kgsl_driver.mutex);
+}
+
+/* Called with kgsl_driver.mutex held.  The entry is taken off the
+ * process mem_list right away, so it can no longer be looked up, and
+ * queued on the process free queue in timestamp order.
+ */
 int
 kgsl_cmdstream_freememontimestamp(struct kgsl_device *device,
 				  struct kgsl_mem_entry *entry,
 				  uint32_t timestamp,
 				  enum kgsl_timestamp_type type)
 {
-	struct kgsl_ringbuffer *rb = &device->ringbuffer;
+	struct kgsl_file_private *private = entry->priv;
+	struct list_head *queue = &private->free_queue[device->id];
+	struct kgsl_mem_entry *pos;
+
 	KGSL_MEM_DBG("enter (dev %p gpuaddr %x ts %d)\n",
 		     device, entry->memdesc.gpuaddr, timestamp);
 
-	list_add_tail(&entry->free_list, &rb->memqueue);
+	spin_lock(&kgsl_driver.reclaim_lock);
+	list_del(&entry->list);
+	entry->list.prev = NULL;
 	entry->free_timestamp = timestamp;
 
+	/* frees nearly always come in timestamp order, so look for the
+	 * insertion point from the tail */
+	list_for_each_entry_reverse(pos, queue, free_list)
+		if (timestamp_cmp(timestamp, pos->free_timestamp))
+			break;
+	list_add(&entry->free_list, &pos->free_list);
+
+	if (list_empty(&private->reclaim_list[device->id]))
+		list_add_tail(&private->reclaim_list[device->id],
+			      &device->reclaim_list);
+	spin_unlock(&kgsl_driver.reclaim_lock);
+
+	if (kgsl_check_timestamp(device, timestamp))
+		schedule_work(&device->reclaim_ws);
+	else if (device->ftbl.device_request_ts_interrupt != NULL &&
+		 device->ftbl.device_request_ts_interrupt(device, timestamp))
+		schedule_work(&device->reclaim_ws);
+
 	return 0;
 }
+
+/* Called with kgsl_driver.mutex held.  Returns a fence, not installed
+ * yet, that signals once timestamp retires, so userspace can hand the GPU
+ * work to the MDP or the rotator without waiting for it first.
+ */
+struct msm_sync_fence *
+kgsl_cmdstream_timestamp_fence(struct kgsl_device *device, uint32_t timestamp)
+{
+	struct msm_sync_fence *fence;
+	uint32_t retired;
+
+	if (device->timeline == NULL)
+		return ERR_PTR(-ENODEV);
+
+	retired = device->ftbl.device_cmdstream_readtimestamp(device,
+						KGSL_TIMESTAMP_RETIRED);
+	msm_sync_timeline_signal(device->timeline, retired);
+
+	fence = msm_sync_fence_create(device->timeline, timestamp);
+	if (IS_ERR(fence) || timestamp_cmp(retired, timestamp))
+		return fence;
+
+	/* The interrupt may have come and gone before the fence was on
+	 * the timeline, so look at the timestamp again after arming.
+	 */
+	if (device->ftbl.device_request_ts_interrupt != NULL &&
+	    device->ftbl.device_request_ts_interrupt(device, timestamp))
+		msm_sync_timeline_signal(device->timeline,
+			device->ftbl.device_cmdstream_readtimestamp(device,
+						KGSL_TIMESTAMP_RETIRED));
+
+	return fence;
+}
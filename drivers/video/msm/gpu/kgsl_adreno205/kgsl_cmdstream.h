@@ -59,8 +59,6 @@ int kgsl_cmdstream_init(struct kgsl_device *device);
 
 int kgsl_cmdstream_close(struct kgsl_device *device);
 
-void kgsl_cmdstream_memqueue_drain(struct kgsl_device *device);
-
 uint32_t
 kgsl_cmdstream_readtimestamp(struct kgsl_device *device,
 			     enum kgsl_timestamp_type type);
@@ -71,6 +69,9 @@ kgsl_cmdstream_freememontimestamp(struct kgsl_device *device,
 				  uint32_t timestamp,
 				  enum kgsl_timestamp_type type);
 
+struct msm_sync_fence *
+kgsl_cmdstream_timestamp_fence(struct kgsl_device *device, uint32_t timestamp);
+
 static inline bool timestamp_cmp(unsigned int new, unsigned int old)
 {
 	int ts_diff = new - old;
@@ -33,6 +33,8 @@
 #include <linux/irqreturn.h>
 #include <linux/wait.h>
 #include <linux/workqueue.h>
+#include <linux/notifier.h>
+#include <linux/msm_sync.h>
 #include <linux/msm_kgsl.h>
 
 #include <asm/atomic.h>
@@ -109,11 +111,19 @@ struct kgsl_functable {
 	unsigned int (*device_cmdstream_readtimestamp) (
 					struct kgsl_device *device,
 					enum kgsl_timestamp_type type);
+	int (*device_request_ts_interrupt) (struct kgsl_device *device,
+					unsigned int timestamp);
 	int (*device_issueibcmds) (struct kgsl_device_private *dev_priv,
 				int drawctxt_index,
 				uint32_t ibaddr, int sizedwords,
 				uint32_t *timestamp,
 				unsigned int flags);
+	int (*device_issueiblist) (struct kgsl_device_private *dev_priv,
+				int drawctxt_index,
+				struct kgsl_ibdesc *ibdesc,
+				unsigned int numibs,
+				uint32_t *timestamp,
+				unsigned int flags);
 	int (*device_drawctxt_create) (struct kgsl_device_private *dev_priv,
 					uint32_t flags,
 					unsigned int *drawctxt_id);
@@ -155,6 +165,14 @@ struct kgsl_device {
 	atomic_t open_count;
 
 	struct atomic_notifier_head ts_notifier_list;
+
+	/* processes with entries on free_queue[id], see kgsl_cmdstream.c */
+	struct list_head reclaim_list;
+	struct work_struct reclaim_ws;
+	struct notifier_block ts_nb;
+
+	/* retired timestamps, for the fences of IOCTL_KGSL_TIMESTAMP_FENCE */
+	struct msm_sync_timeline *timeline;
 };
 
 struct kgsl_file_private {
@@ -164,6 +182,10 @@ struct kgsl_file_private {
 	unsigned long vmalloc_size;
 	struct list_head preserve_entry_list;
 	int preserve_list_size;
+	/* entries freed on a timestamp, oldest first.  Timestamps of the
+	 * two cores do not compare, so there is one queue per device. */
+	struct list_head free_queue[KGSL_DEVICE_MAX];
+	struct list_head reclaim_list[KGSL_DEVICE_MAX];
 };
 
 struct kgsl_device_private {
@@ -116,6 +116,11 @@
 
 #define CONTEXT_SIZE		(SHADER_OFFSET + 3 * SHADER_SHADOW_SIZE)
 
+/* state moved by a register/constant and by a shader save or restore */
+#define REG_STATE_SIZE		(ALU_SHADOW_SIZE + REG_SHADOW_SIZE + \
+				 TEX_SHADOW_SIZE)
+#define SHADER_STATE_SIZE	(3 * SHADER_SHADOW_SIZE)
+
 /* temporary work structure */
 struct tmp_ctx {
 	unsigned int *start;	/* Command & Vertex buffer start */
@@ -1544,8 +1549,8 @@ int kgsl_drawctxt_destroy(struct kgsl_device *device, unsigned int drawctxt_id)
 
 	/* deactivate context */
 	if (yamato_device->drawctxt_active == drawctxt) {
-		/* no need to save GMEM or shader, the context is
-		 * being destroyed.
+		/* no need to save registers, GMEM or shader, the
+		 * context is being destroyed.
 		 */
 		drawctxt->flags &= ~(CTXT_FLAGS_GMEM_SAVE |
 				     CTXT_FLAGS_SHADER_SAVE |
@@ -1708,6 +1713,7 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 {
 	struct kgsl_drawctxt *active_ctxt = yamato_device->drawctxt_active;
 	struct kgsl_device *device = &yamato_device->dev;
+	struct kgsl_drawctxt_stats *stats = &yamato_device->ctxt_stats;
 	unsigned int cmds[2];
 
 	if (drawctxt) {
@@ -1720,17 +1726,27 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 			drawctxt->flags &= ~CTXT_FLAGS_GMEM_SAVE;
 	}
 	/* already current? */
-	if (active_ctxt == drawctxt)
+	if (active_ctxt == drawctxt) {
+		stats->skipped++;
 		return;
+	}
+	stats->switches++;
 
 	KGSL_CTXT_INFO("from %p to %p flags %d\n",
 			yamato_device->drawctxt_active, drawctxt, flags);
 	/* save old context*/
 	if (active_ctxt != NULL) {
 		KGSL_CTXT_INFO("active_ctxt flags %08x\n", active_ctxt->flags);
-		/* save registers and constants. */
-		KGSL_CTXT_DBG("save regs");
-		kgsl_ringbuffer_issuecmds(device, 0, active_ctxt->reg_save, 3);
+		/* save registers and constants, unless the context is
+		 * being destroyed and will never be restored.
+		 */
+		if (active_ctxt->flags & CTXT_FLAGS_STATE_SHADOW) {
+			KGSL_CTXT_DBG("save regs");
+			kgsl_ringbuffer_issuecmds(device, 0,
+						  active_ctxt->reg_save, 3);
+			stats->save_bytes += REG_STATE_SIZE;
+		} else
+			stats->discarded++;
 
 		if (active_ctxt->flags & CTXT_FLAGS_SHADER_SAVE) {
 			/* save shader partitioning and instructions. */
@@ -1746,6 +1762,7 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 					active_ctxt->shader_fixup, 3);
 
 			active_ctxt->flags |= CTXT_FLAGS_SHADER_RESTORE;
+			stats->save_bytes += SHADER_STATE_SIZE;
 		}
 
 		if (active_ctxt->flags & CTXT_FLAGS_GMEM_SAVE
@@ -1767,6 +1784,8 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 					kgsl_ringbuffer_issuecmds(device, 0,
 					  active_ctxt->chicken_restore, 3);
 
+					stats->save_bytes += active_ctxt->
+					  user_gmem_shadow[i].gmemshadow.size;
 					numbuffers++;
 				}
 			}
@@ -1779,6 +1798,9 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 				/* Restore TP0_CHICKEN */
 				kgsl_ringbuffer_issuecmds(device, 0,
 					 active_ctxt->chicken_restore, 3);
+
+				stats->save_bytes += active_ctxt->
+				  context_gmem_shadow.gmemshadow.size;
 			}
 
 			active_ctxt->flags |= CTXT_FLAGS_GMEM_RESTORE;
@@ -1812,6 +1834,9 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 					/* Restore TP0_CHICKEN */
 					kgsl_ringbuffer_issuecmds(device, 0,
 					  drawctxt->chicken_restore, 3);
+
+					stats->restore_bytes += drawctxt->
+					  user_gmem_shadow[i].gmemshadow.size;
 					numbuffers++;
 				}
 			}
@@ -1824,6 +1849,9 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 				/* Restore TP0_CHICKEN */
 				kgsl_ringbuffer_issuecmds(device, 0,
 				  drawctxt->chicken_restore, 3);
+
+				stats->restore_bytes += drawctxt->
+				  context_gmem_shadow.gmemshadow.size;
 			}
 			drawctxt->flags &= ~CTXT_FLAGS_GMEM_RESTORE;
 		}
@@ -1832,12 +1860,14 @@ kgsl_drawctxt_switch(struct kgsl_yamato_device *yamato_device,
 		KGSL_CTXT_DBG("restore regs");
 		kgsl_ringbuffer_issuecmds(device, 0,
 					  drawctxt->reg_restore, 3);
+		stats->restore_bytes += REG_STATE_SIZE;
 
 		/* restore shader instructions & partitioning. */
 		if (drawctxt->flags & CTXT_FLAGS_SHADER_RESTORE) {
 			KGSL_CTXT_DBG("restore shader");
 			kgsl_ringbuffer_issuecmds(device, 0,
 					  drawctxt->shader_restore, 3);
+			stats->restore_bytes += SHADER_STATE_SIZE;
 		}
 
 		cmds[0] = pm4_type3_packet(PM4_SET_BIN_BASE_OFFSET, 1);
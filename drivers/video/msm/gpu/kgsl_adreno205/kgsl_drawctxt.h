@@ -86,6 +86,15 @@ struct gmem_shadow_t {
 	struct kgsl_memdesc quad_texcoords;
 };
 
+/* context switch statistics */
+struct kgsl_drawctxt_stats {
+	unsigned int switches;	/* switches that emitted save/restore */
+	unsigned int skipped;	/* switches to the already active context */
+	unsigned int discarded;	/* saves dropped for destroyed contexts */
+	uint64_t save_bytes;	/* state copied out to the shadows */
+	uint64_t restore_bytes;	/* state copied back from the shadows */
+};
+
 struct kgsl_drawctxt {
 	uint32_t         flags;
 	struct kgsl_pagetable *pagetable;
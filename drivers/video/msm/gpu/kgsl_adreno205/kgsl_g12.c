@@ -30,6 +30,7 @@
 #include "kgsl_log.h"
 #include "kgsl_g12_drawctxt.h"
 #include "kgsl_g12_cmdstream.h"
+#include "kgsl_cmdstream.h"
 #include "kgsl_g12_cmdwindow.h"
 #include "kgsl_sharedmem.h"
 #include "kgsl_g12_vgv3types.h"
@@ -267,7 +268,7 @@ kgsl_g12_init(struct kgsl_device *device,
 	setup_timer(&device->idle_timer, kgsl_timer, (unsigned long) device);
 	INIT_WORK(&device->idle_check_ws, kgsl_idle_check);
 
-	INIT_LIST_HEAD(&device->ringbuffer.memqueue);
+	kgsl_cmdstream_init(device);
 
 	printk(KERN_INFO "kgsl mmu config 0x%x\n", config->mmu_config);
 	if (config->mmu_config) {
@@ -299,6 +300,7 @@ error_close_mmu:
 	kgsl_mmu_close(device);
 error_close_cmdstream:
 	kgsl_g12_cmdstream_close(device);
+	kgsl_cmdstream_close(device);
 error_free_irq:
 	free_irq(kgsl_driver.g12_interrupt_num, NULL);
 	kgsl_driver.g12_have_irq = 0;
@@ -321,6 +323,7 @@ int kgsl_g12_close(struct kgsl_device *device)
 	kgsl_mmu_close(device);
 
 	kgsl_g12_cmdstream_close(device);
+	kgsl_cmdstream_close(device);
 
 	if (regspace->mmio_virt_base != NULL) {
 		KGSL_MEM_INFO("iounmap(regs) = %p\n",
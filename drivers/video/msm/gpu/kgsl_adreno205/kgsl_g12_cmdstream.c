@@ -180,7 +180,7 @@ kgsl_g12_cmdstream_issueibcmds(struct kgsl_device_private *dev_priv,
 		ofs = 0;
 	}
 
-	kgsl_g12_setstate(device, device->mmu.tlb_flags);
+	kgsl_setstate(device, kgsl_mmu_tlb_flags(&device->mmu));
 
 	result = wait_event_interruptible_timeout(g12_device->wait_timestamp_wq,
 				  room_in_rb(g12_device),
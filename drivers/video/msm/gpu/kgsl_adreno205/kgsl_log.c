@@ -20,6 +20,9 @@
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
+
+#include <asm/div64.h>
 
 #include "kgsl.h"
 #include "kgsl_log.h"
@@ -452,6 +455,126 @@ static const struct file_operations kgsl_mh_debug_fops = {
 	.read = kgsl_mh_debug_read,
 };
 
+#ifdef GSL_STATS_RINGBUFFER
+static ssize_t kgsl_rb_stats_read(
+	struct file *file,
+	char __user *buff,
+	size_t buff_count,
+	loff_t *ppos)
+{
+	struct kgsl_device *device = kgsl_get_yamato_generic_device();
+	struct kgsl_rbstats *stats;
+	char buf[256];
+	int len;
+
+	if (!device)
+		return 0;
+
+	stats = &device->ringbuffer.stats;
+	len = scnprintf(buf, sizeof(buf),
+		"issues: %lld\nwords: %lld\nwaits: %lld\nwait_sleeps: %lld\n"
+		"wait_us_total: %lld\nwait_us_max: %lld\nwait_spin_us: %u\n",
+		stats->issues, stats->words_total, stats->waits,
+		stats->wait_sleeps, stats->wait_us_total, stats->wait_us_max,
+		device->ringbuffer.wait_spin_us);
+
+	return simple_read_from_buffer(buff, buff_count, ppos, buf, len);
+}
+
+static const struct file_operations kgsl_rb_stats_fops = {
+	.open = kgsl_dbgfs_open,
+	.release = kgsl_dbgfs_release,
+	.read = kgsl_rb_stats_read,
+};
+#endif /* GSL_STATS_RINGBUFFER */
+
+/* totals, plus rates over the interval since the previous read */
+static ssize_t kgsl_ctxt_stats_read(
+	struct file *file,
+	char __user *buff,
+	size_t buff_count,
+	loff_t *ppos)
+{
+	static struct kgsl_drawctxt_stats last;
+	static ktime_t last_read;
+	struct kgsl_device *device = kgsl_get_yamato_generic_device();
+	struct kgsl_drawctxt_stats stats;
+	ktime_t now = ktime_get();
+	uint64_t switches, bytes;
+	s64 interval_ms;
+	char buf[256];
+	int len;
+
+	if (*ppos || !device)
+		return 0;
+
+	mutex_lock(&kgsl_driver.mutex);
+	stats = ((struct kgsl_yamato_device *)device)->ctxt_stats;
+	mutex_unlock(&kgsl_driver.mutex);
+
+	interval_ms = ktime_to_ms(ktime_sub(now, last_read));
+	switches = bytes = 0;
+	if (last_read.tv64 && interval_ms > 0) {
+		switches = (uint64_t)(stats.switches - last.switches)
+				* MSEC_PER_SEC;
+		do_div(switches, (u32)interval_ms);
+		bytes = (stats.save_bytes + stats.restore_bytes -
+			 last.save_bytes - last.restore_bytes) * MSEC_PER_SEC;
+		do_div(bytes, (u32)interval_ms);
+	}
+	last = stats;
+	last_read = now;
+
+	len = scnprintf(buf, sizeof(buf),
+		"switches: %u\nskipped: %u\ndiscarded: %u\n"
+		"save_bytes: %llu\nrestore_bytes: %llu\n"
+		"switches/s: %llu\nbytes/s: %llu\n",
+		stats.switches, stats.skipped, stats.discarded,
+		stats.save_bytes, stats.restore_bytes, switches, bytes);
+
+	return simple_read_from_buffer(buff, buff_count, ppos, buf, len);
+}
+
+static const struct file_operations kgsl_ctxt_stats_fops = {
+	.open = kgsl_dbgfs_open,
+	.release = kgsl_dbgfs_release,
+	.read = kgsl_ctxt_stats_read,
+};
+
+static ssize_t kgsl_page_pool_read(
+	struct file *file,
+	char __user *buff,
+	size_t buff_count,
+	loff_t *ppos)
+{
+	struct kgsl_page_pool_stats stats;
+	uint64_t us_avg;
+	char buf[256];
+	int len;
+
+	if (*ppos)
+		return 0;
+
+	kgsl_page_pool_get_stats(&stats);
+	us_avg = stats.alloc_us_total;
+	if (stats.allocs)
+		do_div(us_avg, stats.allocs);
+
+	len = scnprintf(buf, sizeof(buf),
+		"pages: %u\nallocs: %u\npool_pages: %u\nnew_pages: %u\n"
+		"shrunk: %u\nalloc_us_avg: %llu\nalloc_us_max: %u\n",
+		stats.count, stats.allocs, stats.pool_pages, stats.new_pages,
+		stats.shrunk, us_avg, stats.alloc_us_max);
+
+	return simple_read_from_buffer(buff, buff_count, ppos, buf, len);
+}
+
+static const struct file_operations kgsl_page_pool_fops = {
+	.open = kgsl_dbgfs_open,
+	.release = kgsl_dbgfs_release,
+	.read = kgsl_page_pool_read,
+};
+
 #endif /* CONFIG_DEBUG_FS */
 
 int kgsl_debug_init(void)
@@ -476,6 +599,11 @@ int kgsl_debug_init(void)
 	debugfs_create_file("sx_debug", 0400, dent, 0, &kgsl_sx_debug_fops);
 	debugfs_create_file("cp_debug", 0400, dent, 0, &kgsl_cp_debug_fops);
 	debugfs_create_file("mh_debug", 0400, dent, 0, &kgsl_mh_debug_fops);
+#ifdef GSL_STATS_RINGBUFFER
+	debugfs_create_file("rb_stats", 0400, dent, 0, &kgsl_rb_stats_fops);
+#endif
+	debugfs_create_file("ctxt_stats", 0400, dent, 0, &kgsl_ctxt_stats_fops);
+	debugfs_create_file("page_pool", 0400, dent, 0, &kgsl_page_pool_fops);
 
 #ifdef CONFIG_MSM_KGSL_MMU
     debugfs_create_file("cache_enable", 0644, dent, 0,
@@ -18,7 +18,7 @@
 #include <linux/types.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
-#include <linux/genalloc.h>
+#include <linux/bitmap.h>
 #include <linux/slab.h>
 #ifdef CONFIG_MSM_KGSL_MMU
 #include <asm/pgalloc.h>
@@ -243,19 +243,15 @@ static struct kgsl_pagetable *kgsl_mmu_createpagetableobject(
 	}
 	GSL_TLBFLUSH_FILTER_RESET();
 
-	pagetable->pool = gen_pool_create(KGSL_PAGESIZE_SHIFT, -1);
-	if (pagetable->pool == NULL) {
-		KGSL_MEM_ERR("Unable to allocate virtualaddr pool.\n");
+	spin_lock_init(&pagetable->va_lock);
+	pagetable->va_pages = mmu->va_range >> KGSL_PAGESIZE_SHIFT;
+	pagetable->va_bitmap = kzalloc(BITS_TO_LONGS(pagetable->va_pages) *
+				       sizeof(unsigned long), GFP_KERNEL);
+	if (pagetable->va_bitmap == NULL) {
+		KGSL_MEM_ERR("Unable to allocate virtualaddr bitmap.\n");
 		goto err_flushfilter;
 	}
 
-	if (gen_pool_add(pagetable->pool, pagetable->va_base,
-				pagetable->va_range, -1)) {
-		KGSL_MEM_ERR("gen_pool_create failed for pagetable %p\n",
-				pagetable);
-		goto err_pool;
-	}
-
 	/* allocate page table memory */
 	status = kgsl_sharedmem_alloc_coherent(&pagetable->base,
 				      pagetable->max_entries * GSL_PTE_SIZE);
@@ -281,7 +277,7 @@ static struct kgsl_pagetable *kgsl_mmu_createpagetableobject(
 err_free_sharedmem:
 	kgsl_sharedmem_free(&pagetable->base);
 err_pool:
-	gen_pool_destroy(pagetable->pool);
+	kfree(pagetable->va_bitmap);
 err_flushfilter:
 	kfree(pagetable->tlbflushfilter.base);
 err_alloc:
@@ -301,10 +297,8 @@ static void kgsl_mmu_destroypagetable(struct kgsl_pagetable *pagetable)
 		if (pagetable->base.gpuaddr)
 			kgsl_sharedmem_free(&pagetable->base);
 
-		if (pagetable->pool) {
-			gen_pool_destroy(pagetable->pool);
-			pagetable->pool = NULL;
-		}
+		kfree(pagetable->va_bitmap);
+		pagetable->va_bitmap = NULL;
 
 		if (pagetable->tlbflushfilter.base) {
 			pagetable->tlbflushfilter.size = 0;
@@ -578,6 +572,73 @@ unsigned int kgsl_virtaddr_to_physaddr(unsigned int virtaddr)
 	return physaddr;
 }
 
+/* map count pages of physically contiguous memory starting at pte */
+static void kgsl_pt_map_set_range(struct kgsl_pagetable *pt, uint32_t pte,
+				  unsigned int count, uint32_t physaddr,
+				  uint32_t protflags)
+{
+	uint32_t *ptr = (uint32_t *)pt->base.hostptr + pte;
+	uint32_t *end = ptr + count;
+
+	physaddr |= protflags;
+	while (ptr < end) {
+		*ptr++ = physaddr;
+		physaddr += KGSL_PAGESIZE;
+	}
+}
+
+static void kgsl_pt_map_clear_range(struct kgsl_pagetable *pt, uint32_t pte,
+				    unsigned int count)
+{
+	uint32_t *ptr = (uint32_t *)pt->base.hostptr + pte;
+	uint32_t *end = ptr + count;
+
+	while (ptr < end)
+		*ptr++ = GSL_PT_PAGE_DIRTY;
+}
+
+/* Next-fit allocation of numpages of gpu virtual address space, with the
+ * first page aligned to align_mask + 1 pages.  Returns 0 on failure.
+ */
+static unsigned int kgsl_mmu_va_alloc(struct kgsl_pagetable *pagetable,
+				      unsigned int numpages,
+				      unsigned int align_mask)
+{
+	unsigned long page;
+
+	spin_lock(&pagetable->va_lock);
+
+	page = bitmap_find_next_zero_area(pagetable->va_bitmap,
+					  pagetable->va_pages,
+					  pagetable->va_next, numpages,
+					  align_mask);
+	if (page + numpages > pagetable->va_pages && pagetable->va_next)
+		page = bitmap_find_next_zero_area(pagetable->va_bitmap,
+						  pagetable->va_pages, 0,
+						  numpages, align_mask);
+	if (page + numpages > pagetable->va_pages) {
+		spin_unlock(&pagetable->va_lock);
+		return 0;
+	}
+
+	bitmap_set(pagetable->va_bitmap, page, numpages);
+	pagetable->va_next = page + numpages;
+
+	spin_unlock(&pagetable->va_lock);
+
+	return pagetable->va_base + (page << KGSL_PAGESIZE_SHIFT);
+}
+
+static void kgsl_mmu_va_free(struct kgsl_pagetable *pagetable,
+			     unsigned int gpuaddr, unsigned int numpages)
+{
+	spin_lock(&pagetable->va_lock);
+	bitmap_clear(pagetable->va_bitmap,
+		     (gpuaddr - pagetable->va_base) >> KGSL_PAGESIZE_SHIFT,
+		     numpages);
+	spin_unlock(&pagetable->va_lock);
+}
+
 int
 kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 				unsigned int address,
@@ -586,11 +647,10 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 				unsigned int *gpuaddr,
 				unsigned int flags)
 {
-	int numpages, i;
+	int numpages;
 	unsigned int pte, ptefirst, ptelast, physaddr;
-	int flushtlb, alloc_size;
+	int flushtlb;
 	unsigned int align = flags & KGSL_MEMFLAGS_ALIGN_MASK;
-	struct kgsl_device *device;
 
 	KGSL_MEM_VDBG("enter (pt=%p, physaddr=%08x, range=%08d, gpuaddr=%p)\n",
 		      pagetable, address, range, gpuaddr);
@@ -613,32 +673,19 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 			     address, range);
 		return -EINVAL;
 	}
-	alloc_size = range;
-	if (align == KGSL_MEMFLAGS_ALIGN8K)
-		alloc_size += KGSL_PAGESIZE;
+	numpages = (range >> KGSL_PAGESIZE_SHIFT);
 
-	*gpuaddr = gen_pool_alloc(pagetable->pool, alloc_size);
+	*gpuaddr = kgsl_mmu_va_alloc(pagetable, numpages,
+		(align == KGSL_MEMFLAGS_ALIGN8K) ?
+			((1 << 13) >> KGSL_PAGESIZE_SHIFT) - 1 : 0);
 	if (*gpuaddr == 0) {
-		KGSL_MEM_ERR("gen_pool_alloc failed: %d\n", alloc_size);
+		KGSL_MEM_ERR("gpu address allocation failed: %d\n", range);
 		return -ENOMEM;
 	}
 
-	if (align == KGSL_MEMFLAGS_ALIGN8K) {
-		if (*gpuaddr & ((1 << 13) - 1)) {
-			/* Not 8k aligned, align it */
-			gen_pool_free(pagetable->pool, *gpuaddr, KGSL_PAGESIZE);
-			*gpuaddr = *gpuaddr + KGSL_PAGESIZE;
-		} else
-			gen_pool_free(pagetable->pool, *gpuaddr + range,
-				      KGSL_PAGESIZE);
-	}
-
-	numpages = (range >> KGSL_PAGESIZE_SHIFT);
-
 	ptefirst = kgsl_pt_entry_get(pagetable, *gpuaddr);
 	ptelast = ptefirst + numpages;
 
-	pte = ptefirst;
 	flushtlb = 0;
 
 	/* tlb needs to be flushed when the first and last pte are not at
@@ -647,36 +694,53 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 		((ptelast + 1) & (GSL_PT_SUPER_PTE-1)) != 0)
 		flushtlb = 1;
 
-	for (pte = ptefirst; pte < ptelast; pte++) {
+	/* or when any superpte in the range was unmapped since the last
+	 * flush.  Entries can be unmapped from the reclaim work while this
+	 * runs, va_lock keeps their dirty bits from being lost.  The flush
+	 * itself is left to the next submission on a device using this
+	 * pagetable, see kgsl_mmu_tlb_flags() */
+	spin_lock(&pagetable->va_lock);
+	for (pte = ALIGN(ptefirst, GSL_PT_SUPER_PTE);
+	     !flushtlb && pte < ptelast; pte += GSL_PT_SUPER_PTE)
+		if (GSL_TLBFLUSH_FILTER_ISDIRTY(pte / GSL_PT_SUPER_PTE))
+			flushtlb = 1;
+	if (flushtlb) {
+		pagetable->tlb_gen++;
+		GSL_TLBFLUSH_FILTER_RESET();
+	}
+	spin_unlock(&pagetable->va_lock);
+
+	if (flags & KGSL_MEMFLAGS_CONPHYS) {
+		kgsl_pt_map_set_range(pagetable, ptefirst, numpages,
+				      address, protflags);
+		address += range;
+	} else {
+		for (pte = ptefirst; pte < ptelast; pte++) {
 #ifdef VERBOSE_DEBUG
-		/* check if PTE exists */
-		uint32_t val = kgsl_pt_map_getaddr(pagetable, pte);
-		BUG_ON(val != 0 && val != GSL_PT_PAGE_DIRTY);
+			/* check if PTE exists */
+			uint32_t val = kgsl_pt_map_getaddr(pagetable, pte);
+			BUG_ON(val != 0 && val != GSL_PT_PAGE_DIRTY);
 #endif
-		if ((pte & (GSL_PT_SUPER_PTE-1)) == 0)
-			if (GSL_TLBFLUSH_FILTER_ISDIRTY(pte / GSL_PT_SUPER_PTE))
-				flushtlb = 1;
-		/* mark pte as in use */
-		if (flags & KGSL_MEMFLAGS_CONPHYS)
-			physaddr = address;
-		else if (flags & KGSL_MEMFLAGS_VMALLOC_MEM) {
-			physaddr = vmalloc_to_pfn((void *)address);
-			physaddr <<= PAGE_SHIFT;
-		} else if (flags & KGSL_MEMFLAGS_HOSTADDR)
-			physaddr = kgsl_virtaddr_to_physaddr(address);
-		else
-			physaddr = 0;
-
-		if (physaddr) {
-			kgsl_pt_map_set(pagetable, pte, physaddr | protflags);
-		} else {
-			KGSL_MEM_ERR
-			("Unable to find physaddr for address: %x\n",
-			     address);
-			kgsl_mmu_unmap(pagetable, *gpuaddr, range);
-			return -EFAULT;
+			if (flags & KGSL_MEMFLAGS_VMALLOC_MEM) {
+				physaddr = vmalloc_to_pfn((void *)address);
+				physaddr <<= PAGE_SHIFT;
+			} else if (flags & KGSL_MEMFLAGS_HOSTADDR)
+				physaddr = kgsl_virtaddr_to_physaddr(address);
+			else
+				physaddr = 0;
+
+			if (physaddr) {
+				kgsl_pt_map_set(pagetable, pte,
+						physaddr | protflags);
+			} else {
+				KGSL_MEM_ERR
+				("Unable to find physaddr for address: %x\n",
+				     address);
+				kgsl_mmu_unmap(pagetable, *gpuaddr, range);
+				return -EFAULT;
+			}
+			address += KGSL_PAGESIZE;
 		}
-		address += KGSL_PAGESIZE;
 	}
 
 	KGSL_MEM_INFO("pt %p p %08x g %08x pte f %d l %d n %d f %d\n",
@@ -685,23 +749,6 @@ kgsl_mmu_map(struct kgsl_pagetable *pagetable,
 
 	mb();
 
-	/* Invalidate tlb only if current page table used by GPU is the
-	 * pagetable that we used to allocate */
-	if (flushtlb) {
-		for (i = 0; i < kgsl_driver.num_devs; i++) {
-			device = kgsl_driver.devp[i];
-			if (device != NULL) {
-				if ((device->flags & KGSL_FLAGS_INITIALIZED) &&
-				    (pagetable == device->mmu.hwpagetable)) {
-					device->mmu.tlb_flags |=
-							KGSL_MMUFLAGS_TLBFLUSH;
-				}
-			}
-		}
-		GSL_TLBFLUSH_FILTER_RESET();
-	}
-
-
 	KGSL_MEM_VDBG("return %d\n", 0);
 
 	return 0;
@@ -712,7 +759,7 @@ kgsl_mmu_unmap(struct kgsl_pagetable *pagetable, unsigned int gpuaddr,
 		int range)
 {
 	unsigned int numpages;
-	unsigned int pte, ptefirst, ptelast, superpte;
+	unsigned int ptefirst, ptelast, superpte;
 
 	KGSL_MEM_VDBG("enter (pt=%p, gpuaddr=0x%08x, range=%d)\n",
 			pagetable, gpuaddr, range);
@@ -729,23 +776,26 @@ kgsl_mmu_unmap(struct kgsl_pagetable *pagetable, unsigned int gpuaddr,
 	KGSL_MEM_INFO("pt %p gpu %08x pte first %d last %d numpages %d\n",
 		      pagetable, gpuaddr, ptefirst, ptelast, numpages);
 
-	superpte = ptefirst - (ptefirst & (GSL_PT_SUPER_PTE-1));
-	GSL_TLBFLUSH_FILTER_SETDIRTY(superpte / GSL_PT_SUPER_PTE);
-	for (pte = ptefirst; pte < ptelast; pte++) {
+	spin_lock(&pagetable->va_lock);
+	for (superpte = ptefirst / GSL_PT_SUPER_PTE;
+	     superpte <= (ptelast - 1) / GSL_PT_SUPER_PTE; superpte++)
+		GSL_TLBFLUSH_FILTER_SETDIRTY(superpte);
+	spin_unlock(&pagetable->va_lock);
+
 #ifdef VERBOSE_DEBUG
-		/* check if PTE exists */
-		BUG_ON(!kgsl_pt_map_getaddr(pagetable, pte));
-#endif
-		kgsl_pt_map_set(pagetable, pte, GSL_PT_PAGE_DIRTY);
-		superpte = pte - (pte & (GSL_PT_SUPER_PTE - 1));
-		if (pte == superpte)
-			GSL_TLBFLUSH_FILTER_SETDIRTY(superpte /
-				GSL_PT_SUPER_PTE);
+	{
+		unsigned int pte;
+
+		/* check if PTEs exist */
+		for (pte = ptefirst; pte < ptelast; pte++)
+			BUG_ON(!kgsl_pt_map_getaddr(pagetable, pte));
 	}
+#endif
+	kgsl_pt_map_clear_range(pagetable, ptefirst, numpages);
 
 	mb();
 
-	gen_pool_free(pagetable->pool, gpuaddr, range);
+	kgsl_mmu_va_free(pagetable, gpuaddr, numpages);
 
 	KGSL_MEM_VDBG("return %d\n", 0);
 
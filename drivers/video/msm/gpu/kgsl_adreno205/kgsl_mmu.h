@@ -29,6 +29,7 @@
 #ifndef __GSL_MMU_H
 #define __GSL_MMU_H
 #include <linux/types.h>
+#include <linux/spinlock.h>
 #include <linux/msm_kgsl.h>
 #include "kgsl_log.h"
 #include "kgsl_sharedmem.h"
@@ -103,11 +104,19 @@ struct kgsl_pagetable {
 	unsigned int   va_range;
 	unsigned int   last_superpte;
 	unsigned int   max_entries;
-	struct gen_pool *pool;
+	/* gpu virtual address allocator, one bit per page.  va_lock also
+	 * covers the tlb flush filter and tlb_gen, since entries can be
+	 * unmapped from the reclaim work without the driver mutex */
+	spinlock_t     va_lock;
+	unsigned long  *va_bitmap;
+	unsigned int   va_pages;
+	unsigned int   va_next;	/* where the next-fit search starts */
 	struct list_head list;
 	unsigned int name;
 	/* Maintain filter to manage tlb flushing */
 	struct kgsl_tlbflushfilter tlbflushfilter;
+	/* bumped by every mapping that needs a tlb flush */
+	unsigned int   tlb_gen;
 };
 
 struct kgsl_mmu_reg {
@@ -139,6 +148,8 @@ struct kgsl_mmu {
 	struct kgsl_pagetable  *defaultpagetable;
 	struct kgsl_pagetable  *hwpagetable;
 	unsigned int tlb_flags;
+	/* hwpagetable->tlb_gen at the last tlb flush */
+	unsigned int tlb_gen;
 };
 
 
@@ -148,6 +159,19 @@ kgsl_mmu_isenabled(struct kgsl_mmu *mmu)
 	return ((mmu)->flags & KGSL_FLAGS_STARTED) ? 1 : 0;
 }
 
+/* Flags for the kgsl_setstate() before the next submission.  Mappings
+ * only bump the pagetable's tlb generation, so any number of them
+ * collapse into a single flush when the GPU next uses the pagetable.
+ */
+static inline unsigned int
+kgsl_mmu_tlb_flags(struct kgsl_mmu *mmu)
+{
+	if (mmu->hwpagetable && mmu->hwpagetable->tlb_gen != mmu->tlb_gen)
+		return mmu->tlb_flags | KGSL_MMUFLAGS_TLBFLUSH;
+
+	return mmu->tlb_flags;
+}
+
 
 int kgsl_mmu_init(struct kgsl_device *device);
 
@@ -199,6 +223,13 @@ int kgsl_mmu_map_global(struct kgsl_pagetable *pagetable,
 			struct kgsl_memdesc *memdesc, unsigned int protflags,
 			unsigned int flags);
 
+#ifdef CONFIG_MSM_KGSL_MMU_TEST
+void kgsl_mmu_selftest(struct kgsl_pagetable *pagetable);
+#else
+static inline void kgsl_mmu_selftest(struct kgsl_pagetable *pagetable)
+{ }
+#endif
+
 int kgsl_mmu_querystats(struct kgsl_pagetable *pagetable,
 			struct kgsl_ptstats *stats);
 
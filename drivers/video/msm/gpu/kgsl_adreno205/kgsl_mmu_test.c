@@ -0,0 +1,76 @@
+/* drivers/video/msm/gpu/kgsl_adreno205/kgsl_mmu_test.c
+ *
+ * GPU pagetable map/unmap throughput test, run once at probe against the
+ * global pagetable before any device uses it.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+
+#include <asm/div64.h>
+
+#include "kgsl.h"
+#include "kgsl_mmu.h"
+
+#define TEST_KGSL_MMU_BUFFERS	4096
+
+/* 1 to 16 pages, so the address space fragments the way it does with
+ * real surfaces and command buffers */
+#define TEST_KGSL_MMU_RANGE(n)	((1 + ((n) * 7) % 16) * KGSL_PAGESIZE)
+
+void kgsl_mmu_selftest(struct kgsl_pagetable *pagetable)
+{
+	unsigned int tlb_gen = pagetable->tlb_gen;
+	unsigned int *gpuaddr;
+	ktime_t start;
+	u64 map_ns, unmap_ns;
+	int i, n;
+
+	gpuaddr = kzalloc(sizeof(*gpuaddr) * TEST_KGSL_MMU_BUFFERS,
+			  GFP_KERNEL);
+	if (!gpuaddr)
+		return;
+
+	/* The pages are never touched: nothing is submitted to the GPU
+	 * until everything has been unmapped again.
+	 */
+	start = ktime_get();
+	for (n = 0; n < TEST_KGSL_MMU_BUFFERS; n++)
+		if (kgsl_mmu_map(pagetable, pagetable->base.physaddr,
+				 TEST_KGSL_MMU_RANGE(n),
+				 GSL_PT_PAGE_RV | GSL_PT_PAGE_WV, &gpuaddr[n],
+				 KGSL_MEMFLAGS_CONPHYS | ((n & 1) ?
+				 KGSL_MEMFLAGS_ALIGN8K : KGSL_MEMFLAGS_ALIGN4K)))
+			break;
+	map_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	/* unmap every other buffer first to leave holes behind */
+	start = ktime_get();
+	for (i = 0; i < n; i += 2)
+		kgsl_mmu_unmap(pagetable, gpuaddr[i], TEST_KGSL_MMU_RANGE(i));
+	for (i = 1; i < n; i += 2)
+		kgsl_mmu_unmap(pagetable, gpuaddr[i], TEST_KGSL_MMU_RANGE(i));
+	unmap_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	if (n) {
+		do_div(map_ns, n);
+		do_div(unmap_ns, n);
+	}
+
+	pr_info("kgsl mmu test: %d buffers, %llu ns/map, %llu ns/unmap, "
+			"%u tlb flushes requested\n", n, map_ns, unmap_ns,
+			pagetable->tlb_gen - tlb_gen);
+
+	kfree(gpuaddr);
+}
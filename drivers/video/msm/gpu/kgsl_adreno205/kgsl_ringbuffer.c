@@ -17,7 +17,9 @@
  */
 #include <linux/firmware.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include <linux/wait.h>
 
 #include "kgsl.h"
@@ -97,7 +99,7 @@ void kgsl_cp_intrcallback(struct kgsl_device *device)
 			 * did not ack any interrupts this interrupt will
 			 * be generated again */
 			KGSL_DRV_WARN("Unable to read CP_INT_STATUS\n");
-			wake_up_interruptible_all(&yamato_device->ib1_wq);
+			wake_up_all(&yamato_device->ib1_wq);
 		} else
 			KGSL_DRV_WARN("Spurious interrput detected\n");
 		return;
@@ -153,7 +155,7 @@ void kgsl_cp_intrcallback(struct kgsl_device *device)
 
 	if (status & (CP_INT_CNTL__IB1_INT_MASK | CP_INT_CNTL__RB_INT_MASK)) {
 		KGSL_CMD_WARN("ringbuffer ib1/rb interrupt\n");
-		wake_up_interruptible_all(&yamato_device->ib1_wq);
+		wake_up_all(&yamato_device->ib1_wq);
 		atomic_notifier_call_chain(&(device->ts_notifier_list),
 					   KGSL_DEVICE_YAMATO,
 					   NULL);
@@ -223,12 +225,96 @@ static void kgsl_ringbuffer_submit(struct kgsl_ringbuffer *rb)
 	rb->flags |= KGSL_FLAGS_ACTIVE;
 }
 
+static int kgsl_ringbuffer_rptr_valid(struct kgsl_ringbuffer *rb,
+				      unsigned int numcmds)
+{
+	GSL_RB_GET_READPTR(rb, &rb->rptr);
+
+	return rb->rptr != 0;
+}
+
+static int kgsl_ringbuffer_has_space(struct kgsl_ringbuffer *rb,
+				     unsigned int numcmds)
+{
+	unsigned int freecmds;
+
+	GSL_RB_GET_READPTR(rb, &rb->rptr);
+	freecmds = rb->rptr - rb->wptr;
+
+	return (freecmds == 0) || (freecmds > numcmds);
+}
+
+/* Wait for the CP to advance the read pointer far enough for done().
+ * Short waits are spun out, bounded by how long recent waits took;
+ * anything longer sleeps until the oldest outstanding submission
+ * retires, since that is what frees ringbuffer space.
+ */
+static void kgsl_ringbuffer_wait(struct kgsl_ringbuffer *rb,
+	int (*done)(struct kgsl_ringbuffer *rb, unsigned int numcmds),
+	unsigned int numcmds)
+{
+	struct kgsl_device *device = rb->device;
+	struct kgsl_yamato_device *yamato_device =
+		(struct kgsl_yamato_device *) device;
+	unsigned int retired, timestamp, spin_us;
+	ktime_t start, spin_end;
+	bool slept = false;
+	s64 wait_us;
+
+	if (done(rb, numcmds))
+		return;
+
+	/* The spin budget drifts back up to GSL_RB_WAIT_SPIN_USECS on every
+	 * wait and a wait that had to sleep halves it, so it stays low
+	 * while the GPU is busy with long work but never reaches 0.
+	 */
+	spin_us = rb->wait_spin_us +
+		  (GSL_RB_WAIT_SPIN_USECS - rb->wait_spin_us) / 4;
+
+	start = ktime_get();
+	spin_end = ktime_add_us(start, spin_us);
+
+	while (!done(rb, numcmds)) {
+		if (ktime_to_ns(ktime_sub(ktime_get(), spin_end)) < 0) {
+			cpu_relax();
+			continue;
+		}
+
+		retired = device->ftbl.device_cmdstream_readtimestamp(
+				device, KGSL_TIMESTAMP_RETIRED);
+		if (timestamp_cmp(retired, rb->timestamp)) {
+			/* everything retired, rptr is about to catch up */
+			cpu_relax();
+			continue;
+		}
+		timestamp = retired + 1;
+
+		/* no dummy packet as kgsl_yamato_request_ts_interrupt()
+		 * issues, the ring is full and timestamp is still in it */
+		kgsl_yamato_arm_ts_compare(device, timestamp);
+		slept = true;
+		wait_event_timeout(yamato_device->ib1_wq,
+			kgsl_check_timestamp(device, timestamp) ||
+			done(rb, numcmds),
+			msecs_to_jiffies(GSL_RB_WAIT_TIMEOUT_MSECS));
+		GSL_RB_STATS(rb->stats.wait_sleeps++);
+	}
+
+	wait_us = ktime_to_us(ktime_sub(ktime_get(), start));
+
+	rb->wait_spin_us = slept ? spin_us / 2 : spin_us;
+
+	GSL_RB_STATS(rb->stats.waits++);
+	GSL_RB_STATS(rb->stats.wait_us_total += wait_us);
+	GSL_RB_STATS(rb->stats.wait_us_max =
+		max_t(int64_t, rb->stats.wait_us_max, wait_us));
+}
+
 static int
 kgsl_ringbuffer_waitspace(struct kgsl_ringbuffer *rb, unsigned int numcmds,
 			  int wptr_ahead)
 {
 	int nopcount;
-	unsigned int freecmds;
 	unsigned int *cmds;
 
 	KGSL_CMD_VDBG("enter (rb=%p, numcmds=%d, wptr_ahead=%d)\n",
@@ -246,9 +332,7 @@ kgsl_ringbuffer_waitspace(struct kgsl_ringbuffer *rb, unsigned int numcmds,
 		 * commands at the end of ringbuffer. We do not
 		 * want the rptr and wptr to become equal when
 		 * the ringbuffer is not empty */
-		do {
-			GSL_RB_GET_READPTR(rb, &rb->rptr);
-		} while (!rb->rptr);
+		kgsl_ringbuffer_wait(rb, kgsl_ringbuffer_rptr_valid, numcmds);
 
 		rb->wptr++;
 
@@ -258,19 +342,13 @@ kgsl_ringbuffer_waitspace(struct kgsl_ringbuffer *rb, unsigned int numcmds,
 	}
 
 	/* wait for space in ringbuffer */
-	do {
-		GSL_RB_GET_READPTR(rb, &rb->rptr);
-
-		freecmds = rb->rptr - rb->wptr;
-
-	} while ((freecmds != 0) && (freecmds <= numcmds));
+	kgsl_ringbuffer_wait(rb, kgsl_ringbuffer_has_space, numcmds);
 
 	KGSL_CMD_VDBG("return %d\n", 0);
 
 	return 0;
 }
 
-
 static unsigned int *kgsl_ringbuffer_allocspace(struct kgsl_ringbuffer *rb,
 					     unsigned int numcmds)
 {
@@ -423,6 +501,8 @@ int kgsl_ringbuffer_start(struct kgsl_ringbuffer *rb)
 	kgsl_sharedmem_set(&rb->buffer_desc, 0, 0xAA,
 				(rb->sizedwords << 2));
 
+	rb->wait_spin_us = GSL_RB_WAIT_SPIN_USECS;
+
 	kgsl_yamato_regwrite(device, REG_CP_RB_WPTR_BASE,
 			     (rb->memptrs_desc.gpuaddr
 			      + GSL_RB_MEMPTRS_WPTRPOLL_OFFSET));
@@ -487,8 +567,6 @@ int kgsl_ringbuffer_start(struct kgsl_ringbuffer *rb)
 	rb->timestamp = 0;
 	GSL_RB_INIT_TIMESTAMP(rb);
 
-	INIT_LIST_HEAD(&rb->memqueue);
-
 	/* clear ME_HALT to start micro engine */
 	kgsl_yamato_regwrite(device, REG_CP_ME_CNTL, 0);
 
@@ -557,8 +635,6 @@ int kgsl_ringbuffer_stop(struct kgsl_ringbuffer *rb)
 		/* ME_HALT */
 		kgsl_yamato_regwrite(rb->device, REG_CP_ME_CNTL, 0x10000000);
 
-		kgsl_cmdstream_memqueue_drain(rb->device);
-
 		rb->flags &= ~KGSL_FLAGS_STARTED;
 		kgsl_ringbuffer_dump(rb);
 	}
@@ -723,6 +799,34 @@ kgsl_ringbuffer_issuecmds(struct kgsl_device *device,
 	return timestamp;
 }
 
+/* Switch to the draw context and emit the indirect buffer packets in
+ * link behind a single timestamp and write pointer update.
+ */
+static int
+kgsl_ringbuffer_issuelinks(struct kgsl_device *device, int drawctxt_index,
+			   unsigned int *link, int sizedwords,
+			   uint32_t *timestamp, unsigned int flags)
+{
+	struct kgsl_yamato_device *yamato_device = (struct kgsl_yamato_device *)
+							device;
+
+	if (!(device->ringbuffer.flags & KGSL_FLAGS_STARTED) ||
+				(drawctxt_index >= KGSL_CONTEXT_MAX)) {
+		KGSL_CMD_VDBG("return %d\n", -EINVAL);
+		return -EINVAL;
+	}
+
+	kgsl_setstate(device, kgsl_mmu_tlb_flags(&device->mmu));
+
+	kgsl_drawctxt_switch(yamato_device,
+			yamato_device->drawctxt[drawctxt_index], flags);
+
+	*timestamp = kgsl_ringbuffer_addcmds(&device->ringbuffer,
+					0, link, sizedwords);
+
+	return 0;
+}
+
 int
 kgsl_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 				int drawctxt_index,
@@ -733,21 +837,13 @@ kgsl_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 {
 	unsigned int link[3];
 	struct kgsl_device *device = dev_priv->device;
-	struct kgsl_yamato_device *yamato_device = (struct kgsl_yamato_device *)
-							device;
+	int status;
 
 	KGSL_CMD_VDBG("enter (device_id=%d, drawctxt_index=%d, ibaddr=0x%08x,"
 			" sizedwords=%d, timestamp=%p)\n",
 			device->id, drawctxt_index, ibaddr,
 			sizedwords, timestamp);
 
-
-	if (!(device->ringbuffer.flags & KGSL_FLAGS_STARTED) ||
-				(drawctxt_index >= KGSL_CONTEXT_MAX)) {
-		KGSL_CMD_VDBG("return %d\n", -EINVAL);
-		return -EINVAL;
-	}
-
 	BUG_ON(ibaddr == 0);
 	BUG_ON(sizedwords == 0);
 
@@ -755,17 +851,59 @@ kgsl_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 	link[1] = ibaddr;
 	link[2] = sizedwords;
 
-	kgsl_setstate(device, device->mmu.tlb_flags);
+	status = kgsl_ringbuffer_issuelinks(device, drawctxt_index,
+					    &link[0], 3, timestamp, flags);
+	if (status != 0)
+		return status;
 
-	kgsl_drawctxt_switch(yamato_device,
-			yamato_device->drawctxt[drawctxt_index], flags);
+	KGSL_CMD_INFO("ctxt %d g %08x sd %d ts %d\n",
+			drawctxt_index, ibaddr, sizedwords, *timestamp);
 
-	*timestamp = kgsl_ringbuffer_addcmds(&device->ringbuffer,
-					0, &link[0], 3);
+	KGSL_CMD_VDBG("return %d\n", 0);
 
+	return 0;
+}
 
-	KGSL_CMD_INFO("ctxt %d g %08x sd %d ts %d\n",
-			drawctxt_index, ibaddr, sizedwords, *timestamp);
+int
+kgsl_ringbuffer_issueiblist(struct kgsl_device_private *dev_priv,
+				int drawctxt_index,
+				struct kgsl_ibdesc *ibdesc,
+				unsigned int numibs,
+				uint32_t *timestamp,
+				unsigned int flags)
+{
+	struct kgsl_device *device = dev_priv->device;
+	unsigned int *link;
+	unsigned int i;
+	int status;
+
+	KGSL_CMD_VDBG("enter (device_id=%d, drawctxt_index=%d, numibs=%d,"
+			" timestamp=%p)\n",
+			device->id, drawctxt_index, numibs, timestamp);
+
+	BUG_ON(numibs == 0 || numibs > KGSL_IBLIST_MAX);
+
+	link = kmalloc(numibs * 3 * sizeof(unsigned int), GFP_KERNEL);
+	if (link == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < numibs; i++) {
+		BUG_ON(ibdesc[i].gpuaddr == 0);
+		BUG_ON(ibdesc[i].sizedwords == 0);
+
+		link[i * 3] = PM4_HDR_INDIRECT_BUFFER_PFD;
+		link[i * 3 + 1] = ibdesc[i].gpuaddr;
+		link[i * 3 + 2] = ibdesc[i].sizedwords;
+	}
+
+	status = kgsl_ringbuffer_issuelinks(device, drawctxt_index,
+					    link, numibs * 3, timestamp, flags);
+	kfree(link);
+	if (status != 0)
+		return status;
+
+	KGSL_CMD_INFO("ctxt %d numibs %d ts %d\n",
+			drawctxt_index, numibs, *timestamp);
 
 	KGSL_CMD_VDBG("return %d\n", 0);
 
@@ -40,6 +40,12 @@
 #define GSL_RB_USE_MEM_TIMESTAMP
 #define GSL_DEVICE_SHADOW_MEMSTORE_TO_USER
 
+/* waiting for ringbuffer space: longest spin before sleeping on the
+ * timestamp interrupt, and how long to sleep before polling again in
+ * case the interrupt is missed */
+#define GSL_RB_WAIT_SPIN_USECS		50
+#define GSL_RB_WAIT_TIMEOUT_MSECS	10
+
 /* ringbuffer sizes log2quadword */
 #define GSL_RB_SIZE_8	 	0
 #define GSL_RB_SIZE_16		1
@@ -146,6 +152,10 @@ struct kgsl_rbmemptrs {
 struct kgsl_rbstats {
 	int64_t issues;
 	int64_t words_total;
+	int64_t waits;		/* allocations that found the ring full */
+	int64_t wait_sleeps;	/* times a wait slept on RB_INT */
+	int64_t wait_us_total;
+	int64_t wait_us_max;
 };
 
 
@@ -166,11 +176,11 @@ struct kgsl_ringbuffer {
 	unsigned int rptr; /* read pointer offset in dwords from baseaddr */
 	uint32_t timestamp;
 
-	/* queue of memfrees pending timestamp elapse */
-	struct list_head memqueue;
-
 	struct kgsl_rbwatchdog watchdog;
 
+	/* how long to spin for space before sleeping, in usecs */
+	unsigned int wait_spin_us;
+
 #ifdef GSL_STATS_RINGBUFFER
 	struct kgsl_rbstats stats;
 #endif /* GSL_STATS_RINGBUFFER */
@@ -245,6 +255,13 @@ int kgsl_ringbuffer_issueibcmds(struct kgsl_device_private *dev_priv,
 				uint32_t *timestamp,
 				unsigned int flags);
 
+int kgsl_ringbuffer_issueiblist(struct kgsl_device_private *dev_priv,
+				int drawctxt_index,
+				struct kgsl_ibdesc *ibdesc,
+				unsigned int numibs,
+				uint32_t *timestamp,
+				unsigned int flags);
+
 int kgsl_ringbuffer_init(struct kgsl_device *device);
 
 int kgsl_ringbuffer_start(struct kgsl_ringbuffer *rb);
@@ -21,6 +21,9 @@
 #include <linux/dma-mapping.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/highmem.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/cacheflush.h>
 
 #include "kgsl_sharedmem.h"
@@ -87,6 +90,186 @@ void kgsl_cache_range_op(unsigned long addr, int size,
 }
 
 
+/* Pages of freed vmalloc buffers are kept here for the next allocation.
+ * They are zeroed and flushed out of the caches on the way in, so they
+ * can back a cached or a writecombined buffer without any further
+ * maintenance when they are handed out again.
+ */
+#define KGSL_PAGE_POOL_MAX_PAGES	2048
+
+static struct {
+	spinlock_t lock;
+	struct list_head pages;
+	struct kgsl_page_pool_stats stats;
+} kgsl_page_pool = {
+	.lock = __SPIN_LOCK_UNLOCKED(kgsl_page_pool.lock),
+	.pages = LIST_HEAD_INIT(kgsl_page_pool.pages),
+};
+
+static void kgsl_page_clean(struct page *page)
+{
+	unsigned long physaddr = page_to_phys(page);
+	void *addr = kmap_atomic(page, KM_USER0);
+
+	clear_page(addr);
+	dmac_flush_range(addr, addr + PAGE_SIZE);
+	kunmap_atomic(addr, KM_USER0);
+	outer_flush_range(physaddr, physaddr + PAGE_SIZE);
+}
+
+static int kgsl_page_pool_shrink(struct shrinker *shrinker, int nr_to_scan,
+				 gfp_t gfp_mask)
+{
+	struct page *page, *page_tmp;
+	LIST_HEAD(pages);
+	int count;
+
+	spin_lock(&kgsl_page_pool.lock);
+	while (nr_to_scan-- > 0 && !list_empty(&kgsl_page_pool.pages)) {
+		list_move(kgsl_page_pool.pages.next, &pages);
+		kgsl_page_pool.stats.count--;
+		kgsl_page_pool.stats.shrunk++;
+	}
+	count = kgsl_page_pool.stats.count;
+	spin_unlock(&kgsl_page_pool.lock);
+
+	list_for_each_entry_safe(page, page_tmp, &pages, lru)
+		__free_page(page);
+
+	return count;
+}
+
+static struct shrinker kgsl_page_pool_shrinker = {
+	.shrink = kgsl_page_pool_shrink,
+	.seeks = DEFAULT_SEEKS,
+};
+
+void kgsl_page_pool_get_stats(struct kgsl_page_pool_stats *stats)
+{
+	spin_lock(&kgsl_page_pool.lock);
+	*stats = kgsl_page_pool.stats;
+	spin_unlock(&kgsl_page_pool.lock);
+}
+
+/* Allocate size bytes of zeroed pages, mapped contiguously in the kernel
+ * like vmalloc_user() memory, so that vmalloc_to_page() and
+ * remap_vmalloc_range() work on it.  The pages are clean in the caches.
+ */
+void *kgsl_sharedmem_vmap(size_t size)
+{
+	unsigned int i, npages = size >> PAGE_SHIFT;
+	unsigned int pooled = 0;
+	struct page **pages;
+	ktime_t start = ktime_get();
+	void *addr = NULL;
+	unsigned int us;
+
+	BUG_ON(size & (PAGE_SIZE - 1));
+
+	if (npages * sizeof(*pages) > PAGE_SIZE)
+		pages = vmalloc(npages * sizeof(*pages));
+	else
+		pages = kmalloc(npages * sizeof(*pages), GFP_KERNEL);
+	if (pages == NULL)
+		return NULL;
+
+	spin_lock(&kgsl_page_pool.lock);
+	for (; pooled < npages && !list_empty(&kgsl_page_pool.pages);
+	     pooled++) {
+		pages[pooled] = list_first_entry(&kgsl_page_pool.pages,
+						 struct page, lru);
+		list_del(&pages[pooled]->lru);
+	}
+	kgsl_page_pool.stats.count -= pooled;
+	spin_unlock(&kgsl_page_pool.lock);
+
+	for (i = pooled; i < npages; i++) {
+		pages[i] = alloc_page(GFP_KERNEL | __GFP_HIGHMEM);
+		if (pages[i] == NULL)
+			goto error;
+		kgsl_page_clean(pages[i]);
+	}
+
+	addr = vmap(pages, npages, VM_MAP | VM_USERMAP, PAGE_KERNEL);
+	if (addr == NULL)
+		goto error;
+
+	us = (unsigned int)ktime_to_us(ktime_sub(ktime_get(), start));
+
+	spin_lock(&kgsl_page_pool.lock);
+	kgsl_page_pool.stats.allocs++;
+	kgsl_page_pool.stats.pool_pages += pooled;
+	kgsl_page_pool.stats.new_pages += npages - pooled;
+	kgsl_page_pool.stats.alloc_us_total += us;
+	if (us > kgsl_page_pool.stats.alloc_us_max)
+		kgsl_page_pool.stats.alloc_us_max = us;
+	spin_unlock(&kgsl_page_pool.lock);
+	goto done;
+
+error:
+	KGSL_MEM_ERR("failed to allocate %d pages\n", npages);
+	/* the pages are all still clean, the pool can have them back */
+	spin_lock(&kgsl_page_pool.lock);
+	while (i--) {
+		list_add(&pages[i]->lru, &kgsl_page_pool.pages);
+		kgsl_page_pool.stats.count++;
+	}
+	spin_unlock(&kgsl_page_pool.lock);
+done:
+	if (npages * sizeof(*pages) > PAGE_SIZE)
+		vfree(pages);
+	else
+		kfree(pages);
+	return addr;
+}
+
+void kgsl_sharedmem_vunmap(void *addr, size_t size)
+{
+	unsigned int i, npages = size >> PAGE_SHIFT;
+	struct page *page, *page_tmp;
+	LIST_HEAD(pages);
+	unsigned int room, count = 0;
+
+	for (i = 0; i < npages; i++)
+		list_add_tail(&vmalloc_to_page(addr + i * PAGE_SIZE)->lru,
+			      &pages);
+	vunmap(addr);
+
+	spin_lock(&kgsl_page_pool.lock);
+	room = KGSL_PAGE_POOL_MAX_PAGES - kgsl_page_pool.stats.count;
+	spin_unlock(&kgsl_page_pool.lock);
+
+	/* a page still mapped into a process, see remap_vmalloc_range in
+	 * kgsl_mmap, must not be handed out again; drop our reference and
+	 * leave it to the last munmap */
+	list_for_each_entry_safe(page, page_tmp, &pages, lru) {
+		if (page_count(page) != 1 || count >= room) {
+			list_del(&page->lru);
+			put_page(page);
+			continue;
+		}
+		kgsl_page_clean(page);
+		count++;
+	}
+
+	spin_lock(&kgsl_page_pool.lock);
+	room = KGSL_PAGE_POOL_MAX_PAGES - kgsl_page_pool.stats.count;
+	list_for_each_entry_safe(page, page_tmp, &pages, lru) {
+		if (!room)
+			break;
+		list_move(&page->lru, &kgsl_page_pool.pages);
+		kgsl_page_pool.stats.count++;
+		room--;
+	}
+	spin_unlock(&kgsl_page_pool.lock);
+
+	/* whatever other frees filled the pool with meanwhile */
+	list_for_each_entry_safe(page, page_tmp, &pages, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
 /*  block alignment shift count */
 static inline unsigned int
 kgsl_memarena_get_order(uint32_t flags)
@@ -113,6 +296,8 @@ kgsl_sharedmem_init(struct kgsl_sharedmem *shmem)
 {
 	int result = -EINVAL;
 
+	register_shrinker(&kgsl_page_pool_shrinker);
+
 	shmem->baseptr = ioremap(shmem->physbase, shmem->size);
 	KGSL_MEM_INFO("ioremap(shm) = %p\n", shmem->baseptr);
 
@@ -146,6 +331,7 @@ error_iounmap:
 	iounmap(shmem->baseptr);
 	shmem->baseptr = NULL;
 error:
+	unregister_shrinker(&kgsl_page_pool_shrinker);
 	return result;
 }
 
@@ -163,6 +349,9 @@ kgsl_sharedmem_close(struct kgsl_sharedmem *shmem)
 		shmem->baseptr = NULL;
 	}
 
+	unregister_shrinker(&kgsl_page_pool_shrinker);
+	kgsl_page_pool_shrink(&kgsl_page_pool_shrinker, INT_MAX, GFP_KERNEL);
+
 	return 0;
 }
 /*
@@ -283,7 +472,7 @@ kgsl_sharedmem_vmalloc(struct kgsl_memdesc *memdesc,
 
 	size = ALIGN(size, KGSL_PAGESIZE * 2);
 
-	memdesc->hostptr = vmalloc(size);
+	memdesc->hostptr = kgsl_sharedmem_vmap(size);
 	if (memdesc->hostptr == NULL)
 		return -ENOMEM;
 
@@ -291,10 +480,6 @@ kgsl_sharedmem_vmalloc(struct kgsl_memdesc *memdesc,
 	memdesc->pagetable = pagetable;
 	memdesc->priv = KGSL_MEMFLAGS_VMALLOC_MEM | KGSL_MEMFLAGS_CACHE_CLEAN;
 
-	kgsl_cache_range_op((unsigned int) memdesc->hostptr,
-			    size, KGSL_MEMFLAGS_CACHE_INV |
-			    KGSL_MEMFLAGS_VMALLOC_MEM);
-
 	result = kgsl_mmu_map(pagetable, (unsigned long) memdesc->hostptr,
 			      memdesc->size,
 			      GSL_PT_PAGE_RV | GSL_PT_PAGE_WV,
@@ -303,7 +488,7 @@ kgsl_sharedmem_vmalloc(struct kgsl_memdesc *memdesc,
 			      KGSL_MEMFLAGS_VMALLOC_MEM);
 
 	if (result) {
-		vfree(memdesc->hostptr);
+		kgsl_sharedmem_vunmap(memdesc->hostptr, memdesc->size);
 		memset(memdesc, 0, sizeof(*memdesc));
 	}
 
@@ -326,7 +511,8 @@ kgsl_sharedmem_free(struct kgsl_memdesc *memdesc)
 					       memdesc->size);
 
 			if (memdesc->hostptr)
-				vfree(memdesc->hostptr);
+				kgsl_sharedmem_vunmap(memdesc->hostptr,
+						      memdesc->size);
 		} else if (memdesc->priv & KGSL_MEMFLAGS_CONPHYS)
 			dma_free_coherent(NULL, memdesc->size,
 					  memdesc->hostptr,
@@ -107,6 +107,20 @@ int kgsl_sharedmem_alloc(uint32_t flags, int size,
 int kgsl_sharedmem_vmalloc(struct kgsl_memdesc *memdesc,
 			   struct kgsl_pagetable *pagetable, size_t size);
 
+struct kgsl_page_pool_stats {
+	unsigned int count;		/* pages in the pool */
+	unsigned int allocs;
+	unsigned int pool_pages;	/* pages reused from the pool */
+	unsigned int new_pages;		/* pages from the page allocator */
+	unsigned int shrunk;
+	uint64_t alloc_us_total;
+	unsigned int alloc_us_max;
+};
+
+void *kgsl_sharedmem_vmap(size_t size);
+void kgsl_sharedmem_vunmap(void *addr, size_t size);
+void kgsl_page_pool_get_stats(struct kgsl_page_pool_stats *stats);
+
 static inline int
 kgsl_sharedmem_alloc_coherent(struct kgsl_memdesc *memdesc, size_t size)
 {
@@ -1000,46 +1000,79 @@ int kgsl_yamato_regwrite(struct kgsl_device *device, unsigned int offsetwords,
 	return 0;
 }
 
+/* Point the RB_INT timestamp compare at timestamp, unless it already
+ * waits for an earlier one.  Returns 1 if the compare was off and has
+ * just been turned on; it then only fires for commands issued after
+ * this, see kgsl_yamato_request_ts_interrupt().  Caller holds
+ * kgsl_driver.mutex.
+ */
+int kgsl_yamato_arm_ts_compare(struct kgsl_device *device,
+			       unsigned int timestamp)
+{
+	unsigned int ref_ts, enableflag;
+
+	kgsl_sharedmem_readl(&device->memstore, &enableflag,
+		KGSL_DEVICE_MEMSTORE_OFFSET(ts_cmp_enable));
+	rmb();
+
+	if (enableflag) {
+		kgsl_sharedmem_readl(&device->memstore, &ref_ts,
+			KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts));
+		rmb();
+		if (timestamp_cmp(ref_ts, timestamp)) {
+			kgsl_sharedmem_writel(&device->memstore,
+			KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts),
+			timestamp);
+			wmb();
+		}
+	} else {
+		kgsl_sharedmem_writel(&device->memstore,
+			KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts),
+			timestamp);
+		enableflag = 1;
+		kgsl_sharedmem_writel(&device->memstore,
+			KGSL_DEVICE_MEMSTORE_OFFSET(ts_cmp_enable),
+			enableflag);
+		wmb();
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Make sure an interrupt is raised once timestamp retires.  Returns
+ * nonzero if it has already retired, in which case nothing is armed.
+ * Caller holds kgsl_driver.mutex.
+ */
+static int kgsl_yamato_request_ts_interrupt(struct kgsl_device *device,
+					unsigned int timestamp)
+{
+	unsigned int cmds[2];
+
+	if (kgsl_check_timestamp(device, timestamp))
+		return 1;
+
+	if (kgsl_yamato_arm_ts_compare(device, timestamp)) {
+		/* submit a dummy packet so that even if all
+		* commands upto timestamp get executed we will still
+		* get an interrupt */
+		cmds[0] = pm4_type3_packet(PM4_NOP, 1);
+		cmds[1] = 0;
+		kgsl_ringbuffer_issuecmds(device, 0, &cmds[0], 2);
+	}
+
+	return 0;
+}
+
 static int kgsl_check_interrupt_timestamp(struct kgsl_device *device,
 					unsigned int timestamp)
 {
 	int status;
-	unsigned int ref_ts, enableflag;
 
 	status = kgsl_check_timestamp(device, timestamp);
 	if (!status) {
 		mutex_lock(&kgsl_driver.mutex);
-		kgsl_sharedmem_readl(&device->memstore, &enableflag,
-			KGSL_DEVICE_MEMSTORE_OFFSET(ts_cmp_enable));
-		rmb();
-
-		if (enableflag) {
-			kgsl_sharedmem_readl(&device->memstore, &ref_ts,
-				KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts));
-			rmb();
-			if (timestamp_cmp(ref_ts, timestamp)) {
-				kgsl_sharedmem_writel(&device->memstore,
-				KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts),
-				timestamp);
-				wmb();
-			}
-		} else {
-			unsigned int cmds[2];
-			kgsl_sharedmem_writel(&device->memstore,
-				KGSL_DEVICE_MEMSTORE_OFFSET(ref_wait_ts),
-				timestamp);
-			enableflag = 1;
-			kgsl_sharedmem_writel(&device->memstore,
-				KGSL_DEVICE_MEMSTORE_OFFSET(ts_cmp_enable),
-				enableflag);
-			wmb();
-			/* submit a dummy packet so that even if all
-			* commands upto timestamp get executed we will still
-			* get an interrupt */
-			cmds[0] = pm4_type3_packet(PM4_NOP, 1);
-			cmds[1] = 0;
-			kgsl_ringbuffer_issuecmds(device, 0, &cmds[0], 2);
-		}
+		kgsl_yamato_request_ts_interrupt(device, timestamp);
 		mutex_unlock(&kgsl_driver.mutex);
 	}
 
@@ -1207,7 +1240,9 @@ int kgsl_yamato_getfunctable(struct kgsl_functable *ftbl)
 	ftbl->device_getproperty = kgsl_yamato_getproperty;
 	ftbl->device_waittimestamp = kgsl_yamato_waittimestamp;
 	ftbl->device_cmdstream_readtimestamp = kgsl_cmdstream_readtimestamp;
+	ftbl->device_request_ts_interrupt = kgsl_yamato_request_ts_interrupt;
 	ftbl->device_issueibcmds = kgsl_ringbuffer_issueibcmds;
+	ftbl->device_issueiblist = kgsl_ringbuffer_issueiblist;
 	ftbl->device_drawctxt_create = kgsl_drawctxt_create;
 	ftbl->device_drawctxt_destroy = kgsl_drawctxt_destroy;
 	ftbl->device_ioctl = kgsl_yamato_ioctl;
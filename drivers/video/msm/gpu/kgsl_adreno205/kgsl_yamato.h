@@ -39,6 +39,7 @@ struct kgsl_yamato_device {
 	unsigned int      drawctxt_count;
 	struct kgsl_drawctxt *drawctxt_active;
 	struct kgsl_drawctxt *drawctxt[KGSL_CONTEXT_MAX];
+	struct kgsl_drawctxt_stats ctxt_stats;
 	wait_queue_head_t ib1_wq;
 };
 
@@ -60,4 +61,7 @@ int kgsl_yamato_regwrite(struct kgsl_device *device, unsigned int offsetwords,
 struct kgsl_device *kgsl_get_yamato_generic_device(void);
 int kgsl_yamato_getfunctable(struct kgsl_functable *ftbl);
 
+int kgsl_yamato_arm_ts_compare(struct kgsl_device *device,
+			       unsigned int timestamp);
+
 #endif /*_KGSL_YAMATO_H */
@@ -227,7 +227,8 @@ static irqreturn_t mdp_isr(int irq, void *data)
 	}
 
 #ifndef CONFIG_MSM_MDP40
-	mdp_ppp_handle_isr(mdp, status);
+	/* queued blits keep the ppp interrupt on */
+	status &= ~mdp_ppp_handle_isr(mdp, status);
 #endif
 
 #if defined (CONFIG_FB_MSM_MDP_ABL)
@@ -286,13 +287,20 @@ static irqreturn_t mdp_isr(int irq, void *data)
 
 static void mdp_do_dma_timer(unsigned long data)
 {
-	uint32_t status;
+	uint32_t status, done;
 	struct mdp_info *mdp = (struct mdp_info *) data;
 	unsigned long irq_flags=0;
 	int i;
 	spin_lock_irqsave(&mdp->lock, irq_flags);
 	status = mdp_readl(mdp, MDP_INTR_STATUS);
-	mdp_writel(mdp, mdp_irq_mask, MDP_INTR_CLEAR);
+
+	/* the timer only stands in for a stuck dma interrupt; a ppp blit
+	 * is complete only once DL0_ROI_DONE really latched, otherwise it
+	 * stays enabled for mdp_isr */
+	done = mdp_irq_mask;
+	if (!(status & DL0_ROI_DONE))
+		done &= ~DL0_ROI_DONE;
+	mdp_writel(mdp, done, MDP_INTR_CLEAR);
 
 	for (i = 0; i < MSM_MDP_NUM_INTERFACES; ++i) {
 		struct mdp_out_interface *out_if = &mdp->out_if[i];
@@ -309,10 +317,11 @@ static void mdp_do_dma_timer(unsigned long data)
 		}
 	}
 
-	if (mdp_irq_mask & DL0_ROI_DONE)
-		mdp_ppp_handle_isr(mdp, DL0_ROI_DONE);
+	if (done & DL0_ROI_DONE)
+		done &= ~mdp_ppp_handle_isr(mdp, DL0_ROI_DONE);
 
-	locked_disable_mdp_irq(mdp, mdp_irq_mask);
+	if (done)
+		locked_disable_mdp_irq(mdp, done);
 
 	spin_unlock_irqrestore(&mdp->lock, irq_flags);
 
@@ -692,6 +701,17 @@ int mdp_blit(struct mdp_device *mdp_dev, struct fb_info *fb,
 	return mdp_ppp_blit(mdp, fb, req);
 }
 
+#ifdef CONFIG_FB_MSM_MDP_PPP
+static struct msm_sync_fence *mdp_blit_async(struct mdp_device *mdp_dev,
+					     struct fb_info *fb,
+					     struct mdp_blit_req *reqs,
+					     int count)
+{
+	struct mdp_info *mdp = container_of(mdp_dev, struct mdp_info, mdp_dev);
+	return mdp_ppp_blit_async(mdp, fb, reqs, count);
+}
+#endif
+
 
 
 #if defined (CONFIG_FB_MSM_MDP_ABL)
@@ -1141,6 +1161,9 @@ int mdp_probe(struct platform_device *pdev)
 	mdp->mdp_dev.dma = mdp_dma;
 	mdp->mdp_dev.dma_wait = mdp_dma_wait;
 	mdp->mdp_dev.blit = mdp_blit;
+#ifdef CONFIG_FB_MSM_MDP_PPP
+	mdp->mdp_dev.blit_async = mdp_blit_async;
+#endif
 #ifdef CONFIG_FB_MSM_OVERLAY
 	mdp->mdp_dev.overlay_get = mdp4_overlay_get;
 	mdp->mdp_dev.overlay_set = mdp4_overlay_set;
@@ -147,6 +147,7 @@ int mdp_hw_init(struct mdp_info *mdp)
 			   csc_matrix_config_table[n].reg);
 
 	mdp_ppp_init_scale(mdp);
+	mdp_ppp_init(mdp);
 
 #ifndef CONFIG_MSM_MDP31
 	mdp_writel(mdp, 0x04000400, MDP_COMMAND_CONFIG);
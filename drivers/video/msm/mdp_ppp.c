@@ -18,9 +18,17 @@
 #include <linux/major.h>
 #include <linux/msm_hw3d.h>
 #include <linux/msm_mdp.h>
+#include <linux/msm_sync.h>
 #include <linux/mutex.h>
 #include <linux/android_pmem.h>
 #include <linux/wait.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/timer.h>
+#include <linux/workqueue.h>
+#include <linux/debugfs.h>
+#include <linux/moduleparam.h>
 #include <mach/msm_fb.h>
 
 #include "mdp_hw.h"
@@ -460,7 +468,7 @@ int mdp_get_bytes_per_pixel(int format)
 
 static int send_blit(const struct mdp_info *mdp, struct mdp_blit_req *req,
 		     struct ppp_regs *regs, struct file *src_file,
-		     struct file *dst_file)
+		     struct file *dst_file, bool flush)
 {
 #if 0
 	mdp_writel_dbg(mdp, 1, MDP_PPP_CMD_MODE);
@@ -512,7 +520,8 @@ static int send_blit(const struct mdp_info *mdp, struct mdp_blit_req *req,
 			       MDP_PPP_BLEND_BG_ALPHA_SEL);
 #endif
 	}
-	flush_imgs(req, regs, src_file, dst_file);
+	if (flush)
+		flush_imgs(req, regs, src_file, dst_file);
 	mdp_writel_dbg(mdp, 0x1000, MDP_DISPLAY0_START);
 	return 0;
 }
@@ -538,17 +547,16 @@ static void mdp_dump_blit(struct mdp_blit_req *req)
 }
 #endif
 
-static int process_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
-		 struct file *src_file, unsigned long src_start, unsigned long src_len,
-		 struct file *dst_file, unsigned long dst_start, unsigned long dst_len)
+/* Check req against its images and work out the addresses, without
+ * touching the hardware, so queued blits can be checked up front.
+ */
+static int check_blit(struct mdp_blit_req *req,
+		      unsigned long src_start, unsigned long src_len,
+		      unsigned long dst_start, unsigned long dst_len,
+		      struct ppp_regs *regs)
 {
-	struct ppp_regs regs = {0};
 	uint32_t luma_base;
 
-#if PPP_DUMP_BLITS
-	mdp_dump_blit(req);
-#endif
-
 	if (unlikely(req->src.format >= MDP_IMGTYPE_LIMIT ||
 		     req->dst.format >= MDP_IMGTYPE_LIMIT)) {
 		printk(KERN_ERR "mdp_ppp: img is of wrong format\n");
@@ -572,42 +580,62 @@ static int process_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
 	}
 
 	/* set the src image configuration */
-	regs.src_cfg = src_img_cfg[req->src.format];
-	regs.src_cfg |= (req->src_rect.x & 0x1) ? PPP_SRC_BPP_ROI_ODD_X : 0;
-	regs.src_cfg |= (req->src_rect.y & 0x1) ? PPP_SRC_BPP_ROI_ODD_Y : 0;
-	regs.src_pack = pack_pattern[req->src.format];
+	regs->src_cfg = src_img_cfg[req->src.format];
+	regs->src_cfg |= (req->src_rect.x & 0x1) ? PPP_SRC_BPP_ROI_ODD_X : 0;
+	regs->src_cfg |= (req->src_rect.y & 0x1) ? PPP_SRC_BPP_ROI_ODD_Y : 0;
+	regs->src_pack = pack_pattern[req->src.format];
 
 	/* set the dest image configuration */
-	regs.dst_cfg = dst_img_cfg[req->dst.format] | PPP_DST_OUT_SEL_AXI;
-	regs.dst_pack = pack_pattern[req->dst.format];
+	regs->dst_cfg = dst_img_cfg[req->dst.format] | PPP_DST_OUT_SEL_AXI;
+	regs->dst_pack = pack_pattern[req->dst.format];
 
 	/* set src, bpp, start pixel and ystride */
-	regs.src_bpp = mdp_get_bytes_per_pixel(req->src.format);
+	regs->src_bpp = mdp_get_bytes_per_pixel(req->src.format);
 	luma_base = src_start + req->src.offset;
-	regs.src0 = luma_base +
-		get_luma_offset(&req->src, &req->src_rect, regs.src_bpp);
-	regs.src1 = get_chroma_base(&req->src, luma_base, regs.src_bpp);
-	regs.src1 += get_chroma_offset(&req->src, &req->src_rect, regs.src_bpp);
-	regs.src_ystride = req->src.width * regs.src_bpp;
-	set_src_region(&req->src, &req->src_rect, &regs);
+	regs->src0 = luma_base +
+		get_luma_offset(&req->src, &req->src_rect, regs->src_bpp);
+	regs->src1 = get_chroma_base(&req->src, luma_base, regs->src_bpp);
+	regs->src1 += get_chroma_offset(&req->src, &req->src_rect,
+				       regs->src_bpp);
+	regs->src_ystride = req->src.width * regs->src_bpp;
+	set_src_region(&req->src, &req->src_rect, regs);
 
 	/* set dst, bpp, start pixel and ystride */
-	regs.dst_bpp = mdp_get_bytes_per_pixel(req->dst.format);
+	regs->dst_bpp = mdp_get_bytes_per_pixel(req->dst.format);
 	luma_base = dst_start + req->dst.offset;
-	regs.dst0 = luma_base +
-		get_luma_offset(&req->dst, &req->dst_rect, regs.dst_bpp);
-	regs.dst1 = get_chroma_base(&req->dst, luma_base, regs.dst_bpp);
-	regs.dst1 += get_chroma_offset(&req->dst, &req->dst_rect, regs.dst_bpp);
-	regs.dst_ystride = req->dst.width * regs.dst_bpp;
-	set_dst_region(&req->dst_rect, &regs);
+	regs->dst0 = luma_base +
+		get_luma_offset(&req->dst, &req->dst_rect, regs->dst_bpp);
+	regs->dst1 = get_chroma_base(&req->dst, luma_base, regs->dst_bpp);
+	regs->dst1 += get_chroma_offset(&req->dst, &req->dst_rect,
+				       regs->dst_bpp);
+	regs->dst_ystride = req->dst.width * regs->dst_bpp;
+	set_dst_region(&req->dst_rect, regs);
 
 	if (!valid_src_dst(src_start, src_len, dst_start, dst_len, req,
-			   &regs)) {
+			   regs)) {
 		printk(KERN_ERR "mdp_ppp: final src or dst location is "
 			"invalid, are you trying to make an image too large "
 			"or to place it outside the screen?\n");
 		return -EINVAL;
 	}
+	return 0;
+}
+
+static int process_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
+		 struct file *src_file, unsigned long src_start, unsigned long src_len,
+		 struct file *dst_file, unsigned long dst_start, unsigned long dst_len,
+		 bool flush)
+{
+	struct ppp_regs regs = {0};
+	int ret;
+
+#if PPP_DUMP_BLITS
+	mdp_dump_blit(req);
+#endif
+
+	ret = check_blit(req, src_start, src_len, dst_start, dst_len, &regs);
+	if (ret)
+		return ret;
 
 	/* set up operation register */
 	regs.op = 0;
@@ -646,7 +674,7 @@ static int process_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
 #if PPP_DUMP_BLITS
 	pr_info("%s: sending blit\n", __func__);
 #endif
-	send_blit(mdp, req, &regs, src_file, dst_file);
+	send_blit(mdp, req, &regs, src_file, dst_file, flush);
 	return 0;
 }
 
@@ -677,17 +705,20 @@ static int mdp_ppp_wait(struct mdp_info *mdp)
 	return ret;
 }
 
+/* vaddr is set to a kernel mapping of the image when there is one */
 static int get_img(struct mdp_img *img, struct fb_info *info,
 		   unsigned long *start, unsigned long *len,
-		   struct file** filep)
+		   struct file** filep, void **vaddr)
 {
 	int put_needed, ret = 0;
 	struct file *file;
 	unsigned long vstart;
 
-	if (!get_pmem_file(img->memory_id, start, &vstart, len, filep))
+	*vaddr = NULL;
+	if (!get_pmem_file(img->memory_id, start, &vstart, len, filep)) {
+		*vaddr = (void *)vstart;
 		return 0;
-	else if (!get_msm_hw3d_file(img->memory_id, &img->offset, start, len,
+	} else if (!get_msm_hw3d_file(img->memory_id, &img->offset, start, len,
 				    filep))
 		return 0;
 
@@ -698,6 +729,7 @@ static int get_img(struct mdp_img *img, struct fb_info *info,
 	if (MAJOR(file->f_dentry->d_inode->i_rdev) == FB_MAJOR) {
 		*start = info->fix.smem_start;
 		*len = info->fix.smem_len;
+		*vaddr = info->screen_base;
 		ret = 0;
 	} else
 		ret = -1;
@@ -744,14 +776,304 @@ static void dump_req(struct mdp_blit_req *req,
 	pr_err("dst_rect.h: %d\n",      req->dst_rect.h);
 }
 
+/* Blits queued by mdp_ppp_blit_async.  Each request is split into
+ * regions by mdp_ppp_do_blit, checked and its images pinned and flushed
+ * at submit time, and the regions are then programmed one after the other
+ * from the DL0_ROI_DONE interrupt.  The last region of a batch moves the
+ * timeline to the batch sequence number, signaling its fence.
+ */
+struct ppp_job {
+	struct list_head list;
+	struct mdp_blit_req req;
+	struct file *src_file;
+	struct file *dst_file;
+	unsigned long src_start, src_len;
+	unsigned long dst_start, dst_len;
+	bool put_imgs;		/* last region of a request */
+	bool signal;		/* last region of a batch */
+	uint32_t seq;
+	ktime_t queued;
+	ktime_t started;
+};
+
+#define PPP_QUEUE_HISTORY	32
+
+struct ppp_timing {
+	uint32_t seq;
+	uint32_t flags;
+	uint16_t w, h;
+	int result;
+	s64 wait_us;		/* queued until programmed */
+	s64 run_us;		/* programmed until done */
+};
+
+struct ppp_queue {
+	spinlock_t lock;
+	struct list_head pending;	/* head is in the hardware if busy */
+	struct list_head done;		/* images still to put */
+	bool busy;
+	wait_queue_head_t idle_wq;
+	struct timer_list timer;
+	struct work_struct done_work;
+	struct mdp_info *mdp;
+	struct msm_sync_timeline *timeline;
+	uint32_t seq;
+
+	/* for debugfs, protected by lock */
+	struct ppp_timing history[PPP_QUEUE_HISTORY];
+	unsigned int history_next;
+	unsigned long batches;
+	unsigned long regions;
+	unsigned long errors;
+	unsigned long sw_blits;
+	s64 run_us_total;
+	s64 run_us_max;
+};
+
+static void ppp_queue_timeout(unsigned long data);
+static void ppp_queue_done_work(struct work_struct *work);
+
+static struct ppp_queue ppp_queue = {
+	.lock = __SPIN_LOCK_UNLOCKED(ppp_queue.lock),
+	.pending = LIST_HEAD_INIT(ppp_queue.pending),
+	.done = LIST_HEAD_INIT(ppp_queue.done),
+	.idle_wq = __WAIT_QUEUE_HEAD_INITIALIZER(ppp_queue.idle_wq),
+	.timer = TIMER_INITIALIZER(ppp_queue_timeout, 0, 0),
+	.done_work = __WORK_INITIALIZER(ppp_queue.done_work,
+					ppp_queue_done_work),
+};
+
+/* while mdp_ppp_blit_async runs mdp_ppp_do_blit, the regions it is split
+ * into go on this list instead of to the hardware; mdp_mutex held */
+static struct list_head *ppp_collect;
+
+static int ppp_queue_region(struct mdp_blit_req *req,
+		struct file *src_file, unsigned long src_start,
+		unsigned long src_len, struct file *dst_file,
+		unsigned long dst_start, unsigned long dst_len)
+{
+	struct ppp_regs regs = {0};
+	struct ppp_job *job;
+	int ret;
+
+	ret = check_blit(req, src_start, src_len, dst_start, dst_len, &regs);
+	if (ret)
+		return ret;
+
+	job = kzalloc(sizeof(*job), GFP_KERNEL);
+	if (!job)
+		return -ENOMEM;
+
+	job->req = *req;
+	job->src_file = src_file;
+	job->src_start = src_start;
+	job->src_len = src_len;
+	job->dst_file = dst_file;
+	job->dst_start = dst_start;
+	job->dst_len = dst_len;
+
+	/* nothing else touches the images until the fence signals */
+	flush_imgs(req, &regs, src_file, dst_file);
+
+	list_add_tail(&job->list, ppp_collect);
+	return 0;
+}
+
+/* Called with ppp_queue.lock held */
+static void ppp_job_done(struct ppp_job *job, int result)
+{
+	struct ppp_timing *t;
+	ktime_t now = ktime_get();
+
+	t = &ppp_queue.history[ppp_queue.history_next++ % PPP_QUEUE_HISTORY];
+	t->seq = job->seq;
+	t->flags = job->req.flags;
+	t->w = job->req.dst_rect.w;
+	t->h = job->req.dst_rect.h;
+	t->result = result;
+	t->wait_us = ktime_to_us(ktime_sub(job->started, job->queued));
+	t->run_us = ktime_to_us(ktime_sub(now, job->started));
+
+	ppp_queue.regions++;
+	if (result)
+		ppp_queue.errors++;
+	ppp_queue.run_us_total += t->run_us;
+	if (t->run_us > ppp_queue.run_us_max)
+		ppp_queue.run_us_max = t->run_us;
+
+	if (job->signal)
+		msm_sync_timeline_signal(ppp_queue.timeline, job->seq);
+
+	list_move_tail(&job->list, &ppp_queue.done);
+	schedule_work(&ppp_queue.done_work);
+}
+
+/* Program the first pending region.  A region failing the checks that
+ * need the hardware is completed right away and the next one tried.
+ * Returns false once nothing is left.  Called with ppp_queue.lock held.
+ */
+static bool ppp_queue_run(struct mdp_info *mdp)
+{
+	struct ppp_job *job;
+	int ret;
+
+	while (!list_empty(&ppp_queue.pending)) {
+		job = list_first_entry(&ppp_queue.pending, struct ppp_job,
+				       list);
+		job->started = ktime_get();
+		mdp->req = &job->req;
+		ret = process_blit(mdp, &job->req,
+				   job->src_file, job->src_start, job->src_len,
+				   job->dst_file, job->dst_start, job->dst_len,
+				   false);
+		if (!ret) {
+			mod_timer(&ppp_queue.timer, jiffies + HZ);
+			return true;
+		}
+		ppp_job_done(job, ret);
+	}
+	return false;
+}
+
+static void ppp_queue_timeout(unsigned long data)
+{
+	struct ppp_job *job;
+	unsigned long flags;
+
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	if (ppp_queue.busy) {
+		job = list_first_entry(&ppp_queue.pending, struct ppp_job,
+				       list);
+		printk(KERN_ERR "mdp_ppp: queued blit %u timed out\n",
+		       job->seq);
+		mdp_ppp_dump_debug(ppp_queue.mdp);
+		dump_req(&job->req, job->src_start, job->src_len,
+			 job->dst_start, job->dst_len);
+		BUG();
+	}
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+}
+
+static void ppp_queue_done_work(struct work_struct *work)
+{
+	struct ppp_job *job, *job_tmp;
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	list_splice_init(&ppp_queue.done, &done);
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+
+	list_for_each_entry_safe(job, job_tmp, &done, list) {
+		if (job->put_imgs) {
+			put_img(job->src_file);
+			put_img(job->dst_file);
+		}
+		kfree(job);
+	}
+}
+
+static void ppp_queue_free(struct list_head *jobs)
+{
+	struct ppp_job *job, *job_tmp;
+
+	list_for_each_entry_safe(job, job_tmp, jobs, list) {
+		if (job->put_imgs) {
+			put_img(job->src_file);
+			put_img(job->dst_file);
+		}
+		kfree(job);
+	}
+}
+
+#ifdef CONFIG_FB_MSM_MDP_PPP_SW
+/* Blits up to this many destination pixels are done on the CPU when the
+ * PPP would first have to finish the queue or leave standby */
+static int ppp_sw_max_pixels = 64 * 64;
+module_param_named(sw_max_pixels, ppp_sw_max_pixels, int, S_IRUGO | S_IWUSR);
+
+/* Called with ppp_queue.lock held */
+static bool ppp_queue_uses(unsigned long start, unsigned long len)
+{
+	struct ppp_job *job;
+
+	list_for_each_entry(job, &ppp_queue.pending, list) {
+		if (start < job->src_start + job->src_len &&
+		    job->src_start < start + len)
+			return true;
+		if (start < job->dst_start + job->dst_len &&
+		    job->dst_start < start + len)
+			return true;
+	}
+	return false;
+}
+
+/* Do req on the CPU if it is worth it.  Returns -EAGAIN if the PPP should
+ * do it instead.  Called with mdp_mutex held, so nothing is added to the
+ * queue meanwhile.
+ */
+static int ppp_sw_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
+		struct file *src_file, unsigned long src_start,
+		unsigned long src_len, void *src_vaddr,
+		struct file *dst_file, unsigned long dst_start,
+		unsigned long dst_len, void *dst_vaddr)
+{
+	struct ppp_regs regs = {0};
+	unsigned long flags;
+	bool busy, conflict;
+	int ret;
+
+	if (!src_vaddr || !dst_vaddr || src_start == dst_start ||
+	    req->dst_rect.w * req->dst_rect.h > ppp_sw_max_pixels ||
+	    !mdp_ppp_sw_supported(req))
+		return -EAGAIN;
+
+	/* only go around queued blits that leave these images alone */
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	busy = ppp_queue.busy;
+	conflict = busy && (ppp_queue_uses(src_start, src_len) ||
+			    ppp_queue_uses(dst_start, dst_len));
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+	if (conflict || (!busy && !(mdp->state & MDP_STATE_STANDBY)))
+		return -EAGAIN;
+
+	ret = check_blit(req, src_start, src_len, dst_start, dst_len, &regs);
+	if (ret)
+		return ret;
+
+	flush_imgs(req, &regs, src_file, dst_file);
+	mdp_ppp_sw_blit(req, src_vaddr, dst_vaddr);
+	flush_imgs(req, &regs, NULL, dst_file);
+
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	ppp_queue.sw_blits++;
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+	return 0;
+}
+#else
+static inline int ppp_sw_blit(struct mdp_info *mdp, struct mdp_blit_req *req,
+		struct file *src_file, unsigned long src_start,
+		unsigned long src_len, void *src_vaddr,
+		struct file *dst_file, unsigned long dst_start,
+		unsigned long dst_len, void *dst_vaddr)
+{
+	return -EAGAIN;
+}
+#endif
+
 int mdp_ppp_blit_and_wait(struct mdp_info *mdp, struct mdp_blit_req *req,
 		struct file *src_file, unsigned long src_start, unsigned long src_len,
 		struct file *dst_file, unsigned long dst_start, unsigned long dst_len)
 {
 	int ret;
+
+	if (ppp_collect)
+		return ppp_queue_region(req, src_file, src_start, src_len,
+					dst_file, dst_start, dst_len);
+
 	mdp->enable_irq(mdp, DL0_ROI_DONE);
 	ret = process_blit(mdp, req, src_file, src_start, src_len,
-			   dst_file, dst_start, dst_len);
+			   dst_file, dst_start, dst_len, true);
 	if (unlikely(ret)) {
 		mdp->disable_irq(mdp, DL0_ROI_DONE);
 		return ret;
@@ -775,6 +1097,7 @@ int mdp_ppp_blit(struct mdp_info *mdp, struct fb_info *fb,
 	int ret;
 	unsigned long src_start = 0, src_len = 0, dst_start = 0, dst_len = 0;
 	struct file *src_file = 0, *dst_file = 0;
+	void *src_vaddr, *dst_vaddr;
 
 	ret = mdp_ppp_validate_blit(mdp, req);
 	if (ret)
@@ -782,13 +1105,15 @@ int mdp_ppp_blit(struct mdp_info *mdp, struct fb_info *fb,
 
 	/* do this first so that if this fails, the caller can always
 	 * safely call put_img */
-	if (unlikely(get_img(&req->src, fb, &src_start, &src_len, &src_file))) {
+	if (unlikely(get_img(&req->src, fb, &src_start, &src_len, &src_file,
+			     &src_vaddr))) {
 		printk(KERN_ERR "mdp_ppp: could not retrieve src image from "
 				"memory\n");
 		return -EINVAL;
 	}
 
-	if (unlikely(get_img(&req->dst, fb, &dst_start, &dst_len, &dst_file))) {
+	if (unlikely(get_img(&req->dst, fb, &dst_start, &dst_len, &dst_file,
+			     &dst_vaddr))) {
 		printk(KERN_ERR "mdp_ppp: could not retrieve dst image from "
 				"memory\n");
 		put_img(src_file);
@@ -798,21 +1123,259 @@ int mdp_ppp_blit(struct mdp_info *mdp, struct fb_info *fb,
 
 	/* transp_masking unimplemented */
 	req->transp_mask = MDP_TRANSP_NOP;
-	mdp->req = req;
 
+	ret = ppp_sw_blit(mdp, req, src_file, src_start, src_len, src_vaddr,
+			  dst_file, dst_start, dst_len, dst_vaddr);
+	if (ret != -EAGAIN)
+		goto done;
+
+	/* queued blits go first */
+	wait_event(ppp_queue.idle_wq, !ppp_queue.busy);
+
+	mdp->req = req;
 	ret = mdp_ppp_do_blit(mdp, req, src_file, src_start, src_len,
 			      dst_file, dst_start, dst_len);
 
+done:
 	put_img(src_file);
 	put_img(dst_file);
 	mutex_unlock(&mdp_mutex);
 	return ret;
 }
 
-void mdp_ppp_handle_isr(struct mdp_info *mdp, uint32_t mask)
+/* Queue count blits and return right away with a fence, see
+ * linux/msm_sync.h, that signals once all of them are done.  Everything
+ * that can be checked without the hardware is checked here, so a batch
+ * is either queued whole or not at all.
+ */
+struct msm_sync_fence *mdp_ppp_blit_async(struct mdp_info *mdp,
+		struct fb_info *fb, struct mdp_blit_req *reqs, int count)
 {
-	if (mask & DL0_ROI_DONE)
-		wake_up(&mdp_ppp_waitqueue);
+	struct msm_sync_fence *fence;
+	unsigned long src_start, src_len, dst_start, dst_len;
+	struct file *src_file, *dst_file;
+	void *src_vaddr, *dst_vaddr;
+	struct list_head *last;
+	struct ppp_job *job;
+	unsigned long flags;
+	ktime_t now;
+	bool kick, running;
+	LIST_HEAD(jobs);
+	int ret = 0;
+	int i;
+
+	mutex_lock(&mdp_mutex);
+
+	if (ppp_queue.timeline == NULL) {
+		struct msm_sync_timeline *timeline;
+
+		timeline = msm_sync_timeline_create("mdp_ppp");
+		if (IS_ERR(timeline)) {
+			ret = PTR_ERR(timeline);
+			goto unlock;
+		}
+		ppp_queue.timeline = timeline;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct mdp_blit_req *req = &reqs[i];
+
+		ret = mdp_ppp_validate_blit(mdp, req);
+		if (ret)
+			goto error;
+
+		src_file = dst_file = NULL;
+		if (unlikely(get_img(&req->src, fb, &src_start, &src_len,
+				     &src_file, &src_vaddr))) {
+			ret = -EINVAL;
+			goto error;
+		}
+		if (unlikely(get_img(&req->dst, fb, &dst_start, &dst_len,
+				     &dst_file, &dst_vaddr))) {
+			put_img(src_file);
+			ret = -EINVAL;
+			goto error;
+		}
+
+		/* transp_masking unimplemented */
+		req->transp_mask = MDP_TRANSP_NOP;
+
+		last = jobs.prev;
+		ppp_collect = &jobs;
+		ret = mdp_ppp_do_blit(mdp, req, src_file, src_start, src_len,
+				      dst_file, dst_start, dst_len);
+		ppp_collect = NULL;
+
+		/* the last region of the request holds the images */
+		if (ret || jobs.prev == last) {
+			put_img(src_file);
+			put_img(dst_file);
+			if (ret)
+				goto error;
+			continue;
+		}
+		list_entry(jobs.prev, struct ppp_job, list)->put_imgs = true;
+	}
+
+	if (list_empty(&jobs)) {
+		ret = -EINVAL;
+		goto unlock;
+	}
+
+	fence = msm_sync_fence_create(ppp_queue.timeline, ppp_queue.seq + 1);
+	if (IS_ERR(fence)) {
+		ret = PTR_ERR(fence);
+		goto error;
+	}
+	ppp_queue.seq++;
+
+	now = ktime_get();
+	list_for_each_entry(job, &jobs, list) {
+		job->seq = ppp_queue.seq;
+		job->queued = now;
+	}
+	list_entry(jobs.prev, struct ppp_job, list)->signal = true;
+
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	list_splice_tail(&jobs, &ppp_queue.pending);
+	ppp_queue.batches++;
+	kick = !ppp_queue.busy;
+	ppp_queue.busy = true;
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+
+	/* the interrupt handler only ends a busy queue, and every other
+	 * submitter holds mdp_mutex, so starting it here is not racy */
+	if (kick) {
+		mdp->enable_irq(mdp, DL0_ROI_DONE);
+		spin_lock_irqsave(&ppp_queue.lock, flags);
+		running = ppp_queue_run(mdp);
+		spin_unlock_irqrestore(&ppp_queue.lock, flags);
+		if (!running) {
+			mdp->disable_irq(mdp, DL0_ROI_DONE);
+			spin_lock_irqsave(&ppp_queue.lock, flags);
+			ppp_queue.busy = false;
+			spin_unlock_irqrestore(&ppp_queue.lock, flags);
+			wake_up(&ppp_queue.idle_wq);
+		}
+	}
+
+	mutex_unlock(&mdp_mutex);
+	return fence;
+
+error:
+	ppp_queue_free(&jobs);
+unlock:
+	mutex_unlock(&mdp_mutex);
+	return ERR_PTR(ret);
+}
+
+/* Blit between physically contiguous images for users inside the kernel,
+ * such as mdp_ppp_test.c.  No cache maintenance is done on them.
+ */
+int mdp_ppp_blit_phys(struct mdp_blit_req *req,
+		      unsigned long src_start, unsigned long src_len,
+		      unsigned long dst_start, unsigned long dst_len)
+{
+	struct mdp_info *mdp = ppp_queue.mdp;
+	int ret;
+
+	if (!mdp)
+		return -ENODEV;
+
+	ret = mdp_ppp_validate_blit(mdp, req);
+	if (ret)
+		return ret;
+
+	mutex_lock(&mdp_mutex);
+	wait_event(ppp_queue.idle_wq, !ppp_queue.busy);
+	mdp->req = req;
+	ret = mdp_ppp_do_blit(mdp, req, NULL, src_start, src_len,
+			      NULL, dst_start, dst_len);
+	mutex_unlock(&mdp_mutex);
+	return ret;
+}
+
+void mdp_ppp_init(struct mdp_info *mdp)
+{
+	ppp_queue.mdp = mdp;
+}
+
+/* Returns the interrupts that have to stay enabled */
+uint32_t mdp_ppp_handle_isr(struct mdp_info *mdp, uint32_t mask)
+{
+	uint32_t keep = 0;
+
+	if (!(mask & DL0_ROI_DONE))
+		return 0;
+
+	spin_lock(&ppp_queue.lock);
+	if (ppp_queue.busy) {
+		del_timer(&ppp_queue.timer);
+		ppp_job_done(list_first_entry(&ppp_queue.pending,
+					      struct ppp_job, list), 0);
+		if (ppp_queue_run(mdp))
+			keep = DL0_ROI_DONE;
+		else {
+			ppp_queue.busy = false;
+			wake_up(&ppp_queue.idle_wq);
+		}
+	}
+	spin_unlock(&ppp_queue.lock);
+
+	wake_up(&mdp_ppp_waitqueue);
+	return keep;
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static int ppp_queue_debug_open(struct inode *inode, struct file *file)
+{
+	file->private_data = inode->i_private;
+	return 0;
+}
 
+static ssize_t ppp_queue_debug_read(struct file *file, char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	const int debug_bufmax = 4096;
+	static char buffer[4096];
+	struct ppp_timing *t;
+	unsigned long flags;
+	unsigned int i, n;
+	int len = 0;
+
+	spin_lock_irqsave(&ppp_queue.lock, flags);
+	len += scnprintf(buffer + len, debug_bufmax - len,
+			 "batches %lu regions %lu errors %lu busy %d\n"
+			 "sw_blits %lu\n"
+			 "run_us total %lld max %lld\n"
+			 "    seq    w    h    flags   wait_us    run_us res\n",
+			 ppp_queue.batches, ppp_queue.regions,
+			 ppp_queue.errors, ppp_queue.busy, ppp_queue.sw_blits,
+			 ppp_queue.run_us_total, ppp_queue.run_us_max);
+	n = min_t(unsigned int, ppp_queue.history_next, PPP_QUEUE_HISTORY);
+	for (i = ppp_queue.history_next - n; i != ppp_queue.history_next;
+	     i++) {
+		t = &ppp_queue.history[i % PPP_QUEUE_HISTORY];
+		len += scnprintf(buffer + len, debug_bufmax - len,
+				 "%7u %4u %4u %08x %9lld %9lld %d\n",
+				 t->seq, t->w, t->h, t->flags, t->wait_us,
+				 t->run_us, t->result);
+	}
+	spin_unlock_irqrestore(&ppp_queue.lock, flags);
+
+	return simple_read_from_buffer(buf, count, ppos, buffer, len);
+}
+
+static const struct file_operations ppp_queue_debug_fops = {
+	.read = ppp_queue_debug_read,
+	.open = ppp_queue_debug_open,
+};
+
+static int __init mdp_ppp_debugfs_init(void)
+{
+	debugfs_create_file("mdp_ppp_queue", S_IFREG | S_IRUGO, NULL, NULL,
+			    &ppp_queue_debug_fops);
+	return 0;
+}
+late_initcall(mdp_ppp_debugfs_init);
+#endif
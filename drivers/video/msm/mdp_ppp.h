@@ -16,6 +16,7 @@
 #define _VIDEO_MSM_MDP_PPP_H_
 
 #include <linux/types.h>
+#include <linux/err.h>
 #define  PPP_DUMP_BLITS 0
 
 struct ppp_regs {
@@ -63,13 +64,21 @@ struct ppp_regs {
 struct mdp_info;
 struct mdp_rect;
 struct mdp_blit_req;
+struct mdp_img;
 struct fb_info;
+struct msm_sync_fence;
 
 #ifdef CONFIG_FB_MSM_MDP_PPP
 int mdp_get_bytes_per_pixel(int format);
 int mdp_ppp_blit(struct mdp_info *mdp, struct fb_info *fb,
 		 struct mdp_blit_req *req);
-void mdp_ppp_handle_isr(struct mdp_info *mdp, uint32_t mask);
+struct msm_sync_fence *mdp_ppp_blit_async(struct mdp_info *mdp,
+		struct fb_info *fb, struct mdp_blit_req *reqs, int count);
+int mdp_ppp_blit_phys(struct mdp_blit_req *req,
+		      unsigned long src_start, unsigned long src_len,
+		      unsigned long dst_start, unsigned long dst_len);
+void mdp_ppp_init(struct mdp_info *mdp);
+uint32_t mdp_ppp_handle_isr(struct mdp_info *mdp, uint32_t mask);
 int mdp_ppp_blit_and_wait(struct mdp_info *mdp, struct mdp_blit_req *req,
 			  struct file *src_file, unsigned long src_start,
 			  unsigned long src_len, struct file *dst_file,
@@ -95,7 +104,15 @@ int mdp_fb_mirror(struct mdp_device *mdp_dev,
 static inline int mdp_get_bytes_per_pixel(int format) { return -1; }
 static inline int mdp_ppp_blit(struct mdp_info *mdp, struct fb_info *fb,
 			       struct mdp_blit_req *req) { return -EINVAL; }
-static inline void mdp_ppp_handle_isr(struct mdp_info *mdp, uint32_t mask) {}
+static inline struct msm_sync_fence *mdp_ppp_blit_async(struct mdp_info *mdp,
+		struct fb_info *fb, struct mdp_blit_req *reqs, int count)
+		{ return ERR_PTR(-ENODEV); }
+static inline int mdp_ppp_blit_phys(struct mdp_blit_req *req,
+		unsigned long src_start, unsigned long src_len,
+		unsigned long dst_start, unsigned long dst_len) { return -ENODEV; }
+static inline void mdp_ppp_init(struct mdp_info *mdp) {}
+static inline uint32_t mdp_ppp_handle_isr(struct mdp_info *mdp,
+		uint32_t mask) { return 0; }
 static inline int mdp_ppp_blit_and_wait(struct mdp_info *mdp,
 		struct mdp_blit_req *req, struct file *src_file,
 		unsigned long src_start, unsigned long src_len,
@@ -118,4 +135,17 @@ static inline int mdp_ppp_do_blit(struct mdp_info *mdp,
 
 #endif /* CONFIG_FB_MSM_MDP_PPP */
 
+#ifdef CONFIG_FB_MSM_MDP_PPP_SW
+bool mdp_ppp_sw_supported(const struct mdp_blit_req *req);
+uint32_t mdp_ppp_sw_get_pixel(const struct mdp_img *img, const void *base,
+			      int x, int y);
+int mdp_ppp_sw_blit(const struct mdp_blit_req *req, const void *src_base,
+		    void *dst_base);
+#else
+static inline bool mdp_ppp_sw_supported(const struct mdp_blit_req *req)
+{ return false; }
+static inline int mdp_ppp_sw_blit(const struct mdp_blit_req *req,
+		const void *src_base, void *dst_base) { return -EINVAL; }
+#endif /* CONFIG_FB_MSM_MDP_PPP_SW */
+
 #endif /* _VIDEO_MSM_MDP_PPP_H_ */
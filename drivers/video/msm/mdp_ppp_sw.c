@@ -0,0 +1,246 @@
+/* drivers/video/msm/mdp_ppp_sw.c
+ *
+ * CPU version of the PPP blit.  Used for blits too small to be worth
+ * waiting behind the queued ones or bringing the MDP out of standby for,
+ * and as the reference the hardware is checked against by mdp_ppp_test.c.
+ *
+ * It follows mdp_ppp.c for the RGB formats: rotation and flips, scaling
+ * (nearest pixel rather than the PPP filter), constant and per pixel alpha
+ * blending.  YCbCr images, blur and transparency masks are left to the
+ * hardware, and dithering is skipped.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+#include <linux/msm_mdp.h>
+
+#include "mdp_hw.h"
+#include "mdp_ppp.h"
+
+/* flags that either only matter to the hardware or can be ignored */
+#define PPP_SW_FLAGS	(MDP_ROT_MASK | MDP_DITHER | MDP_BLEND_FG_PREMULT | \
+			 MDP_BLIT_WITH_NO_DMA_BARRIERS | MDP_BLIT_NON_CACHED)
+
+enum {
+	PPP_SW_COPY,
+	PPP_SW_BLEND_CONST,
+	PPP_SW_BLEND_PIXEL,
+	PPP_SW_BLEND_PREMULT,
+};
+
+/* x / 255 rounded, exact for x up to 255 * 255 */
+static inline uint32_t div255(uint32_t x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+/* Pixels are passed around as 0xAARRGGBB.  The byte orders follow the
+ * pack patterns in mdp_hw.h, with the last component at the lowest
+ * address.
+ */
+static inline uint32_t ppp_sw_read(uint32_t format, const uint8_t *p)
+{
+	uint32_t v;
+
+	switch (format) {
+	case MDP_RGB_565:
+		v = *(const uint16_t *)p;
+		return 0xff000000 |
+		       ((v & 0xf800) << 8) | ((v & 0xe000) << 3) |
+		       ((v & 0x07e0) << 5) | ((v & 0x0600) >> 1) |
+		       ((v & 0x001f) << 3) | ((v & 0x001c) >> 2);
+	case MDP_RGB_888:
+		return 0xff000000 | (p[2] << 16) | (p[1] << 8) | p[0];
+	case MDP_XRGB_8888:
+		return 0xff000000 | (p[1] << 16) | (p[2] << 8) | p[3];
+	case MDP_ARGB_8888:
+		return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	case MDP_RGBA_8888:
+		return (p[3] << 24) | (p[0] << 16) | (p[1] << 8) | p[2];
+	case MDP_RGBX_8888:
+		return 0xff000000 | (p[0] << 16) | (p[1] << 8) | p[2];
+	case MDP_BGRA_8888:
+		return (p[3] << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+	}
+	return 0;
+}
+
+static inline void ppp_sw_write(uint32_t format, uint8_t *p, uint32_t c)
+{
+	uint8_t a = c >> 24, r = c >> 16, g = c >> 8, b = c;
+
+	switch (format) {
+	case MDP_RGB_565:
+		*(uint16_t *)p = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) |
+				 (b >> 3);
+		break;
+	case MDP_RGB_888:
+		p[0] = b; p[1] = g; p[2] = r;
+		break;
+	case MDP_XRGB_8888:
+		a = 0xff;
+		/* fall through */
+	case MDP_ARGB_8888:
+		p[0] = a; p[1] = r; p[2] = g; p[3] = b;
+		break;
+	case MDP_RGBX_8888:
+		a = 0xff;
+		/* fall through */
+	case MDP_RGBA_8888:
+		p[0] = r; p[1] = g; p[2] = b; p[3] = a;
+		break;
+	case MDP_BGRA_8888:
+		p[0] = b; p[1] = g; p[2] = r; p[3] = a;
+		break;
+	}
+}
+
+/* fg over bg: each channel is fg * fa + bg * (255 - fa), where fg is
+ * already multiplied by fa for the premultiplied mode */
+static inline uint32_t ppp_sw_blend(uint32_t fg, uint32_t bg, uint32_t fa,
+				    bool premult)
+{
+	uint32_t out = 0;
+	uint32_t f, b;
+	int shift;
+
+	for (shift = 0; shift < 32; shift += 8) {
+		f = (fg >> shift) & 0xff;
+		b = div255(((bg >> shift) & 0xff) * (255 - fa));
+		if (shift != 24 && !premult)
+			f = div255(f * fa);
+		out |= min(f + b, 255u) << shift;
+	}
+	return out;
+}
+
+bool mdp_ppp_sw_supported(const struct mdp_blit_req *req)
+{
+	if (req->src.format >= MDP_IMGTYPE_LIMIT ||
+	    req->dst.format >= MDP_IMGTYPE_LIMIT ||
+	    !IS_RGB(req->src.format) || !IS_RGB(req->dst.format))
+		return false;
+	if (req->flags & ~PPP_SW_FLAGS)
+		return false;
+	if (req->transp_mask != MDP_TRANSP_NOP)
+		return false;
+	if (!req->src_rect.w || !req->src_rect.h ||
+	    !req->dst_rect.w || !req->dst_rect.h)
+		return false;
+	return true;
+}
+
+/* base is the start of the memory img->offset is relative to */
+uint32_t mdp_ppp_sw_get_pixel(const struct mdp_img *img, const void *base,
+			      int x, int y)
+{
+	int bpp = mdp_get_bytes_per_pixel(img->format);
+
+	return ppp_sw_read(img->format, (const uint8_t *)base + img->offset +
+			   (y * img->width + x) * bpp);
+}
+
+/* Do req on the CPU.  src_base and dst_base are kernel mappings of the
+ * memory the images are in, which the caller has checked req against the
+ * same way as for the hardware, see check_blit in mdp_ppp.c.
+ */
+int mdp_ppp_sw_blit(const struct mdp_blit_req *req, const void *src_base,
+		    void *dst_base)
+{
+	uint32_t sfmt = req->src.format, dfmt = req->dst.format;
+	uint32_t w = req->dst_rect.w, h = req->dst_rect.h;
+	bool rot = req->flags & MDP_ROT_90;
+	bool xrev = rot ^ !!(req->flags & MDP_FLIP_LR);
+	bool yrev = req->flags & MDP_FLIP_UD;
+	int sbpp, dbpp, sstride, dstride;
+	uint32_t cstep, rstep, alpha;
+	const uint8_t *src;
+	uint8_t *dst, *d;
+	uint32_t x, y, u, v, c, r, pixel;
+	int mode;
+
+	if (!mdp_ppp_sw_supported(req))
+		return -EINVAL;
+
+	sbpp = mdp_get_bytes_per_pixel(sfmt);
+	dbpp = mdp_get_bytes_per_pixel(dfmt);
+	sstride = req->src.width * sbpp;
+	dstride = req->dst.width * dbpp;
+	src = (const uint8_t *)src_base + req->src.offset +
+	      req->src_rect.y * sstride + req->src_rect.x * sbpp;
+	dst = (uint8_t *)dst_base + req->dst.offset +
+	      req->dst_rect.y * dstride + req->dst_rect.x * dbpp;
+
+	/* same choice as blit_blend */
+	alpha = req->alpha & 0xff;
+	if (HAS_ALPHA(sfmt))
+		mode = (req->flags & MDP_BLEND_FG_PREMULT) ?
+			PPP_SW_BLEND_PREMULT : PPP_SW_BLEND_PIXEL;
+	else if (alpha < 0xff)
+		mode = PPP_SW_BLEND_CONST;
+	else
+		mode = PPP_SW_COPY;
+
+	/* the common case of a plain copy is just rows */
+	if (mode == PPP_SW_COPY && sfmt == dfmt &&
+	    !(req->flags & MDP_ROT_MASK) &&
+	    req->src_rect.w == w && req->src_rect.h == h) {
+		for (y = 0; y < h; y++)
+			memcpy(dst + y * dstride, src + y * sstride, w * dbpp);
+		return 0;
+	}
+
+	/* With MDP_ROT_90 the source rows become destination columns, and
+	 * the destination x is walked backwards for either MDP_ROT_90 or
+	 * MDP_FLIP_LR but not both, like rotate_dst_addr_x.  Source pixels
+	 * are sampled at the centre of each destination pixel, in 16.16.
+	 */
+	cstep = (req->src_rect.w << 16) / (rot ? h : w);
+	rstep = (req->src_rect.h << 16) / (rot ? w : h);
+
+	for (y = 0; y < h; y++) {
+		v = yrev ? h - 1 - y : y;
+		d = dst + y * dstride;
+		for (x = 0; x < w; x++, d += dbpp) {
+			u = xrev ? w - 1 - x : x;
+			if (rot) {
+				c = (v * cstep + cstep / 2) >> 16;
+				r = (u * rstep + rstep / 2) >> 16;
+			} else {
+				c = (u * cstep + cstep / 2) >> 16;
+				r = (v * rstep + rstep / 2) >> 16;
+			}
+			pixel = ppp_sw_read(sfmt, src + r * sstride + c * sbpp);
+
+			switch (mode) {
+			case PPP_SW_BLEND_CONST:
+				pixel = ppp_sw_blend((alpha << 24) |
+						     (pixel & 0xffffff),
+						     ppp_sw_read(dfmt, d),
+						     alpha, false);
+				break;
+			case PPP_SW_BLEND_PIXEL:
+			case PPP_SW_BLEND_PREMULT:
+				pixel = ppp_sw_blend(pixel,
+						     ppp_sw_read(dfmt, d),
+						     pixel >> 24,
+						     mode == PPP_SW_BLEND_PREMULT);
+				break;
+			}
+			ppp_sw_write(dfmt, d, pixel);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,217 @@
+/* drivers/video/msm/mdp_ppp_test.c
+ *
+ * PPP blit benchmark, run once during bootup.  Each blit of a fixed set
+ * is timed on the PPP and on the CPU, see mdp_ppp_sw.c, and the results
+ * are compared pixel by pixel.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/err.h>
+#include <linux/dma-mapping.h>
+#include <linux/msm_mdp.h>
+
+#include <asm/div64.h>
+
+#include "mdp_ppp.h"
+
+#define TEST_PPP_W		128
+#define TEST_PPP_H		128
+#define TEST_PPP_SIZE		(TEST_PPP_W * TEST_PPP_H * 4)
+#define TEST_PPP_LOOPS		100
+
+/* per channel, enough for rgb565 rounding and blend rounding */
+#define TEST_PPP_TOLERANCE	8
+
+struct test_ppp_blit {
+	const char *name;
+	uint32_t src_format;
+	uint32_t dst_format;
+	struct mdp_rect src_rect;
+	struct mdp_rect dst_rect;
+	uint32_t flags;
+	uint32_t alpha;
+};
+
+/* The scaled blits are expected to differ, since the PPP filters and the
+ * CPU version picks the nearest pixel; they are there for the timing.
+ */
+static struct test_ppp_blit test_ppp_blits[] __initdata = {
+	{ "copy rgb565 16x16", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 16, 16 }, { 8, 8, 16, 16 }, 0, MDP_ALPHA_NOP },
+	{ "copy rgb565 128x128", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 128, 128 }, { 0, 0, 128, 128 }, 0, MDP_ALPHA_NOP },
+	{ "xrgb8888 to rgb565 64x64", MDP_XRGB_8888, MDP_RGB_565,
+	  { 0, 0, 64, 64 }, { 32, 32, 64, 64 }, 0, MDP_ALPHA_NOP },
+	{ "rgb565 to rgba8888 64x64", MDP_RGB_565, MDP_RGBA_8888,
+	  { 0, 0, 64, 64 }, { 0, 0, 64, 64 }, 0, MDP_ALPHA_NOP },
+	{ "rgb565 rot90 64x32", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 64, 32 }, { 0, 0, 32, 64 }, MDP_ROT_90, MDP_ALPHA_NOP },
+	{ "rgb565 rot180 64x64", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 64, 64 }, { 0, 0, 64, 64 }, MDP_ROT_180, MDP_ALPHA_NOP },
+	{ "rgb565 rot270 32x64", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 32, 64 }, { 0, 0, 64, 32 }, MDP_ROT_270, MDP_ALPHA_NOP },
+	{ "rgb565 alpha 0x80 64x64", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 64, 64 }, { 0, 0, 64, 64 }, 0, 0x80 },
+	{ "rgba8888 over rgb565 32x32", MDP_RGBA_8888, MDP_RGB_565,
+	  { 0, 0, 32, 32 }, { 16, 16, 32, 32 }, 0, MDP_ALPHA_NOP },
+	{ "bgra8888 over xrgb8888 64x64", MDP_BGRA_8888, MDP_XRGB_8888,
+	  { 0, 0, 64, 64 }, { 0, 0, 64, 64 }, 0, MDP_ALPHA_NOP },
+	{ "rgb565 scale 32x32 to 128x128", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 32, 32 }, { 0, 0, 128, 128 }, 0, MDP_ALPHA_NOP },
+	{ "rgb565 scale 128x128 to 48x48", MDP_RGB_565, MDP_RGB_565,
+	  { 0, 0, 128, 128 }, { 0, 0, 48, 48 }, 0, MDP_ALPHA_NOP },
+};
+
+struct test_ppp_bufs {
+	void *src, *dst;		/* uncached, for the PPP */
+	dma_addr_t src_phys, dst_phys;
+	void *sw_src, *sw_dst;
+};
+
+static void __init test_ppp_fill(void *buf, uint32_t seed)
+{
+	uint32_t *p = buf;
+	int i;
+
+	for (i = 0; i < TEST_PPP_SIZE / 4; i++) {
+		seed = seed * 1664525 + 1013904223;
+		p[i] = seed;
+	}
+}
+
+static unsigned int __init test_ppp_compare(struct mdp_blit_req *req,
+		void *hw_dst, void *sw_dst)
+{
+	uint32_t hw, sw;
+	unsigned int x, y, differ = 0;
+	int shift;
+
+	for (y = req->dst_rect.y; y < req->dst_rect.y + req->dst_rect.h; y++)
+		for (x = req->dst_rect.x;
+		     x < req->dst_rect.x + req->dst_rect.w; x++) {
+			hw = mdp_ppp_sw_get_pixel(&req->dst, hw_dst, x, y);
+			sw = mdp_ppp_sw_get_pixel(&req->dst, sw_dst, x, y);
+			for (shift = 0; shift < 24; shift += 8)
+				if (abs((int)((hw >> shift) & 0xff) -
+					(int)((sw >> shift) & 0xff)) >
+				    TEST_PPP_TOLERANCE)
+					break;
+			if (shift < 24)
+				differ++;
+		}
+	return differ;
+}
+
+static void __init test_ppp_run(struct test_ppp_blit *t,
+		struct test_ppp_bufs *bufs)
+{
+	struct mdp_blit_req req = {
+		.src = { TEST_PPP_W, TEST_PPP_H, t->src_format, 0, -1, 0 },
+		.dst = { TEST_PPP_W, TEST_PPP_H, t->dst_format, 0, -1, 0 },
+		.src_rect = t->src_rect,
+		.dst_rect = t->dst_rect,
+		.alpha = t->alpha,
+		.transp_mask = MDP_TRANSP_NOP,
+		.flags = t->flags,
+	};
+	struct mdp_blit_req r;
+	u64 hw_ns, sw_ns;
+	ktime_t start;
+	int ret = 0;
+	int i;
+
+	if (!mdp_ppp_sw_supported(&req)) {
+		pr_err("mdp_ppp test: %s: not supported by the cpu\n",
+		       t->name);
+		return;
+	}
+
+	test_ppp_fill(bufs->sw_src, 1);
+	start = ktime_get();
+	for (i = 0; i < TEST_PPP_LOOPS; i++) {
+		r = req;
+		mdp_ppp_sw_blit(&r, bufs->sw_src, bufs->sw_dst);
+	}
+	sw_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	do_div(sw_ns, TEST_PPP_LOOPS);
+
+	test_ppp_fill(bufs->src, 1);
+	start = ktime_get();
+	for (i = 0; i < TEST_PPP_LOOPS && !ret; i++) {
+		r = req;
+		ret = mdp_ppp_blit_phys(&r, bufs->src_phys, TEST_PPP_SIZE,
+					bufs->dst_phys, TEST_PPP_SIZE);
+	}
+	hw_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	do_div(hw_ns, TEST_PPP_LOOPS);
+
+	/* blends read the destination, so compare one more blit of each
+	 * onto the same starting image */
+	test_ppp_fill(bufs->sw_dst, 2);
+	r = req;
+	mdp_ppp_sw_blit(&r, bufs->sw_src, bufs->sw_dst);
+	if (!ret) {
+		test_ppp_fill(bufs->dst, 2);
+		r = req;
+		ret = mdp_ppp_blit_phys(&r, bufs->src_phys, TEST_PPP_SIZE,
+					bufs->dst_phys, TEST_PPP_SIZE);
+	}
+
+	if (ret)
+		pr_info("mdp_ppp test: %s: sw %llu ns/blit, hw failed %d\n",
+			t->name, sw_ns, ret);
+	else
+		pr_info("mdp_ppp test: %s: hw %llu ns/blit, sw %llu ns/blit, "
+			"%u of %u pixels differ\n", t->name, hw_ns, sw_ns,
+			test_ppp_compare(&req, bufs->dst, bufs->sw_dst),
+			req.dst_rect.w * req.dst_rect.h);
+}
+
+static int __init test_ppp(void)
+{
+	struct test_ppp_bufs bufs;
+	int ret = -ENOMEM;
+	int i;
+
+	bufs.src = dma_alloc_coherent(NULL, TEST_PPP_SIZE, &bufs.src_phys,
+				      GFP_KERNEL);
+	if (!bufs.src)
+		return -ENOMEM;
+	bufs.dst = dma_alloc_coherent(NULL, TEST_PPP_SIZE, &bufs.dst_phys,
+				      GFP_KERNEL);
+	if (!bufs.dst)
+		goto err_dst;
+	bufs.sw_src = kmalloc(TEST_PPP_SIZE, GFP_KERNEL);
+	if (!bufs.sw_src)
+		goto err_sw_src;
+	bufs.sw_dst = kmalloc(TEST_PPP_SIZE, GFP_KERNEL);
+	if (!bufs.sw_dst)
+		goto err_sw_dst;
+
+	for (i = 0; i < ARRAY_SIZE(test_ppp_blits); i++)
+		test_ppp_run(&test_ppp_blits[i], &bufs);
+	ret = 0;
+
+	kfree(bufs.sw_dst);
+err_sw_dst:
+	kfree(bufs.sw_src);
+err_sw_src:
+	dma_free_coherent(NULL, TEST_PPP_SIZE, bufs.dst, bufs.dst_phys);
+err_dst:
+	dma_free_coherent(NULL, TEST_PPP_SIZE, bufs.src, bufs.src_phys);
+	return ret;
+}
+late_initcall(test_ppp);
@@ -33,6 +33,10 @@
 #include <linux/debugfs.h>
 #include <linux/dma-mapping.h>
 #include <linux/android_pmem.h>
+#include <linux/msm_sync.h>
+#include <linux/slab.h>
+#include <linux/interrupt.h>
+#include <linux/math64.h>
 #include <mach/debug_display.h>
 #include "mdp_hw.h"
 #ifdef CONFIG_MSM_MDP40
@@ -85,6 +89,24 @@ struct mdp_device *mdp;
 static atomic_t mdpclk_on = ATOMIC_INIT(1);
 #endif
 
+/* overlay pipe ids run from 1, see mdp4_overlay_set */
+#define MSMFB_FENCE_PIPES	8
+/* how long a fenced request waits for its in_fence */
+#define MSMFB_FENCE_WAIT_MS	1000
+
+/* dirty regions kept for the next frame, each sent with its own dma */
+#define MSMFB_DIRTY_RECTS	8
+/* what starting one more dma costs, in pixels sent over MDDI: the
+ * register packets for the window and the interrupt turnaround */
+#define MSMFB_DMA_COST_PIXELS	1024
+
+struct msmfb_rect {
+	int left;
+	int top;
+	int eright; /* exclusive */
+	int ebottom; /* exclusive */
+};
+
 struct msmfb_info {
 	struct fb_info *fb;
 	struct msm_panel_data *panel;
@@ -96,12 +118,30 @@ struct msmfb_info {
 	unsigned frame_done;
 	int sleeping;
 	unsigned update_frame;
+	/* regions drawn since the last frame was started */
+	struct msmfb_rect dirty[MSMFB_DIRTY_RECTS];
+	int dirty_count;
+	/* regions of the frame being sent, top first, and the frame number
+	 * it completes; the first is started on vsync and the others from
+	 * dma_tasklet as each dma finishes */
+	struct msmfb_rect dma_rects[MSMFB_DIRTY_RECTS];
+	int dma_count;
+	int dma_next;
+	unsigned dma_frame;
+	unsigned dma_yoffset;
+	bool dma_busy;
+	struct tasklet_struct dma_tasklet;
+	/* requests the vsync for regions drawn while a frame was sent */
+	struct work_struct vsync_work;
 	struct {
-		int left;
-		int top;
-		int eright; /* exclusive */
-		int ebottom; /* exclusive */
-	} update_info;
+		unsigned long frames;
+		unsigned long dmas;
+		u64 pixels_drawn;	/* overlapping updates count twice */
+		u64 pixels_sent;
+		u64 pixels_per_sec;	/* sent, over the last window */
+		u64 window_pixels;
+		ktime_t window_start;
+	} stats;
 	char *black;
 
 	struct early_suspend earlier_suspend;
@@ -123,6 +163,15 @@ struct msmfb_info {
 	ktime_t vsync_request_time;
 	unsigned fb_resumed;
 	unsigned overrides;
+
+	/* fences of MSMFB_BLIT_FENCE and MSMFB_OVERLAY_PLAY_FENCE */
+	struct mutex fence_lock;
+	struct msm_sync_timeline *blit_timeline;
+	uint32_t blit_count;
+#ifdef CONFIG_FB_MSM_OVERLAY
+	struct msm_sync_timeline *release_timeline[MSMFB_FENCE_PIPES];
+	uint32_t release_count[MSMFB_FENCE_PIPES];
+#endif
 };
 
 #if (defined(CONFIG_USB_FUNCTION_PROJECTOR) || defined(CONFIG_USB_ANDROID_PROJECTOR))
@@ -176,6 +225,7 @@ static void msmfb_handle_dma_interrupt(struct msmfb_callback *callback)
 	unsigned long irq_flags=0;
 	struct msmfb_info *msmfb  = container_of(callback, struct msmfb_info,
 					       dma_callback);
+	bool more, rearm = false;
 #if PRINT_FPS
 	int64_t dt;
 	ktime_t now;
@@ -184,7 +234,18 @@ static void msmfb_handle_dma_interrupt(struct msmfb_callback *callback)
 #endif
 
 	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
-	msmfb->frame_done = msmfb->frame_requested;
+	/* mdp->lock is held here, so the next dma is left to the tasklet */
+	more = msmfb->dma_next < msmfb->dma_count;
+	if (more)
+		goto unlock;
+	msmfb->dma_busy = false;
+	if (msmfb->dirty_count && msmfb->sleeping != SLEEPING) {
+		/* drawn while this frame was sent, the vsync requested for
+		 * it has passed already so ask for another one */
+		msmfb->frame_done = msmfb->dma_frame;
+		rearm = true;
+	} else
+		msmfb->frame_done = msmfb->frame_requested;
 	if (msmfb->sleeping == UPDATING &&
 	    msmfb->frame_done == msmfb->update_frame) {
 		DLOG(SUSPEND_RESUME, "full update completed\n");
@@ -202,14 +263,184 @@ static void msmfb_handle_dma_interrupt(struct msmfb_callback *callback)
 		DLOG(FPS, "fps * 100: %llu\n", fps);
 	}
 #endif
+unlock:
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+	if (more)
+		tasklet_schedule(&msmfb->dma_tasklet);
+	if (rearm)
+		queue_work(msmfb->resume_workqueue, &msmfb->vsync_work);
 	wake_up(&msmfb->frame_wq);
 }
 
-static int msmfb_start_dma(struct msmfb_info *msmfb)
+static inline int msmfb_rect_area(const struct msmfb_rect *r)
+{
+	return (r->eright - r->left) * (r->ebottom - r->top);
+}
+
+static void msmfb_rect_union(struct msmfb_rect *u, const struct msmfb_rect *a,
+			     const struct msmfb_rect *b)
+{
+	u->left = min(a->left, b->left);
+	u->top = min(a->top, b->top);
+	u->eright = max(a->eright, b->eright);
+	u->ebottom = max(a->ebottom, b->ebottom);
+}
+
+/* Pixels the bounding box of a and b costs over sending them apart,
+ * where an overlap is sent twice but there is one dma more.
+ */
+static int msmfb_merge_cost(const struct msmfb_rect *a,
+			    const struct msmfb_rect *b)
 {
-	uint32_t x, y, w, h;
+	struct msmfb_rect u;
+
+	msmfb_rect_union(&u, a, b);
+	return msmfb_rect_area(&u) - msmfb_rect_area(a) - msmfb_rect_area(b) -
+		MSMFB_DMA_COST_PIXELS;
+}
+
+/* Add a region to the next frame.  It is merged with the region it is
+ * cheapest to, as long as that sends no more pixels than keeping them
+ * apart, or when the list is full; the result is then tried against the
+ * others again.  Called with update_lock held.
+ */
+static void msmfb_dirty_add(struct msmfb_info *msmfb,
+			    const struct msmfb_rect *update)
+{
+	struct msmfb_rect rect = *update;
+	int i, best, cost, best_cost = 0;
+
+	if (rect.left >= rect.eright || rect.top >= rect.ebottom) {
+		PR_DISP_INFO("invalid update: %d %d %d %d\n", rect.left,
+			     rect.top, rect.eright, rect.ebottom);
+		return;
+	}
+	for (;;) {
+		best = -1;
+		for (i = 0; i < msmfb->dirty_count; i++) {
+			cost = msmfb_merge_cost(&msmfb->dirty[i], &rect);
+			if (best < 0 || cost < best_cost) {
+				best = i;
+				best_cost = cost;
+			}
+		}
+		if (best < 0 || (best_cost > 0 &&
+				 msmfb->dirty_count < MSMFB_DIRTY_RECTS))
+			break;
+		msmfb_rect_union(&rect, &rect, &msmfb->dirty[best]);
+		msmfb->dirty[best] = msmfb->dirty[--msmfb->dirty_count];
+	}
+	msmfb->dirty[msmfb->dirty_count++] = rect;
+}
+
+/* Make the dirty regions the frame to send, sorted top first to follow
+ * the panel scan.  Called with update_lock held.
+ */
+static void msmfb_dma_load(struct msmfb_info *msmfb)
+{
+	struct msmfb_rect rect;
+	int i, j;
+
+	for (i = 0; i < msmfb->dirty_count; i++) {
+		rect = msmfb->dirty[i];
+		for (j = i; j > 0 && msmfb->dma_rects[j - 1].top > rect.top;
+		     j--)
+			msmfb->dma_rects[j] = msmfb->dma_rects[j - 1];
+		msmfb->dma_rects[j] = rect;
+	}
+	msmfb->dma_count = msmfb->dirty_count;
+	msmfb->dma_next = 0;
+	msmfb->dma_frame = msmfb->frame_requested;
+	msmfb->dma_yoffset = msmfb->yoffset;
+	msmfb->dirty_count = 0;
+	msmfb->stats.frames++;
+}
+
+/* Forget the frame being sent.  For a dma that was dropped or whose
+ * interrupt was lost, the regions not known to be sent go back to the
+ * dirty list when requeue is set.  Called with update_lock held.
+ */
+static void msmfb_dma_reset(struct msmfb_info *msmfb, bool requeue)
+{
+	int i;
+
+	if (requeue)
+		for (i = max(msmfb->dma_next - 1, 0); i < msmfb->dma_count; i++)
+			msmfb_dirty_add(msmfb, &msmfb->dma_rects[i]);
+	msmfb->dma_count = 0;
+	msmfb->dma_next = 0;
+	msmfb->dma_busy = false;
+}
+
+/* Take the next region of the frame.  Called with update_lock held. */
+static void msmfb_dma_pop(struct msmfb_info *msmfb, struct msmfb_rect *rect)
+{
+	ktime_t now = ktime_get();
+	s64 dt;
+	int pixels;
+
+	*rect = msmfb->dma_rects[msmfb->dma_next++];
+	pixels = msmfb_rect_area(rect);
+
+	msmfb->stats.dmas++;
+	msmfb->stats.pixels_sent += pixels;
+	msmfb->stats.window_pixels += pixels;
+	dt = ktime_to_ns(ktime_sub(now, msmfb->stats.window_start));
+	if (dt >= NSEC_PER_SEC) {
+		msmfb->stats.pixels_per_sec = div64_u64(
+			msmfb->stats.window_pixels * NSEC_PER_SEC, dt);
+		msmfb->stats.window_pixels = 0;
+		msmfb->stats.window_start = now;
+		DLOG(FPS, "pixels/s: %llu\n", msmfb->stats.pixels_per_sec);
+	}
+}
+
+static void msmfb_dma_send(struct msmfb_info *msmfb,
+			   const struct msmfb_rect *rect, uint32_t yoffset)
+{
+	uint32_t x = rect->left, y = rect->top;
 	unsigned addr;
+
+	addr = (( ALIGN(msmfb->xres, 32) * (yoffset + y) + x) * BYTES_PER_PIXEL(msmfb));
+	mdp->dma(mdp, addr + msmfb->fb->fix.smem_start,
+		 msmfb->xres * BYTES_PER_PIXEL(msmfb),
+		 rect->eright - x, rect->ebottom - y, x, y,
+		 &msmfb->dma_callback,
+		 msmfb->panel->interface_type);
+}
+
+/* Start the next dma of the frame being sent */
+static void msmfb_dma_tasklet(unsigned long data)
+{
+	struct msmfb_info *msmfb = (struct msmfb_info *)data;
+	struct msmfb_rect rect;
+	unsigned long irq_flags;
+	uint32_t yoffset;
+
+	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
+	if (msmfb->sleeping == SLEEPING) {
+		msmfb_dma_reset(msmfb, false);
+		msmfb->dirty_count = 0;
+		msmfb->frame_done = msmfb->frame_requested;
+		spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+		wake_up(&msmfb->frame_wq);
+		return;
+	}
+	/* reset meanwhile, see msmfb_pan_update_rects */
+	if (!msmfb->dma_busy || msmfb->dma_next == msmfb->dma_count) {
+		spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+		return;
+	}
+	msmfb_dma_pop(msmfb, &rect);
+	yoffset = msmfb->dma_yoffset;
+	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+
+	msmfb_dma_send(msmfb, &rect, yoffset);
+}
+
+static int msmfb_start_dma(struct msmfb_info *msmfb)
+{
+	struct msmfb_rect rect;
 	unsigned long irq_flags=0;
 	uint32_t yoffset;
 	s64 time_since_request;
@@ -233,29 +464,23 @@ static int msmfb_start_dma(struct msmfb_info *msmfb)
 		spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 		return -1;
 	}
-	x = msmfb->update_info.left;
-	y = msmfb->update_info.top;
-	w = msmfb->update_info.eright - x;
-	h = msmfb->update_info.ebottom - y;
-	yoffset = msmfb->yoffset;
-	msmfb->update_info.left = msmfb->xres + 1;
-	msmfb->update_info.top = msmfb->yres + 1;
-	msmfb->update_info.eright = 0;
-	msmfb->update_info.ebottom = 0;
-	if (unlikely(w > msmfb->xres || h > msmfb->yres ||
-		     w == 0 || h == 0)) {
-		PR_DISP_INFO("invalid update: %d %d %d "
-				"%d\n", x, y, w, h);
+	/* once the frame being sent is done, the dma interrupt asks for
+	 * another vsync for these regions */
+	if (msmfb->dma_busy) {
+		spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+		return 0;
+	}
+	if (unlikely(!msmfb->dirty_count)) {
 		msmfb->frame_done = msmfb->frame_requested;
 		goto error;
 	}
+	msmfb_dma_load(msmfb);
+	msmfb_dma_pop(msmfb, &rect);
+	yoffset = msmfb->dma_yoffset;
+	msmfb->dma_busy = true;
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 
-	addr = (( ALIGN(msmfb->xres, 32) * (yoffset + y) + x) * BYTES_PER_PIXEL(msmfb));
-	mdp->dma(mdp, addr + msmfb->fb->fix.smem_start,
-		 msmfb->xres * BYTES_PER_PIXEL(msmfb), w, h, x, y,
-		 &msmfb->dma_callback,
-		 panel->interface_type);
+	msmfb_dma_send(msmfb, &rect, yoffset);
 	return 0;
 error:
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
@@ -283,9 +508,49 @@ static enum hrtimer_restart msmfb_fake_vsync(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
-static void msmfb_pan_update(struct fb_info *info, uint32_t left, uint32_t top,
-			     uint32_t eright, uint32_t ebottom,
-			     uint32_t yoffset, int pan_display)
+/* if the panel is all the way on wait for vsync, otherwise sleep
+ * for 16 ms (long enough for the dma to panel) and then begin dma */
+static void msmfb_request_vsync(struct msmfb_info *msmfb, int sleeping)
+{
+	struct msm_panel_data *panel = msmfb->panel;
+
+	msmfb->vsync_request_time = ktime_get();
+	if (panel->request_vsync && (sleeping == AWAKE)) {
+		wake_lock_timeout(&msmfb->idle_lock, HZ/4);
+		panel->request_vsync(panel, &msmfb->vsync_callback);
+	} else {
+		if (!hrtimer_active(&msmfb->fake_vsync)) {
+			hrtimer_start(&msmfb->fake_vsync,
+				      ktime_set(0, NSEC_PER_SEC/60),
+				      HRTIMER_MODE_REL);
+		}
+	}
+}
+
+/* request_vsync may sleep, so the dma interrupt leaves it to this */
+static void msmfb_vsync_work(struct work_struct *work)
+{
+	struct msmfb_info *msmfb =
+		container_of(work, struct msmfb_info, vsync_work);
+	unsigned long irq_flags;
+	int sleeping;
+
+	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
+	sleeping = msmfb->sleeping;
+	if (sleeping == SLEEPING || msmfb->dma_busy ||
+	    msmfb->frame_done == msmfb->frame_requested) {
+		spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+		return;
+	}
+	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
+
+	msmfb_request_vsync(msmfb, sleeping);
+}
+
+/* Queue the regions, clipped to the screen, for the next frame */
+static void msmfb_pan_update_rects(struct fb_info *info,
+				   const struct msmfb_rect *rects, int count,
+				   uint32_t yoffset, int pan_display)
 {
 	struct msmfb_info *msmfb = info->par;
 	struct msm_panel_data *panel = msmfb->panel;
@@ -295,14 +560,17 @@ static void msmfb_pan_update(struct fb_info *info, uint32_t left, uint32_t top,
 	unsigned long irq_flags=0;
 	int sleeping;
 	int retry = 1;
+	int i;
 #if PRINT_FPS
 	ktime_t t1, t2;
 	static uint64_t pans;
 	static uint64_t dt;
 	t1 = ktime_get();
 #endif
-	DLOG(SHOW_UPDATES, "update %d %d %d %d %d %d\n",
-		left, top, eright, ebottom, yoffset, pan_display);
+	for (i = 0; i < count; i++)
+		DLOG(SHOW_UPDATES, "update %d %d %d %d %d %d\n",
+		     rects[i].left, rects[i].top, rects[i].eright,
+		     rects[i].ebottom, yoffset, pan_display);
 
         if (msmfb->sleeping != AWAKE)
                 DLOG(SUSPEND_RESUME, "pan_update in state(%d)\n", msmfb->sleeping);
@@ -355,6 +623,14 @@ restart:
 				 msmfb->sleeping == UPDATING)) {
 			if (retry && panel->request_vsync &&
 			    (sleeping == AWAKE)) {
+				/* a dma dropped by mdp as busy, or whose
+				 * interrupt got lost, never finishes */
+				spin_lock_irqsave(&msmfb->update_lock,
+						  irq_flags);
+				if (msmfb->dma_busy)
+					msmfb_dma_reset(msmfb, true);
+				spin_unlock_irqrestore(&msmfb->update_lock,
+						       irq_flags);
 				wake_lock_timeout(&msmfb->idle_lock, HZ/4);
 				panel->request_vsync(panel,
 					&msmfb->vsync_callback);
@@ -396,44 +672,44 @@ restart:
 	 * first full update on resume, set the sleeping state */
 	if (pan_display) {
 		msmfb->yoffset = yoffset;
-		if (left == 0 && top == 0 && eright == info->var.xres &&
-		    ebottom == info->var.yres) {
-			if (sleeping == WAKING) {
-				msmfb->update_frame = msmfb->frame_requested;
-				DLOG(SUSPEND_RESUME, "full update starting\n");
-				msmfb->sleeping = UPDATING;
-			}
+		for (i = 0; i < count; i++)
+			if (rects[i].left == 0 && rects[i].top == 0 &&
+			    rects[i].eright == info->var.xres &&
+			    rects[i].ebottom == info->var.yres)
+				break;
+		if (i < count && sleeping == WAKING) {
+			msmfb->update_frame = msmfb->frame_requested;
+			DLOG(SUSPEND_RESUME, "full update starting\n");
+			msmfb->sleeping = UPDATING;
 		}
 	}
 
 	/* set the update request */
-	if (left < msmfb->update_info.left)
-		msmfb->update_info.left = left;
-	if (top < msmfb->update_info.top)
-		msmfb->update_info.top = top;
-	if (eright > msmfb->update_info.eright)
-		msmfb->update_info.eright = eright;
-	if (ebottom > msmfb->update_info.ebottom)
-		msmfb->update_info.ebottom = ebottom;
-	DLOG(SHOW_UPDATES, "update queued %d %d %d %d %d\n",
-		msmfb->update_info.left, msmfb->update_info.top,
-		msmfb->update_info.eright, msmfb->update_info.ebottom,
-		msmfb->yoffset);
+	for (i = 0; i < count; i++) {
+		if (rects[i].left < rects[i].eright &&
+		    rects[i].top < rects[i].ebottom)
+			msmfb->stats.pixels_drawn += msmfb_rect_area(&rects[i]);
+		msmfb_dirty_add(msmfb, &rects[i]);
+	}
+	DLOG(SHOW_UPDATES, "update queued %d regions %d\n",
+		msmfb->dirty_count, msmfb->yoffset);
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 
-	/* if the panel is all the way on wait for vsync, otherwise sleep
-	 * for 16 ms (long enough for the dma to panel) and then begin dma */
-	msmfb->vsync_request_time = ktime_get();
-	if (panel->request_vsync && (sleeping == AWAKE)) {
-		wake_lock_timeout(&msmfb->idle_lock, HZ/4);
-		panel->request_vsync(panel, &msmfb->vsync_callback);
-	} else {
-		if (!hrtimer_active(&msmfb->fake_vsync)) {
-			hrtimer_start(&msmfb->fake_vsync,
-				      ktime_set(0, NSEC_PER_SEC/60),
-				      HRTIMER_MODE_REL);
-		}
-	}
+	msmfb_request_vsync(msmfb, sleeping);
+}
+
+static void msmfb_pan_update(struct fb_info *info, uint32_t left, uint32_t top,
+			     uint32_t eright, uint32_t ebottom,
+			     uint32_t yoffset, int pan_display)
+{
+	struct msmfb_rect rect = {
+		.left = min(left, info->var.xres),
+		.top = min(top, info->var.yres),
+		.eright = min(eright, info->var.xres),
+		.ebottom = min(ebottom, info->var.yres),
+	};
+
+	msmfb_pan_update_rects(info, &rect, 1, yoffset, pan_display);
 }
 
 static void msmfb_update(struct fb_info *info, uint32_t left, uint32_t top,
@@ -507,6 +783,9 @@ static void msmfb_earlier_suspend(struct early_suspend *h)
 	msmfb->sleeping = SLEEPING;
 	wake_up(&msmfb->frame_wq);
 	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
+	/* the first update after resume is a full one anyway */
+	msmfb->dirty_count = 0;
+	msmfb_dma_reset(msmfb, false);
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 	wait_event_timeout(msmfb->frame_wq,
 			   msmfb->frame_requested == msmfb->frame_done, HZ/10);
@@ -560,6 +839,9 @@ static void msmfb_onchg_earlier_suspend(struct early_suspend *h)
 	msmfb->sleeping = SLEEPING;
 	wake_up(&msmfb->frame_wq);
 	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
+	/* the first update after resume is a full one anyway */
+	msmfb->dirty_count = 0;
+	msmfb_dma_reset(msmfb, false);
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 	wait_event_timeout(msmfb->frame_wq,
 			   msmfb->frame_requested == msmfb->frame_done, HZ/10);
@@ -609,6 +891,8 @@ static void msmfb_resume(struct work_struct *work)
 	}
 	spin_lock_irqsave(&msmfb->update_lock, irq_flags);
 	msmfb->frame_requested = msmfb->frame_done = msmfb->update_frame = 0;
+	msmfb->dirty_count = 0;
+	msmfb_dma_reset(msmfb, false);
 	msmfb->sleeping = WAKING;
 	DLOG(SUSPEND_RESUME, "ready, waiting for full update\n");
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
@@ -736,6 +1020,126 @@ static int msmfb_blit(struct fb_info *info,
 	}
 	return 0;
 }
+
+/* Hand the whole list to the mdp queue, the returned fence signals
+ * once the last blit is done.
+ */
+static struct msm_sync_fence *msmfb_blit_async(struct fb_info *info,
+				struct mdp_blit_req_list __user *list)
+{
+	struct msm_sync_fence *fence;
+	struct mdp_blit_req *reqs;
+	uint32_t count;
+
+	if (get_user(count, &list->count))
+		return ERR_PTR(-EFAULT);
+	if (count == 0 || count > MSMFB_BLIT_FENCE_MAX_REQS)
+		return ERR_PTR(-EINVAL);
+
+	reqs = kmalloc(count * sizeof(*reqs), GFP_KERNEL);
+	if (!reqs)
+		return ERR_PTR(-ENOMEM);
+
+	if (copy_from_user(reqs, list->req, count * sizeof(*reqs)))
+		fence = ERR_PTR(-EFAULT);
+	else
+		fence = mdp->blit_async(mdp, info, reqs, count);
+
+	kfree(reqs);
+	return fence;
+}
+
+/* Several regions of one frame, each sent on its own unless merging
+ * them costs less; see msmfb_dirty_add.
+ */
+static int msmfb_update_rects(struct fb_info *info, void __user *p)
+{
+	struct msmfb_info *msmfb = info->par;
+	struct msmfb_update_rects req;
+	struct mdp_rect mrects[MSMFB_UPDATE_MAX_RECTS];
+	struct msmfb_rect rects[MSMFB_UPDATE_MAX_RECTS];
+	int i;
+
+	if (copy_from_user(&req, p, sizeof(req)))
+		return -EFAULT;
+	if (req.count == 0 || req.count > MSMFB_UPDATE_MAX_RECTS)
+		return -EINVAL;
+	if (req.yoffset > info->var.yres_virtual - info->var.yres)
+		return -EINVAL;
+	if (copy_from_user(mrects, req.rects, req.count * sizeof(*mrects)))
+		return -EFAULT;
+
+	if (!(msmfb->panel->caps & MSMFB_CAP_PARTIAL_UPDATES)) {
+		msmfb_pan_update(info, 0, 0, info->var.xres, info->var.yres,
+				 req.yoffset, 1);
+		return 0;
+	}
+
+	for (i = 0; i < req.count; i++) {
+		if (mrects[i].x >= info->var.xres ||
+		    mrects[i].y >= info->var.yres)
+			return -EINVAL;
+		rects[i].left = mrects[i].x;
+		rects[i].top = mrects[i].y;
+		rects[i].eright = mrects[i].x +
+			min(mrects[i].w, info->var.xres - mrects[i].x);
+		rects[i].ebottom = mrects[i].y +
+			min(mrects[i].h, info->var.yres - mrects[i].y);
+	}
+	msmfb_pan_update_rects(info, rects, req.count, req.yoffset, 1);
+	return 0;
+}
+
+/* Without a blit queue the blits are done by the time msmfb_blit
+ * returns, so the out fence is already signaled; it still lets
+ * userspace hand the destination on with the same fence plumbing.
+ */
+static int msmfb_blit_fence(struct fb_info *info, void __user *p)
+{
+	struct msmfb_info *msmfb = info->par;
+	struct msmfb_blit_fence req;
+	struct msm_sync_fence *fence;
+	uint32_t count;
+	int ret;
+
+	if (copy_from_user(&req, p, sizeof(req)))
+		return -EFAULT;
+
+	ret = msm_sync_fence_wait_fd(req.in_fence, MSMFB_FENCE_WAIT_MS);
+	if (ret)
+		return ret;
+
+	if (mdp->blit_async) {
+		fence = msmfb_blit_async(info, (void __user *)req.list);
+		if (IS_ERR(fence))
+			return PTR_ERR(fence);
+		goto done;
+	}
+
+	if (msmfb->blit_timeline == NULL)
+		return -ENODEV;
+
+	ret = msmfb_blit(info, (void __user *)req.list);
+	if (ret)
+		return ret;
+
+	mutex_lock(&msmfb->fence_lock);
+	count = ++msmfb->blit_count;
+	msm_sync_timeline_signal(msmfb->blit_timeline, count);
+	fence = msm_sync_fence_create(msmfb->blit_timeline, count);
+	mutex_unlock(&msmfb->fence_lock);
+	if (IS_ERR(fence))
+		return PTR_ERR(fence);
+
+done:
+	req.out_fence = fence->fd;
+	if (copy_to_user(p, &req, sizeof(req))) {
+		msm_sync_fence_discard(fence);
+		return -EFAULT;
+	}
+	msm_sync_fence_install(fence);
+	return 0;
+}
 #ifdef CONFIG_FB_MSM_OVERLAY
 static int msmfb_overlay_get(struct fb_info *info, void __user *p)
 {
@@ -786,6 +1190,43 @@ static int msmfb_overlay_set(struct fb_info *info, void __user *p)
 	return 0;
 }
 
+/* Called after a play or an unset of pipe ndx went through.  The buffer
+ * of the play before is no longer read and its fence signals; for a play
+ * a new fence is returned for the buffer just queued.
+ */
+static struct msm_sync_fence *msmfb_overlay_release(struct fb_info *info,
+						    int ndx, bool play)
+{
+	struct msmfb_info *msmfb = info->par;
+	struct msm_sync_timeline *timeline;
+	struct msm_sync_fence *fence = NULL;
+
+	if (ndx <= 0 || ndx > MSMFB_FENCE_PIPES)
+		return play ? ERR_PTR(-EINVAL) : NULL;
+	ndx--;
+
+	mutex_lock(&msmfb->fence_lock);
+	timeline = msmfb->release_timeline[ndx];
+	if (timeline == NULL && play) {
+		timeline = msm_sync_timeline_create("msmfb-overlay");
+		if (IS_ERR(timeline)) {
+			fence = ERR_CAST(timeline);
+			goto done;
+		}
+		msmfb->release_timeline[ndx] = timeline;
+	}
+	if (timeline == NULL)
+		goto done;
+
+	msm_sync_timeline_signal(timeline, msmfb->release_count[ndx]);
+	if (play)
+		fence = msm_sync_fence_create(timeline,
+					      ++msmfb->release_count[ndx]);
+done:
+	mutex_unlock(&msmfb->fence_lock);
+	return fence;
+}
+
 static int msmfb_overlay_unset(struct fb_info *info, unsigned long *argp)
 {
 	int	ret, ndx;
@@ -797,7 +1238,10 @@ static int msmfb_overlay_unset(struct fb_info *info, unsigned long *argp)
 		return ret;
 	}
 
-	return mdp->overlay_unset(mdp, info, ndx);
+	ret = mdp->overlay_unset(mdp, info, ndx);
+	if (ret == 0)
+		msmfb_overlay_release(info, ndx, false);
+	return ret;
 }
 
 static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
@@ -826,8 +1270,54 @@ static int msmfb_overlay_play(struct fb_info *info, unsigned long *argp)
 	if (p_src_file)
 		put_pmem_file(p_src_file);
 
+	/* the buffer of an earlier fenced play is no longer read */
+	if (ret == 0)
+		msmfb_overlay_release(info, req.id, false);
+
 	return ret;
 }
+static int msmfb_overlay_play_fence(struct fb_info *info, void __user *p)
+{
+	struct msmfb_overlay_data_fence req;
+	struct file *p_src_file = 0;
+	struct msmfb_info *msmfb = info->par;
+	struct msm_sync_fence *fence;
+	int ret;
+
+	if (copy_from_user(&req, p, sizeof(req)))
+		return -EFAULT;
+
+	ret = msm_sync_fence_wait_fd(req.in_fence, MSMFB_FENCE_WAIT_MS);
+	if (ret)
+		return ret;
+
+	ret = mdp->overlay_play(mdp, info, &req.data, &p_src_file);
+
+	if (ret == 0 && (mdp->overrides & MSM_MDP_FORCE_UPDATE)
+			&& msmfb->sleeping == AWAKE) {
+		msmfb_pan_update(info,
+			0, 0, info->var.xres, info->var.yres,
+			info->var.yoffset, 1);
+	}
+
+	if (p_src_file)
+		put_pmem_file(p_src_file);
+	if (ret)
+		return ret;
+
+	fence = msmfb_overlay_release(info, req.data.id, true);
+	if (IS_ERR(fence))
+		return PTR_ERR(fence);
+
+	req.out_fence = fence->fd;
+	if (copy_to_user(p, &req, sizeof(req))) {
+		msm_sync_fence_discard(fence);
+		return -EFAULT;
+	}
+	msm_sync_fence_install(fence);
+	return 0;
+}
+
 #ifdef CONFIG_FB_MSM_WRITE_BACK
 static int msmfb_overlay_blt(struct fb_info *info, unsigned long *argp)
 {
@@ -995,6 +1485,12 @@ static int msmfb_ioctl(struct fb_info *p, unsigned int cmd, unsigned long arg)
 		       ktime_to_ns(t2) - ktime_to_ns(t1));
 #endif
 		break;
+	case MSMFB_BLIT_FENCE:
+		ret = msmfb_blit_fence(p, argp);
+		break;
+	case MSMFB_UPDATE_RECTS:
+		ret = msmfb_update_rects(p, argp);
+		break;
 #ifdef CONFIG_FB_MSM_OVERLAY
 	case MSMFB_OVERLAY_GET:
 		if(!atomic_read(&mdpclk_on)) {
@@ -1023,6 +1519,13 @@ static int msmfb_ioctl(struct fb_info *p, unsigned int cmd, unsigned long arg)
 		} else
 			ret = msmfb_overlay_play(p, argp);
 		break;
+	case MSMFB_OVERLAY_PLAY_FENCE:
+		if(!atomic_read(&mdpclk_on)) {
+			PR_DISP_ERR("MSMFB_OVERLAY_PLAY_FENCE during suspend\n");
+			ret = -EINVAL;
+		} else
+			ret = msmfb_overlay_play_fence(p, argp);
+		break;
 	case MSMFB_OVERLAY_CHANGE_ZORDER_VG_PIPES:
 		if(!atomic_read(&mdpclk_on)) {
 			PR_DISP_ERR("MSMFB_OVERLAY_CHANGE_ZORDER_VG_PIPES during suspend\n");
@@ -1102,6 +1605,14 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 		       msmfb->sleeping);
 	n += scnprintf(buffer + n, debug_bufmax, "update_frame %d\n",
 		       msmfb->update_frame);
+	n += scnprintf(buffer + n, debug_bufmax, "dirty_count %d\n",
+		       msmfb->dirty_count);
+	n += scnprintf(buffer + n, debug_bufmax, "frames %lu dmas %lu\n",
+		       msmfb->stats.frames, msmfb->stats.dmas);
+	n += scnprintf(buffer + n, debug_bufmax, "pixels drawn %llu sent %llu\n",
+		       msmfb->stats.pixels_drawn, msmfb->stats.pixels_sent);
+	n += scnprintf(buffer + n, debug_bufmax, "pixels/s %llu\n",
+		       msmfb->stats.pixels_per_sec);
 	spin_unlock_irqrestore(&msmfb->update_lock, irq_flags);
 	n++;
 	buffer[n] = 0;
@@ -1261,6 +1772,10 @@ static int msmfb_probe(struct platform_device *pdev)
 
 	spin_lock_init(&msmfb->update_lock);
 	mutex_init(&msmfb->panel_init_lock);
+	mutex_init(&msmfb->fence_lock);
+	msmfb->blit_timeline = msm_sync_timeline_create("msmfb-blit");
+	if (IS_ERR(msmfb->blit_timeline))
+		msmfb->blit_timeline = NULL;
 	init_waitqueue_head(&msmfb->frame_wq);
 	msmfb->resume_workqueue = create_rt_workqueue("panel_on");
 	if (msmfb->resume_workqueue == NULL) {
@@ -1269,6 +1784,7 @@ static int msmfb_probe(struct platform_device *pdev)
 		goto error_create_workqueue;
 	}
 	INIT_WORK(&msmfb->resume_work, power_on_panel);
+	INIT_WORK(&msmfb->vsync_work, msmfb_vsync_work);
 	msmfb->black = kzalloc(msmfb->fb->var.bits_per_pixel*msmfb->xres,
 			       GFP_KERNEL);
 
@@ -1281,6 +1797,7 @@ static int msmfb_probe(struct platform_device *pdev)
 		msmfb->early_suspend.suspend = msmfb_suspend;
 		msmfb->early_suspend.resume = msmfb_resume_handler;
 		msmfb->early_suspend.level = EARLY_SUSPEND_LEVEL_DISABLE_FB;
+		msmfb->early_suspend.async = true;
 		register_early_suspend(&msmfb->early_suspend);
 
 		msmfb->earlier_suspend.suspend = msmfb_earlier_suspend;
@@ -1310,6 +1827,9 @@ static int msmfb_probe(struct platform_device *pdev)
 	       msmfb->xres, msmfb->yres);
 
 	msmfb->dma_callback.func = msmfb_handle_dma_interrupt;
+	tasklet_init(&msmfb->dma_tasklet, msmfb_dma_tasklet,
+		     (unsigned long)msmfb);
+	msmfb->stats.window_start = ktime_get();
 	msmfb->vsync_callback.func = msmfb_handle_vsync_interrupt;
 	hrtimer_init(&msmfb->fake_vsync, CLOCK_MONOTONIC,
 		     HRTIMER_MODE_REL);
@@ -1331,10 +1851,6 @@ static int msmfb_probe(struct platform_device *pdev)
 #ifdef CONFIG_FB_MSM_LOGO
 	if (!load_565rle_image(INIT_IMAGE_FILE)) {
 		/* Flip buffer */
-		msmfb->update_info.left = 0;
-		msmfb->update_info.top = 0;
-		msmfb->update_info.eright = info->var.xres;
-		msmfb->update_info.ebottom = info->var.yres;
 		msmfb_pan_update(info, 0, 0, fb->var.xres,
 				 fb->var.yres, 0, 1);
 	}
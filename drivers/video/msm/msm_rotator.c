@@ -74,6 +74,7 @@
 #include <linux/file.h>
 #include <linux/major.h>
 #include <linux/fb.h>
+#include <linux/msm_sync.h>
 #include <mach/debug_display.h>
 
 #define DRIVER_NAME "msm_rotator"
@@ -157,8 +158,14 @@ struct msm_rotator_dev {
 	struct mutex imem_lock;
 	int imem_owner;
 	wait_queue_head_t wq;
+	/* fences of MSM_ROTATOR_IOCTL_ROTATE_FENCE */
+	struct msm_sync_timeline *timeline;
+	uint32_t timeline_count;
 };
 
+/* how long a fenced rotation waits for its in_fence */
+#define MSM_ROTATOR_FENCE_WAIT_MS	1000
+
 #define chroma_addr(start, w, h, bpp) ((start) + ((h) * (w) * (bpp)))
 
 #define COMPONENT_5BITS 1
@@ -758,11 +765,10 @@ static int get_img(int memory_id, unsigned long *start, unsigned long *len,
 	return ret;
 }
 
-static int msm_rotator_do_rotate(unsigned long arg)
+static int msm_rotator_rotate(struct msm_rotator_data_info *info)
 {
 	int rc = 0;
 	unsigned int status;
-	struct msm_rotator_data_info info;
 	unsigned int in_paddr, out_paddr;
 	unsigned long len;
 	struct file *src_file = 0;
@@ -770,31 +776,28 @@ static int msm_rotator_do_rotate(unsigned long arg)
 	int use_imem = 0;
 	int s;
 
-	if (copy_from_user(&info, (void __user *)arg, sizeof(info)))
-		return -EFAULT;
-
-	rc = get_img(info.src.memory_id, (unsigned long *)&in_paddr,
+	rc = get_img(info->src.memory_id, (unsigned long *)&in_paddr,
 			(unsigned long *)&len, &src_file);
 	if (rc) {
 		PR_DISP_ERR("%s: in get_img() failed id=0x%08x\n",
-		       DRIVER_NAME, info.src.memory_id);
+		       DRIVER_NAME, info->src.memory_id);
 		return rc;
 	}
-	in_paddr += info.src.offset;
+	in_paddr += info->src.offset;
 
-	rc = get_img(info.dst.memory_id, (unsigned long *)&out_paddr,
+	rc = get_img(info->dst.memory_id, (unsigned long *)&out_paddr,
 			(unsigned long *)&len, &dst_file);
 	if (rc) {
 		PR_DISP_ERR("%s: out get_img() failed id=0x%08x\n",
-		       DRIVER_NAME, info.dst.memory_id);
+		       DRIVER_NAME, info->dst.memory_id);
 		return rc;
 	}
-	out_paddr += info.dst.offset;
+	out_paddr += info->dst.offset;
 
 	mutex_lock(&msm_rotator_dev->rotator_lock);
 	for (s = 0; s < MAX_SESSIONS; s++)
 		if ((msm_rotator_dev->img_info[s] != NULL) &&
-			(info.session_id ==
+			(info->session_id ==
 			(unsigned int)msm_rotator_dev->img_info[s]
 			))
 			break;
@@ -921,6 +924,58 @@ do_rotate_unlock_mutex:
 	return rc;
 }
 
+static int msm_rotator_do_rotate(unsigned long arg)
+{
+	struct msm_rotator_data_info info;
+
+	if (copy_from_user(&info, (void __user *)arg, sizeof(info)))
+		return -EFAULT;
+
+	return msm_rotator_rotate(&info);
+}
+
+/* The rotation is done by the time msm_rotator_rotate returns, so the out
+ * fence is already signaled; it is there so the consumer of the rotated
+ * buffer can take the same fence from every engine.
+ */
+static int msm_rotator_do_rotate_fence(unsigned long arg)
+{
+	struct msm_rotator_data_info_fence req;
+	struct msm_sync_fence *fence;
+	uint32_t count;
+	int rc;
+
+	if (msm_rotator_dev->timeline == NULL)
+		return -ENODEV;
+
+	if (copy_from_user(&req, (void __user *)arg, sizeof(req)))
+		return -EFAULT;
+
+	rc = msm_sync_fence_wait_fd(req.in_fence, MSM_ROTATOR_FENCE_WAIT_MS);
+	if (rc)
+		return rc;
+
+	rc = msm_rotator_rotate(&req.info);
+	if (rc)
+		return rc;
+
+	mutex_lock(&msm_rotator_dev->rotator_lock);
+	count = ++msm_rotator_dev->timeline_count;
+	msm_sync_timeline_signal(msm_rotator_dev->timeline, count);
+	fence = msm_sync_fence_create(msm_rotator_dev->timeline, count);
+	mutex_unlock(&msm_rotator_dev->rotator_lock);
+	if (IS_ERR(fence))
+		return PTR_ERR(fence);
+
+	req.out_fence = fence->fd;
+	if (copy_to_user((void __user *)arg, &req, sizeof(req))) {
+		msm_sync_fence_discard(fence);
+		return -EFAULT;
+	}
+	msm_sync_fence_install(fence);
+	return 0;
+}
+
 static int msm_rotator_start(unsigned long arg)
 {
 	struct msm_rotator_img_info info;
@@ -1079,6 +1134,8 @@ static int msm_rotator_ioctl(struct inode *inode, struct file *file,
 		return msm_rotator_start(arg);
 	case MSM_ROTATOR_IOCTL_ROTATE:
 		return msm_rotator_do_rotate(arg);
+	case MSM_ROTATOR_IOCTL_ROTATE_FENCE:
+		return msm_rotator_do_rotate_fence(arg);
 	case MSM_ROTATOR_IOCTL_FINISH:
 		return msm_rotator_finish(arg);
 
@@ -1255,6 +1312,10 @@ static int __devinit msm_rotator_probe(struct platform_device *pdev)
 		goto error_class_device_create;
 	}
 
+	msm_rotator_dev->timeline = msm_sync_timeline_create(DRIVER_NAME);
+	if (IS_ERR(msm_rotator_dev->timeline))
+		msm_rotator_dev->timeline = NULL;
+
 	cdev_init(&msm_rotator_dev->cdev, &msm_rotator_fops);
 	rc = cdev_add(&msm_rotator_dev->cdev,
 		      MKDEV(MAJOR(msm_rotator_dev->dev_num), 0),
@@ -1270,6 +1331,8 @@ static int __devinit msm_rotator_probe(struct platform_device *pdev)
 	return rc;
 
 error_cdev_add:
+	if (msm_rotator_dev->timeline)
+		msm_sync_timeline_destroy(msm_rotator_dev->timeline);
 	device_destroy(msm_rotator_dev->class, msm_rotator_dev->dev_num);
 error_class_device_create:
 	class_destroy(msm_rotator_dev->class);
@@ -1296,6 +1359,8 @@ static int __devexit msm_rotator_remove(struct platform_device *plat_dev)
 {
 	int i;
 
+	if (msm_rotator_dev->timeline)
+		msm_sync_timeline_destroy(msm_rotator_dev->timeline);
 	free_irq(msm_rotator_dev->irq, NULL);
 	mutex_destroy(&msm_rotator_dev->rotator_lock);
 	cdev_del(&msm_rotator_dev->cdev);
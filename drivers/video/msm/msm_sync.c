@@ -0,0 +1,408 @@
+/* drivers/video/msm/msm_sync.c
+ *
+ * Sync points shared between the GPU, MDP and rotator drivers.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/poll.h>
+#include <linux/sched.h>
+#include <linux/uaccess.h>
+#include <linux/anon_inodes.h>
+#include <linux/miscdevice.h>
+#include <linux/msm_sync.h>
+
+/* timelines count up and may wrap, like the KGSL timestamps */
+static inline bool msm_sync_passed(uint32_t value, uint32_t point)
+{
+	return (int32_t)(value - point) >= 0;
+}
+
+static void msm_sync_timeline_free(struct kref *kref)
+{
+	struct msm_sync_timeline *timeline =
+		container_of(kref, struct msm_sync_timeline, kref);
+
+	kfree(timeline);
+}
+
+struct msm_sync_timeline *msm_sync_timeline_create(const char *name)
+{
+	struct msm_sync_timeline *timeline;
+
+	timeline = kzalloc(sizeof(*timeline), GFP_KERNEL);
+	if (!timeline)
+		return ERR_PTR(-ENOMEM);
+
+	timeline->name = name;
+	spin_lock_init(&timeline->lock);
+	INIT_LIST_HEAD(&timeline->active);
+	kref_init(&timeline->kref);
+
+	return timeline;
+}
+EXPORT_SYMBOL(msm_sync_timeline_create);
+
+static void msm_sync_fence_free(struct kref *kref)
+{
+	struct msm_sync_fence *fence =
+		container_of(kref, struct msm_sync_fence, kref);
+
+	kref_put(&fence->timeline->kref, msm_sync_timeline_free);
+	kfree(fence);
+}
+
+void msm_sync_fence_put(struct msm_sync_fence *fence)
+{
+	kref_put(&fence->kref, msm_sync_fence_free);
+}
+EXPORT_SYMBOL(msm_sync_fence_put);
+
+/* Signal every active fence up to the current value with status.  The
+ * reference the active list held is dropped after the lock.  Caller
+ * holds timeline->lock.
+ */
+static void msm_sync_timeline_update(struct msm_sync_timeline *timeline,
+				     int status, struct list_head *done)
+{
+	struct msm_sync_fence *fence, *fence_tmp;
+
+	list_for_each_entry_safe(fence, fence_tmp, &timeline->active, list) {
+		if (status > 0 && !msm_sync_passed(timeline->value,
+						   fence->value))
+			continue;
+		fence->status = status;
+		list_move(&fence->list, done);
+		wake_up_all(&fence->wq);
+	}
+}
+
+static void msm_sync_fence_put_list(struct list_head *done)
+{
+	struct msm_sync_fence *fence, *fence_tmp;
+
+	list_for_each_entry_safe(fence, fence_tmp, done, list) {
+		list_del_init(&fence->list);
+		msm_sync_fence_put(fence);
+	}
+}
+
+/* Any fence still waiting on a destroyed timeline fails with -ENOENT */
+void msm_sync_timeline_destroy(struct msm_sync_timeline *timeline)
+{
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&timeline->lock, flags);
+	msm_sync_timeline_update(timeline, -ENOENT, &done);
+	spin_unlock_irqrestore(&timeline->lock, flags);
+
+	msm_sync_fence_put_list(&done);
+	kref_put(&timeline->kref, msm_sync_timeline_free);
+}
+EXPORT_SYMBOL(msm_sync_timeline_destroy);
+
+/* Move the timeline to value and signal the fences it has reached.  The
+ * value may also go backwards, for a device that restarted its counter.
+ * Can be called from interrupt context.
+ */
+void msm_sync_timeline_signal(struct msm_sync_timeline *timeline,
+			      uint32_t value)
+{
+	unsigned long flags;
+	LIST_HEAD(done);
+
+	spin_lock_irqsave(&timeline->lock, flags);
+	timeline->value = value;
+	msm_sync_timeline_update(timeline, 1, &done);
+	spin_unlock_irqrestore(&timeline->lock, flags);
+
+	msm_sync_fence_put_list(&done);
+}
+EXPORT_SYMBOL(msm_sync_timeline_signal);
+
+/* Returns true, and the lowest value still waited for, if any fence on
+ * the timeline is active, so the driver knows to keep its interrupt on.
+ */
+bool msm_sync_timeline_pending(struct msm_sync_timeline *timeline,
+			       uint32_t *value)
+{
+	struct msm_sync_fence *fence;
+	unsigned long flags;
+	bool pending = false;
+
+	spin_lock_irqsave(&timeline->lock, flags);
+	list_for_each_entry(fence, &timeline->active, list) {
+		if (!pending || msm_sync_passed(*value, fence->value))
+			*value = fence->value;
+		pending = true;
+	}
+	spin_unlock_irqrestore(&timeline->lock, flags);
+
+	return pending;
+}
+EXPORT_SYMBOL(msm_sync_timeline_pending);
+
+int msm_sync_fence_wait(struct msm_sync_fence *fence, long timeout_ms)
+{
+	long ret;
+
+	if (timeout_ms < 0)
+		ret = wait_event_interruptible(fence->wq, fence->status);
+	else {
+		ret = wait_event_interruptible_timeout(fence->wq,
+				fence->status, msecs_to_jiffies(timeout_ms));
+		if (ret == 0 && !fence->status)
+			return -ETIME;
+	}
+	if (ret < 0)
+		return ret;
+
+	return fence->status < 0 ? fence->status : 0;
+}
+EXPORT_SYMBOL(msm_sync_fence_wait);
+
+static int msm_sync_fence_release(struct inode *inode, struct file *file)
+{
+	msm_sync_fence_put(file->private_data);
+	return 0;
+}
+
+static unsigned int msm_sync_fence_poll(struct file *file, poll_table *wait)
+{
+	struct msm_sync_fence *fence = file->private_data;
+
+	poll_wait(file, &fence->wq, wait);
+
+	if (fence->status > 0)
+		return POLLIN;
+	if (fence->status < 0)
+		return POLLERR;
+	return 0;
+}
+
+static long msm_sync_fence_ioctl(struct file *file, unsigned int cmd,
+				 unsigned long arg)
+{
+	struct msm_sync_fence *fence = file->private_data;
+	int timeout;
+
+	switch (cmd) {
+	case MSM_SYNC_IOC_WAIT:
+		if (copy_from_user(&timeout, (void __user *)arg,
+				   sizeof(timeout)))
+			return -EFAULT;
+		return msm_sync_fence_wait(fence, timeout);
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations msm_sync_fence_fops = {
+	.release = msm_sync_fence_release,
+	.poll = msm_sync_fence_poll,
+	.unlocked_ioctl = msm_sync_fence_ioctl,
+};
+
+/* Create a fence at value on the timeline, with an fd reserved for it
+ * in fence->fd.  A value the timeline has already passed gives a signaled
+ * fence.  The fd only becomes visible to userspace with
+ * msm_sync_fence_install(), so the caller can first copy it out and undo
+ * a failed copy with msm_sync_fence_discard(); closing an installed fd
+ * would race with another thread of the process already using it.
+ */
+struct msm_sync_fence *msm_sync_fence_create(
+		struct msm_sync_timeline *timeline, uint32_t value)
+{
+	struct msm_sync_fence *fence;
+	unsigned long flags;
+	int ret;
+
+	fence = kzalloc(sizeof(*fence), GFP_KERNEL);
+	if (!fence)
+		return ERR_PTR(-ENOMEM);
+
+	fence->fd = get_unused_fd();
+	if (fence->fd < 0) {
+		ret = fence->fd;
+		kfree(fence);
+		return ERR_PTR(ret);
+	}
+
+	fence->file = anon_inode_getfile(timeline->name, &msm_sync_fence_fops,
+					 fence, O_RDWR);
+	if (IS_ERR(fence->file)) {
+		put_unused_fd(fence->fd);
+		ret = PTR_ERR(fence->file);
+		kfree(fence);
+		return ERR_PTR(ret);
+	}
+
+	fence->value = value;
+	INIT_LIST_HEAD(&fence->list);
+	init_waitqueue_head(&fence->wq);
+	/* one reference for the file, one for the active list */
+	kref_init(&fence->kref);
+	kref_get(&timeline->kref);
+	fence->timeline = timeline;
+
+	spin_lock_irqsave(&timeline->lock, flags);
+	if (msm_sync_passed(timeline->value, value))
+		fence->status = 1;
+	else {
+		kref_get(&fence->kref);
+		list_add_tail(&fence->list, &timeline->active);
+	}
+	spin_unlock_irqrestore(&timeline->lock, flags);
+
+	return fence;
+}
+EXPORT_SYMBOL(msm_sync_fence_create);
+
+/* Hand fence->fd to userspace; the fence belongs to the fd from now on */
+int msm_sync_fence_install(struct msm_sync_fence *fence)
+{
+	int fd = fence->fd;
+
+	fd_install(fd, fence->file);
+	return fd;
+}
+EXPORT_SYMBOL(msm_sync_fence_install);
+
+/* Drop a fence that was never installed, along with its reserved fd */
+void msm_sync_fence_discard(struct msm_sync_fence *fence)
+{
+	put_unused_fd(fence->fd);
+	fput(fence->file);
+}
+EXPORT_SYMBOL(msm_sync_fence_discard);
+
+struct msm_sync_fence *msm_sync_fence_fdget(int fd)
+{
+	struct msm_sync_fence *fence;
+	struct file *file;
+
+	file = fget(fd);
+	if (!file)
+		return ERR_PTR(-EBADF);
+
+	if (file->f_op != &msm_sync_fence_fops) {
+		fput(file);
+		return ERR_PTR(-EINVAL);
+	}
+
+	fence = file->private_data;
+	kref_get(&fence->kref);
+	fput(file);
+
+	return fence;
+}
+EXPORT_SYMBOL(msm_sync_fence_fdget);
+
+/* For drivers taking an in-fence fd, a negative fd means no fence */
+int msm_sync_fence_wait_fd(int fd, long timeout_ms)
+{
+	struct msm_sync_fence *fence;
+	int ret;
+
+	if (fd < 0)
+		return 0;
+
+	fence = msm_sync_fence_fdget(fd);
+	if (IS_ERR(fence))
+		return PTR_ERR(fence);
+
+	ret = msm_sync_fence_wait(fence, timeout_ms);
+	msm_sync_fence_put(fence);
+
+	return ret;
+}
+EXPORT_SYMBOL(msm_sync_fence_wait_fd);
+
+#ifdef CONFIG_MSM_SW_SYNC
+static int msm_sw_sync_open(struct inode *inode, struct file *file)
+{
+	struct msm_sync_timeline *timeline;
+
+	timeline = msm_sync_timeline_create("msm_sw_sync");
+	if (IS_ERR(timeline))
+		return PTR_ERR(timeline);
+
+	file->private_data = timeline;
+	return 0;
+}
+
+static int msm_sw_sync_release(struct inode *inode, struct file *file)
+{
+	msm_sync_timeline_destroy(file->private_data);
+	return 0;
+}
+
+static long msm_sw_sync_ioctl(struct file *file, unsigned int cmd,
+			      unsigned long arg)
+{
+	struct msm_sync_timeline *timeline = file->private_data;
+	struct msm_sw_sync_create_fence create;
+	struct msm_sync_fence *fence;
+	uint32_t count;
+
+	switch (cmd) {
+	case MSM_SW_SYNC_IOC_CREATE_FENCE:
+		if (copy_from_user(&create, (void __user *)arg,
+				   sizeof(create)))
+			return -EFAULT;
+		fence = msm_sync_fence_create(timeline, create.value);
+		if (IS_ERR(fence))
+			return PTR_ERR(fence);
+		create.fence = fence->fd;
+		if (copy_to_user((void __user *)arg, &create,
+				 sizeof(create))) {
+			msm_sync_fence_discard(fence);
+			return -EFAULT;
+		}
+		msm_sync_fence_install(fence);
+		return 0;
+
+	case MSM_SW_SYNC_IOC_INC:
+		if (copy_from_user(&count, (void __user *)arg, sizeof(count)))
+			return -EFAULT;
+		msm_sync_timeline_signal(timeline, timeline->value + count);
+		return 0;
+
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations msm_sw_sync_fops = {
+	.owner = THIS_MODULE,
+	.open = msm_sw_sync_open,
+	.release = msm_sw_sync_release,
+	.unlocked_ioctl = msm_sw_sync_ioctl,
+};
+
+static struct miscdevice msm_sw_sync_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "msm_sw_sync",
+	.fops = &msm_sw_sync_fops,
+};
+
+static int __init msm_sw_sync_init(void)
+{
+	return misc_register(&msm_sw_sync_dev);
+}
+device_initcall(msm_sw_sync_init);
+#endif /* CONFIG_MSM_SW_SYNC */
@@ -40,6 +40,8 @@ struct cpuidle_state {
 
 	unsigned long long	usage;
 	unsigned long long	time; /* in US */
+	unsigned long long	above; /* idle shorter than target_residency */
+	unsigned long long	below; /* idle long enough for a deeper state */
 
 	int (*enter)	(struct cpuidle_device *dev,
 			 struct cpuidle_state *state);
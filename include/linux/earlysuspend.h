@@ -29,6 +29,10 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers that set async may run concurrently with the other handlers of the
+ * same level; a level is only left once all of its handlers have returned.
+ * The time each handler took last time it was called is shown in
+ * /sys/power/resume_stats.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
@@ -41,6 +45,9 @@ struct early_suspend {
 	int level;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	bool async;
+	unsigned long suspend_us;
+	unsigned long resume_us;
 #endif
 };
 
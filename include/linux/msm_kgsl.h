@@ -403,6 +403,38 @@ struct kgsl_cmdwindow_write {
 #define IOCTL_KGSL_CMDWINDOW_WRITE \
 	_IOW(KGSL_IOC_TYPE, 0x2e, struct kgsl_cmdwindow_write)
 
+/* issue a list of indirect buffers to the GPU in one call.
+ * ibdesc_addr points to an array of numibs struct kgsl_ibdesc, of which
+ * gpuaddr and sizedwords are used; each must specify a subset of a
+ * buffer created with IOCTL_KGSL_SHAREDMEM_FROM_PMEM.  The buffers are
+ * executed in order for drawctxt_id and retire under a single
+ * timestamp.  flags may be a mask of KGSL_CONTEXT_ values.
+ */
+#define KGSL_IBLIST_MAX		64
+
+struct kgsl_ringbuffer_issueiblist {
+	unsigned int drawctxt_id;
+	unsigned int ibdesc_addr;
+	unsigned int numibs;
+	unsigned int timestamp; /*output param */
+	unsigned int flags;
+};
+
+#define IOCTL_KGSL_RINGBUFFER_ISSUEIBLIST \
+	_IOWR(KGSL_IOC_TYPE, 0x26, struct kgsl_ringbuffer_issueiblist)
+
+/* get a fence fd, see linux/msm_sync.h, that signals when timestamp
+ * retires.  It can be passed to the MDP and rotator ioctls taking an
+ * in_fence instead of calling IOCTL_KGSL_DEVICE_WAITTIMESTAMP first.
+ */
+struct kgsl_timestamp_fence {
+	unsigned int timestamp;
+	int fence_fd; /* output param */
+};
+
+#define IOCTL_KGSL_TIMESTAMP_FENCE \
+	_IOWR(KGSL_IOC_TYPE, 0x27, struct kgsl_timestamp_fence)
+
 #ifdef __KERNEL__
 #ifdef CONFIG_MSM_KGSL_DRM
 int kgsl_gem_obj_addr(int drm_fd, int handle, unsigned long *start,
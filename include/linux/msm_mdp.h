@@ -19,6 +19,10 @@
 #define MSMFB_IOCTL_MAGIC 'm'
 #define MSMFB_GRP_DISP          _IOW(MSMFB_IOCTL_MAGIC, 1, unsigned int)
 #define MSMFB_BLIT              _IOW(MSMFB_IOCTL_MAGIC, 2, unsigned int)
+#define MSMFB_BLIT_FENCE       _IOWR(MSMFB_IOCTL_MAGIC, 148, \
+						struct msmfb_blit_fence)
+#define MSMFB_UPDATE_RECTS      _IOW(MSMFB_IOCTL_MAGIC, 150, \
+						struct msmfb_update_rects)
 #ifdef CONFIG_MSM_MDP40
 #define MSMFB_SUSPEND_SW_REFRESHER _IOW(MSMFB_IOCTL_MAGIC, 128, unsigned int)
 #define MSMFB_RESUME_SW_REFRESHER _IOW(MSMFB_IOCTL_MAGIC, 129, unsigned int)
@@ -48,6 +52,8 @@
 #define MSMFB_OVERLAY_CHANGE_ZORDER_VG_PIPES	_IOW(MSMFB_IOCTL_MAGIC, 146, unsigned int)
 #define MSMFB_OVERLAY_3D       _IOWR(MSMFB_IOCTL_MAGIC, 147, \
 						struct msmfb_overlay_3d)
+#define MSMFB_OVERLAY_PLAY_FENCE _IOWR(MSMFB_IOCTL_MAGIC, 149, \
+						struct msmfb_overlay_data_fence)
 
 #endif
 
@@ -176,6 +182,37 @@ struct mdp_blit_req_list {
 	struct mdp_blit_req req[];
 };
 
+/* Fenced versions of MSMFB_BLIT and MSMFB_OVERLAY_PLAY, the fences are
+ * fds from linux/msm_sync.h.  The request waits for in_fence first, -1
+ * for none.  The blit out_fence signals when the blits are done, the play
+ * out_fence when the pipe no longer reads the buffer, that is once the
+ * next play on the same pipe is done or the pipe is unset.
+ *
+ * On an MDP with a blit queue MSMFB_BLIT_FENCE returns as soon as the
+ * blits are checked and queued, and the images must not be touched until
+ * out_fence signals; at most MSMFB_BLIT_FENCE_MAX_REQS blits per list.
+ */
+#define MSMFB_BLIT_FENCE_MAX_REQS	32
+
+struct msmfb_blit_fence {
+	int in_fence;
+	int out_fence;
+	struct mdp_blit_req_list *list;
+};
+
+/* Like a pan to yoffset, but only the rects given are sent to the panel.
+ * They are clipped to the screen, and merged where sending the bounding
+ * box costs less than one more transfer.  Panels without partial update
+ * support get a full update.
+ */
+#define MSMFB_UPDATE_MAX_RECTS	16
+
+struct msmfb_update_rects {
+	uint32_t yoffset;
+	uint32_t count;
+	struct mdp_rect *rects;
+};
+
 #define MSMFB_DATA_VERSION 2
 
 #ifdef CONFIG_MSM_MDP40
@@ -202,6 +239,12 @@ struct msmfb_overlay_data {
 	struct msmfb_data data;
 };
 
+struct msmfb_overlay_data_fence {
+	struct msmfb_overlay_data data;
+	int in_fence;
+	int out_fence;
+};
+
 struct msmfb_img {
 	uint32_t width;
 	uint32_t height;
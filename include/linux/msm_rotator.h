@@ -41,6 +41,9 @@
 		_IOW(MSM_ROTATOR_IOCTL_MAGIC, 2, struct msm_rotator_data_info)
 #define MSM_ROTATOR_IOCTL_FINISH   \
 		_IOW(MSM_ROTATOR_IOCTL_MAGIC, 3, int)
+#define MSM_ROTATOR_IOCTL_ROTATE_FENCE   \
+		_IOWR(MSM_ROTATOR_IOCTL_MAGIC, 4, \
+			struct msm_rotator_data_info_fence)
 
 enum rotator_clk_type {
 	ROTATOR_AXICLK_CLK,
@@ -65,6 +68,14 @@ struct msm_rotator_data_info {
 	struct msmfb_data dst;
 };
 
+/* MSM_ROTATOR_IOCTL_ROTATE waiting for in_fence first, -1 for none, and
+ * returning out_fence for the end of the rotation, see linux/msm_sync.h */
+struct msm_rotator_data_info_fence {
+	struct msm_rotator_data_info info;
+	int in_fence;
+	int out_fence;
+};
+
 struct msm_rot_clocks {
 	const char *clk_name;
 	enum rotator_clk_type clk_type;
@@ -0,0 +1,141 @@
+/* include/linux/msm_sync.h
+ *
+ * Sync points shared between the GPU, MDP and rotator drivers.
+ *
+ * A timeline is a 32 bit counter owned by one driver, which moves it
+ * forward as its hardware completes work.  A fence is a point on a
+ * timeline, handed to userspace as a file descriptor, that signals once
+ * the timeline reaches it.  Fences returned by one driver can be given
+ * to another one as the point to wait for before touching a buffer.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#ifndef _LINUX_MSM_SYNC_H
+#define _LINUX_MSM_SYNC_H
+
+#include <linux/types.h>
+#include <linux/ioctl.h>
+
+#define MSM_SYNC_IOC_MAGIC	'>'
+
+/* on a fence fd: wait for the fence, timeout in ms, -1 for no timeout */
+#define MSM_SYNC_IOC_WAIT	_IOW(MSM_SYNC_IOC_MAGIC, 0, int)
+
+/* /dev/msm_sw_sync: every open file is a timeline that only moves
+ * forward on MSM_SW_SYNC_IOC_INC, for testing fence users without the
+ * hardware behind them */
+struct msm_sw_sync_create_fence {
+	uint32_t value;
+	int fence;		/* fd returned */
+};
+
+#define MSM_SW_SYNC_IOC_CREATE_FENCE \
+		_IOWR(MSM_SYNC_IOC_MAGIC, 1, struct msm_sw_sync_create_fence)
+#define MSM_SW_SYNC_IOC_INC	_IOW(MSM_SYNC_IOC_MAGIC, 2, uint32_t)
+
+#ifdef __KERNEL__
+
+#include <linux/err.h>
+#include <linux/errno.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+struct file;
+
+struct msm_sync_timeline {
+	const char *name;
+	spinlock_t lock;
+	uint32_t value;			/* last value signaled */
+	struct list_head active;	/* fences not signaled yet */
+	struct kref kref;
+};
+
+struct msm_sync_fence {
+	struct msm_sync_timeline *timeline;
+	uint32_t value;
+	int status;			/* 0 active, 1 signaled, < 0 error */
+	struct list_head list;		/* on timeline->active */
+	wait_queue_head_t wq;
+	struct kref kref;
+	struct file *file;
+	int fd;				/* reserved until installed */
+};
+
+#ifdef CONFIG_MSM_SYNC
+
+struct msm_sync_timeline *msm_sync_timeline_create(const char *name);
+void msm_sync_timeline_destroy(struct msm_sync_timeline *timeline);
+void msm_sync_timeline_signal(struct msm_sync_timeline *timeline,
+			      uint32_t value);
+bool msm_sync_timeline_pending(struct msm_sync_timeline *timeline,
+			       uint32_t *value);
+
+struct msm_sync_fence *msm_sync_fence_create(
+		struct msm_sync_timeline *timeline, uint32_t value);
+int msm_sync_fence_install(struct msm_sync_fence *fence);
+void msm_sync_fence_discard(struct msm_sync_fence *fence);
+struct msm_sync_fence *msm_sync_fence_fdget(int fd);
+void msm_sync_fence_put(struct msm_sync_fence *fence);
+int msm_sync_fence_wait(struct msm_sync_fence *fence, long timeout_ms);
+int msm_sync_fence_wait_fd(int fd, long timeout_ms);
+
+#else
+
+static inline struct msm_sync_timeline *
+msm_sync_timeline_create(const char *name)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline void
+msm_sync_timeline_destroy(struct msm_sync_timeline *timeline)
+{
+}
+
+static inline void msm_sync_timeline_signal(
+		struct msm_sync_timeline *timeline, uint32_t value)
+{
+}
+
+static inline bool msm_sync_timeline_pending(
+		struct msm_sync_timeline *timeline, uint32_t *value)
+{
+	return false;
+}
+
+static inline struct msm_sync_fence *msm_sync_fence_create(
+		struct msm_sync_timeline *timeline, uint32_t value)
+{
+	return ERR_PTR(-ENODEV);
+}
+
+static inline int msm_sync_fence_install(struct msm_sync_fence *fence)
+{
+	return -ENODEV;
+}
+
+static inline void msm_sync_fence_discard(struct msm_sync_fence *fence)
+{
+}
+
+static inline int msm_sync_fence_wait_fd(int fd, long timeout_ms)
+{
+	return -ENODEV;
+}
+
+#endif /* CONFIG_MSM_SYNC */
+
+#endif /* __KERNEL__ */
+
+#endif /* _LINUX_MSM_SYNC_H */
@@ -6,6 +6,7 @@
 #include <linux/init.h>
 #include <linux/pm.h>
 #include <linux/mm.h>
+#include <linux/ktime.h>
 #include <asm/errno.h>
 
 #if defined(CONFIG_PM_SLEEP) && defined(CONFIG_VT) && defined(CONFIG_VT_CONSOLE)
@@ -301,6 +302,32 @@ static inline int unregister_pm_notifier(struct notifier_block *nb)
 #define pm_notifier(fn, pri)	do { (void)(fn); } while (0)
 #endif /* !CONFIG_PM_SLEEP */
 
+enum suspend_stats_step {
+	SUSPEND_STATS_SYNC,
+	SUSPEND_STATS_FREEZE,
+	SUSPEND_STATS_SUSPEND,
+	SUSPEND_STATS_RESUME,
+	SUSPEND_STATS_NR_STEPS,
+};
+
+#ifdef CONFIG_SUSPEND_ATTEMPT_STATS
+/* kernel/power/suspend_stats.c */
+extern void suspend_stats_begin(void);
+extern void suspend_stats_step(enum suspend_stats_step step, ktime_t start);
+extern void suspend_stats_device(struct device *dev, ktime_t start,
+				 int resume);
+extern void suspend_stats_abort(const char *name);
+extern void suspend_stats_end(int ret);
+#else /* !CONFIG_SUSPEND_ATTEMPT_STATS */
+static inline void suspend_stats_begin(void) {}
+static inline void suspend_stats_step(enum suspend_stats_step step,
+				      ktime_t start) {}
+static inline void suspend_stats_device(struct device *dev, ktime_t start,
+					int resume) {}
+static inline void suspend_stats_abort(const char *name) {}
+static inline void suspend_stats_end(int ret) {}
+#endif /* !CONFIG_SUSPEND_ATTEMPT_STATS */
+
 extern struct mutex pm_mutex;
 
 #ifndef CONFIG_HIBERNATION
@@ -0,0 +1,97 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM cpufreq_interactive
+
+#if !defined(_TRACE_CPUFREQ_INTERACTIVE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_CPUFREQ_INTERACTIVE_H
+
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(set,
+	TP_PROTO(u32 cpu_id, unsigned long targfreq,
+		 unsigned long actualfreq),
+	TP_ARGS(cpu_id, targfreq, actualfreq),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu_id		)
+		__field(	unsigned long,	targfreq	)
+		__field(	unsigned long,	actualfreq	)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->targfreq = targfreq;
+		__entry->actualfreq = actualfreq;
+	),
+
+	TP_printk("cpu=%u targ=%lu actual=%lu",
+		  __entry->cpu_id, __entry->targfreq,
+		  __entry->actualfreq)
+);
+
+DEFINE_EVENT(set, cpufreq_interactive_up,
+	TP_PROTO(u32 cpu_id, unsigned long targfreq,
+		 unsigned long actualfreq),
+	TP_ARGS(cpu_id, targfreq, actualfreq)
+);
+
+DEFINE_EVENT(set, cpufreq_interactive_down,
+	TP_PROTO(u32 cpu_id, unsigned long targfreq,
+		 unsigned long actualfreq),
+	TP_ARGS(cpu_id, targfreq, actualfreq)
+);
+
+TRACE_EVENT(cpufreq_interactive_target,
+	TP_PROTO(u32 cpu_id, unsigned long load, unsigned long curtarg,
+		 unsigned long newtarg, int boosted),
+	TP_ARGS(cpu_id, load, curtarg, newtarg, boosted),
+
+	TP_STRUCT__entry(
+		__field(	u32,		cpu_id		)
+		__field(	unsigned long,	load		)
+		__field(	unsigned long,	curtarg		)
+		__field(	unsigned long,	newtarg		)
+		__field(	int,		boosted		)
+	),
+
+	TP_fast_assign(
+		__entry->cpu_id = cpu_id;
+		__entry->load = load;
+		__entry->curtarg = curtarg;
+		__entry->newtarg = newtarg;
+		__entry->boosted = boosted;
+	),
+
+	TP_printk("cpu=%u load=%lu cur=%lu targ=%lu boosted=%d",
+		  __entry->cpu_id, __entry->load, __entry->curtarg,
+		  __entry->newtarg, __entry->boosted)
+);
+
+DECLARE_EVENT_CLASS(boost,
+	TP_PROTO(const char *s),
+	TP_ARGS(s),
+
+	TP_STRUCT__entry(
+		__string(s, s)
+	),
+
+	TP_fast_assign(
+		__assign_str(s, s);
+	),
+
+	TP_printk("%s", __get_str(s))
+);
+
+DEFINE_EVENT(boost, cpufreq_interactive_boost,
+	TP_PROTO(const char *s),
+	TP_ARGS(s)
+);
+
+DEFINE_EVENT(boost, cpufreq_interactive_unboost,
+	TP_PROTO(const char *s),
+	TP_ARGS(s)
+);
+
+#endif /* _TRACE_CPUFREQ_INTERACTIVE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,41 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM kgsl
+
+#if !defined(_TRACE_KGSL_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_KGSL_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(kgsl_issueibcmds,
+	TP_PROTO(unsigned int drawctxt_id, unsigned int numibs,
+		 unsigned int timestamp, unsigned int flags, int result,
+		 s64 usecs),
+	TP_ARGS(drawctxt_id, numibs, timestamp, flags, result, usecs),
+
+	TP_STRUCT__entry(
+		__field(	unsigned int,	drawctxt_id	)
+		__field(	unsigned int,	numibs		)
+		__field(	unsigned int,	timestamp	)
+		__field(	unsigned int,	flags		)
+		__field(	int,		result		)
+		__field(	s64,		usecs		)
+	),
+
+	TP_fast_assign(
+		__entry->drawctxt_id = drawctxt_id;
+		__entry->numibs = numibs;
+		__entry->timestamp = timestamp;
+		__entry->flags = flags;
+		__entry->result = result;
+		__entry->usecs = usecs;
+	),
+
+	TP_printk("ctx=%u numibs=%u ts=%u flags=0x%x result=%d usecs=%lld",
+		  __entry->drawctxt_id, __entry->numibs, __entry->timestamp,
+		  __entry->flags, __entry->result, __entry->usecs)
+);
+
+#endif /* _TRACE_KGSL_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -13,7 +13,9 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/earlysuspend.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
@@ -37,6 +39,9 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
+static LIST_HEAD(early_suspend_async_domain);
+static unsigned long early_suspend_us;
+static unsigned long late_resume_us;
 static void early_suspend(struct work_struct *work);
 static void late_resume(struct work_struct *work);
 static DECLARE_WORK(early_suspend_work, early_suspend);
@@ -90,9 +95,80 @@ EXPORT_SYMBOL(unregister_early_suspend);
 void sys_sync_debug(void);
 #endif
 
-static void early_suspend(struct work_struct *work)
+static void early_suspend_call(struct early_suspend *handler, int resume)
+{
+	ktime_t start = ktime_get();
+
+	if (resume) {
+		handler->resume(handler);
+		handler->resume_us = ktime_us_delta(ktime_get(), start);
+	} else {
+		handler->suspend(handler);
+		handler->suspend_us = ktime_us_delta(ktime_get(), start);
+	}
+}
+
+static void async_early_suspend(void *data, async_cookie_t cookie)
+{
+	early_suspend_call(data, 0);
+}
+
+static void async_late_resume(void *data, async_cookie_t cookie)
+{
+	early_suspend_call(data, 1);
+}
+
+/* Call every suspend (or resume) handler, one level at a time. Async
+ * handlers of a level run concurrently with the rest of that level, and
+ * all of them finish before the next level starts.
+ * Must be called with early_suspend_lock held.
+ */
+static void early_suspend_call_handlers(int resume)
 {
 	struct early_suspend *pos;
+	int level = 0;
+	int first = 1;
+	ktime_t start = ktime_get();
+
+	if (resume)
+		pos = list_entry(early_suspend_handlers.prev,
+				 struct early_suspend, link);
+	else
+		pos = list_entry(early_suspend_handlers.next,
+				 struct early_suspend, link);
+
+	while (&pos->link != &early_suspend_handlers) {
+		if (first || pos->level != level) {
+			async_synchronize_full_domain(
+				&early_suspend_async_domain);
+			level = pos->level;
+			first = 0;
+		}
+		if (resume ? pos->resume != NULL : pos->suspend != NULL) {
+			if (pos->async)
+				async_schedule_domain(resume ?
+					async_late_resume : async_early_suspend,
+					pos, &early_suspend_async_domain);
+			else
+				early_suspend_call(pos, resume);
+		}
+		if (resume)
+			pos = list_entry(pos->link.prev,
+					 struct early_suspend, link);
+		else
+			pos = list_entry(pos->link.next,
+					 struct early_suspend, link);
+	}
+	async_synchronize_full_domain(&early_suspend_async_domain);
+
+	if (resume)
+		late_resume_us = ktime_us_delta(ktime_get(), start);
+	else
+		early_suspend_us = ktime_us_delta(ktime_get(), start);
+}
+
+static void early_suspend(struct work_struct *work)
+{
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -118,10 +194,7 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	early_suspend_call_handlers(0);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -150,7 +223,6 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
 
@@ -174,11 +246,9 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
-		if (pos->resume != NULL)
-			pos->resume(pos);
+	early_suspend_call_handlers(1);
 	if (debug_mask & DEBUG_SUSPEND)
-		pr_info("late_resume: done\n");
+		pr_info("late_resume: done, %lu us\n", late_resume_us);
 
 	wake_unlock(&no_suspend_wake_lock);
 
@@ -187,6 +257,28 @@ abort:
 	pr_info("[R] late_resume end\n");
 }
 
+ssize_t resume_stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	struct early_suspend *pos;
+	char *s = buf;
+	char *end = buf + PAGE_SIZE;
+
+	mutex_lock(&early_suspend_lock);
+	s += scnprintf(s, end - s, "early_suspend %lu us, late_resume %lu us\n",
+		       early_suspend_us, late_resume_us);
+	s += scnprintf(s, end - s, "level\tasync\tsuspend_us\tresume_us\n");
+	list_for_each_entry_reverse(pos, &early_suspend_handlers, link)
+		s += scnprintf(s, end - s, "%d\t%d\t%lu\t%lu\t%pf\n",
+			       pos->level, pos->async, pos->suspend_us,
+			       pos->resume_us,
+			       pos->resume ? (void *)pos->resume :
+					     (void *)pos->suspend);
+	mutex_unlock(&early_suspend_lock);
+
+	return s - buf;
+}
+
 #ifdef CONFIG_HTC_ONMODE_CHARGING
 void register_onchg_suspend(struct early_suspend *handler)
 {
@@ -269,6 +269,10 @@ power_attr(wake_lock);
 power_attr(wake_unlock);
 #endif
 
+#ifdef CONFIG_EARLYSUSPEND
+static struct kobj_attribute resume_stats_attr = __ATTR_RO(resume_stats);
+#endif
+
 #ifdef CONFIG_HTC_ONMODE_CHARGING
 static ssize_t state_onchg_show(struct kobject *kobj, struct kobj_attribute *attr,
 			     char *buf)
@@ -324,6 +328,9 @@ static struct attribute * g[] = {
 	&wake_lock_attr.attr,
 	&wake_unlock_attr.attr,
 #endif
+#ifdef CONFIG_EARLYSUSPEND
+	&resume_stats_attr.attr,
+#endif
 #ifdef CONFIG_HTC_ONMODE_CHARGING
 	&state_onchg_attr.attr,
 #endif
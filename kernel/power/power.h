@@ -264,6 +264,8 @@ ssize_t  wake_unlock_store(struct kobject *kobj, struct kobj_attribute *attr,
 /* kernel/power/earlysuspend.c */
 void request_suspend_state(suspend_state_t state);
 suspend_state_t get_suspend_state(void);
+ssize_t resume_stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf);
 #ifdef CONFIG_HTC_ONMODE_CHARGING
 void request_onchg_state(int on);
 int get_onchg_state(void);
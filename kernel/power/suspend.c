@@ -88,6 +88,7 @@ static int suspend_test(int level)
 static int suspend_prepare(void)
 {
 	int error;
+	ktime_t start;
 
 	if (!suspend_ops || !suspend_ops->enter)
 		return -EPERM;
@@ -102,7 +103,9 @@ static int suspend_prepare(void)
 	if (error)
 		goto Finish;
 
+	start = ktime_get();
 	error = suspend_freeze_processes();
+	suspend_stats_step(SUSPEND_STATS_FREEZE, start);
 	if (!error)
 		return 0;
 
@@ -199,6 +202,7 @@ static int suspend_enter(suspend_state_t state)
 int suspend_devices_and_enter(suspend_state_t state)
 {
 	int error;
+	ktime_t start;
 
 	if (!suspend_ops)
 		return -ENOSYS;
@@ -212,7 +216,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 		suspend_console();
 	pm_restrict_gfp_mask();
 	suspend_test_start();
+	start = ktime_get();
 	error = dpm_suspend_start(PMSG_SUSPEND);
+	suspend_stats_step(SUSPEND_STATS_SUSPEND, start);
 	if (error) {
 		printk(KERN_ERR "PM: Some devices failed to suspend\n");
 		goto Recover_platform;
@@ -225,7 +231,9 @@ int suspend_devices_and_enter(suspend_state_t state)
 
  Resume_devices:
 	suspend_test_start();
+	start = ktime_get();
 	dpm_resume_end(PMSG_RESUME);
+	suspend_stats_step(SUSPEND_STATS_RESUME, start);
 	suspend_test_finish("resume devices");
 	pm_restore_gfp_mask();
 	if (!suspend_console_deferred)
@@ -268,6 +276,7 @@ static void suspend_finish(void)
 int enter_state(suspend_state_t state)
 {
 	int error;
+	ktime_t start;
 
 	if (!valid_state(state))
 		return -ENODEV;
@@ -276,7 +285,9 @@ int enter_state(suspend_state_t state)
 		return -EBUSY;
 
 	printk(KERN_INFO "PM: Syncing filesystems ... ");
+	start = ktime_get();
 	sys_sync();
+	suspend_stats_step(SUSPEND_STATS_SYNC, start);
 	printk("done.\n");
 
 	pr_debug("PM: Preparing system for %s sleep\n", pm_states[state]);
@@ -0,0 +1,198 @@
+/* kernel/power/suspend_stats.c
+ *
+ * Per-attempt suspend statistics
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/suspend.h>
+
+#define SUSPEND_STATS_RECORDS	16
+#define SUSPEND_STATS_DEVICES	4
+#define SUSPEND_STATS_NAME_LEN	24
+
+struct suspend_stats_dev {
+	char name[SUSPEND_STATS_NAME_LEN];
+	unsigned long us;
+};
+
+struct suspend_attempt {
+	unsigned int num;
+	ktime_t start;
+	unsigned long total_us;
+	unsigned long step_us[SUSPEND_STATS_NR_STEPS];
+	int ret;
+	char abort_lock[SUSPEND_STATS_NAME_LEN];
+	/* slowest callbacks, [0] for suspend and [1] for resume */
+	struct suspend_stats_dev slowest[2][SUSPEND_STATS_DEVICES];
+};
+
+static DEFINE_SPINLOCK(suspend_stats_lock);
+static struct suspend_attempt suspend_attempts[SUSPEND_STATS_RECORDS];
+static unsigned int suspend_attempt_count;
+static struct suspend_attempt *cur_attempt;
+
+static const char *suspend_stats_step_names[SUSPEND_STATS_NR_STEPS] = {
+	[SUSPEND_STATS_SYNC] = "sync",
+	[SUSPEND_STATS_FREEZE] = "freeze",
+	[SUSPEND_STATS_SUSPEND] = "suspend",
+	[SUSPEND_STATS_RESUME] = "resume",
+};
+
+void suspend_stats_begin(void)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	cur_attempt = &suspend_attempts[suspend_attempt_count %
+					SUSPEND_STATS_RECORDS];
+	memset(cur_attempt, 0, sizeof(*cur_attempt));
+	cur_attempt->num = suspend_attempt_count++;
+	cur_attempt->start = ktime_get();
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+}
+
+void suspend_stats_step(enum suspend_stats_step step, ktime_t start)
+{
+	unsigned long us = ktime_us_delta(ktime_get(), start);
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	if (cur_attempt)
+		cur_attempt->step_us[step] += us;
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+}
+
+void suspend_stats_device(struct device *dev, ktime_t start, int resume)
+{
+	unsigned long us = ktime_us_delta(ktime_get(), start);
+	struct suspend_stats_dev *slowest;
+	unsigned long irqflags;
+	int i;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	if (!cur_attempt)
+		goto out;
+
+	/* keep the list sorted, slowest first */
+	slowest = cur_attempt->slowest[!!resume];
+	if (us <= slowest[SUSPEND_STATS_DEVICES - 1].us)
+		goto out;
+	for (i = SUSPEND_STATS_DEVICES - 1;
+	     i > 0 && slowest[i - 1].us < us; i--)
+		slowest[i] = slowest[i - 1];
+	strlcpy(slowest[i].name, dev_name(dev), SUSPEND_STATS_NAME_LEN);
+	slowest[i].us = us;
+out:
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+}
+
+void suspend_stats_abort(const char *name)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	if (cur_attempt && !cur_attempt->abort_lock[0])
+		strlcpy(cur_attempt->abort_lock, name, SUSPEND_STATS_NAME_LEN);
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+}
+
+void suspend_stats_end(int ret)
+{
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	if (cur_attempt) {
+		cur_attempt->ret = ret;
+		cur_attempt->total_us =
+			ktime_us_delta(ktime_get(), cur_attempt->start);
+		cur_attempt = NULL;
+	}
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+}
+
+static void suspend_stats_show_devs(struct seq_file *m, const char *label,
+				    struct suspend_stats_dev *slowest)
+{
+	int i;
+
+	if (!slowest[0].us)
+		return;
+	seq_printf(m, "  slowest %s:", label);
+	for (i = 0; i < SUSPEND_STATS_DEVICES && slowest[i].us; i++)
+		seq_printf(m, " %s %lu", slowest[i].name, slowest[i].us);
+	seq_putc(m, '\n');
+}
+
+static int suspend_stats_show(struct seq_file *m, void *unused)
+{
+	struct suspend_attempt *a;
+	unsigned long irqflags;
+	unsigned int n, first;
+	int step;
+
+	spin_lock_irqsave(&suspend_stats_lock, irqflags);
+	first = suspend_attempt_count > SUSPEND_STATS_RECORDS ?
+		suspend_attempt_count - SUSPEND_STATS_RECORDS : 0;
+	for (n = first; n < suspend_attempt_count; n++) {
+		a = &suspend_attempts[n % SUSPEND_STATS_RECORDS];
+		if (a == cur_attempt)
+			continue;
+		seq_printf(m, "attempt %u at %lld ms: ret %d, %lu us\n",
+			   a->num, ktime_to_ms(a->start), a->ret, a->total_us);
+		seq_printf(m, " ");
+		for (step = 0; step < SUSPEND_STATS_NR_STEPS; step++)
+			seq_printf(m, " %s %lu", suspend_stats_step_names[step],
+				   a->step_us[step]);
+		seq_putc(m, '\n');
+		if (a->abort_lock[0])
+			seq_printf(m, "  aborted by \"%s\"\n", a->abort_lock);
+		suspend_stats_show_devs(m, "suspend", a->slowest[0]);
+		suspend_stats_show_devs(m, "resume", a->slowest[1]);
+	}
+	spin_unlock_irqrestore(&suspend_stats_lock, irqflags);
+	return 0;
+}
+
+static int suspend_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, suspend_stats_show, NULL);
+}
+
+static const struct file_operations suspend_stats_fops = {
+	.open		= suspend_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init suspend_stats_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("suspend_attempts", 0444, NULL, NULL,
+				&suspend_stats_fops);
+	if (!d) {
+		pr_err("Failed to create suspend_attempts debug file\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+late_initcall(suspend_stats_init);
@@ -43,6 +43,10 @@ module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 static DEFINE_SPINLOCK(list_lock);
 static LIST_HEAD(inactive_locks);
 static struct list_head active_wake_locks[WAKE_LOCK_TYPE_COUNT];
+/* active locks with a timeout, sorted by expiry */
+static struct rb_root expire_tree[WAKE_LOCK_TYPE_COUNT];
+/* number of active locks without a timeout */
+static int active_untimed_locks[WAKE_LOCK_TYPE_COUNT];
 static int current_event_num;
 struct workqueue_struct *suspend_work_queue;
 struct wake_lock main_wake_lock;
@@ -145,20 +149,24 @@ static void wake_unlock_stat_locked(struct wake_lock *lock, int expired)
 {
 	ktime_t duration;
 	ktime_t now;
+	ktime_t last_time;
 	if (!(lock->flags & WAKE_LOCK_ACTIVE))
 		return;
-	if (get_expired_time(lock, &now))
+	last_time = lock->stat.last_time;
+	if (get_expired_time(lock, &now)) {
 		expired = 1;
-	else
+		lock->stat.last_time = ktime_get();
+	} else {
 		now = ktime_get();
+		lock->stat.last_time = now;
+	}
 	lock->stat.count++;
 	if (expired)
 		lock->stat.expire_count++;
-	duration = ktime_sub(now, lock->stat.last_time);
+	duration = ktime_sub(now, last_time);
 	lock->stat.total_time = ktime_add(lock->stat.total_time, duration);
-	if (ktime_to_ns(duration) > ktime_to_ns(lock->stat.max_time))
+	if (duration.tv64 > lock->stat.max_time.tv64)
 		lock->stat.max_time = duration;
-	lock->stat.last_time = ktime_get();
 	if (lock->flags & WAKE_LOCK_PREVENTING_SUSPEND) {
 		duration = ktime_sub(now, last_sleep_time_update);
 		lock->stat.prevent_suspend_time = ktime_add(
@@ -195,13 +203,47 @@ static void update_sleep_wait_stats_locked(int done)
 #endif
 
 
+/* Caller must acquire the list_lock spinlock */
+static void expire_tree_insert(struct wake_lock *lock, int type)
+{
+	struct rb_node **p = &expire_tree[type].rb_node;
+	struct rb_node *parent = NULL;
+	struct wake_lock *entry;
+
+	while (*p) {
+		parent = *p;
+		entry = rb_entry(parent, struct wake_lock, expire_node);
+		if ((long)(lock->expires - entry->expires) < 0)
+			p = &parent->rb_left;
+		else
+			p = &parent->rb_right;
+	}
+	rb_link_node(&lock->expire_node, parent, p);
+	rb_insert_color(&lock->expire_node, &expire_tree[type]);
+}
+
+/* Take the lock off the active or inactive list and, if it is active,
+ * out of the expiry accounting. Must be called before the lock flags are
+ * changed. Caller must acquire the list_lock spinlock.
+ */
+static void wake_lock_detach(struct wake_lock *lock, int type)
+{
+	if (lock->flags & WAKE_LOCK_ACTIVE) {
+		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE)
+			rb_erase(&lock->expire_node, &expire_tree[type]);
+		else
+			active_untimed_locks[type]--;
+	}
+	list_del(&lock->link);
+}
+
 static void expire_wake_lock(struct wake_lock *lock)
 {
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_unlock_stat_locked(lock, 1);
 #endif
+	wake_lock_detach(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
 	if (debug_mask & (DEBUG_WAKE_LOCK | DEBUG_EXPIRE))
 		pr_info("expired wake lock %s\n", lock->name);
@@ -232,21 +274,38 @@ static void print_active_locks(int type)
 
 static long has_wake_lock_locked(int type)
 {
-	struct wake_lock *lock, *n;
-	long max_timeout = 0;
+	struct rb_node *node;
+	struct wake_lock *lock;
 
 	BUG_ON(type >= WAKE_LOCK_TYPE_COUNT);
-	list_for_each_entry_safe(lock, n, &active_wake_locks[type], link) {
-		if (lock->flags & WAKE_LOCK_AUTO_EXPIRE) {
-			long timeout = lock->expires - jiffies;
-			if (timeout <= 0)
-				expire_wake_lock(lock);
-			else if (timeout > max_timeout)
-				max_timeout = timeout;
-		} else
-			return -1;
+	if (active_untimed_locks[type])
+		return -1;
+	while ((node = rb_first(&expire_tree[type]))) {
+		lock = rb_entry(node, struct wake_lock, expire_node);
+		if ((long)(lock->expires - jiffies) > 0)
+			break;
+		expire_wake_lock(lock);
 	}
-	return max_timeout;
+	node = rb_last(&expire_tree[type]);
+	if (!node)
+		return 0;
+	lock = rb_entry(node, struct wake_lock, expire_node);
+	return lock->expires - jiffies;
+}
+
+/* Record the wake lock that is blocking suspend in the attempt stats */
+static void suspend_stats_blocker(void)
+{
+	struct wake_lock *lock;
+	unsigned long irqflags;
+
+	spin_lock_irqsave(&list_lock, irqflags);
+	if (!list_empty(&active_wake_locks[WAKE_LOCK_SUSPEND])) {
+		lock = list_first_entry(&active_wake_locks[WAKE_LOCK_SUSPEND],
+					struct wake_lock, link);
+		suspend_stats_abort(lock->name);
+	}
+	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 
 long has_wake_lock(int type)
@@ -269,25 +328,32 @@ static void suspend(struct work_struct *work)
 {
 	int ret;
 	int entry_event_num;
+	ktime_t start;
 
 	pr_info("[R] suspend start\n");
+	suspend_stats_begin();
 	if (has_wake_lock(WAKE_LOCK_SUSPEND)) {
 		if (debug_mask & DEBUG_SUSPEND)
 			pr_info("suspend: abort suspend\n");
+		suspend_stats_blocker();
+		suspend_stats_end(-EAGAIN);
 		return;
 	}
 
 	entry_event_num = current_event_num;
 
+	start = ktime_get();
 #ifdef CONFIG_SYS_SYNC_BLOCKING_DEBUG
 	sys_sync_debug();
 #else
 	sys_sync();
 #endif
+	suspend_stats_step(SUSPEND_STATS_SYNC, start);
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("suspend: enter suspend\n");
 	ret = pm_suspend(requested_suspend_state);
+	suspend_stats_end(ret);
 	if (debug_mask & DEBUG_EXIT_SUSPEND) {
 		struct timespec ts;
 		struct rtc_time tm;
@@ -328,6 +394,8 @@ static DEFINE_TIMER(expire_timer, expire_wake_locks, 0, 0);
 static int power_suspend_late(struct device *dev)
 {
 	int ret = has_wake_lock(WAKE_LOCK_SUSPEND) ? -EAGAIN : 0;
+	if (ret)
+		suspend_stats_blocker();
 #ifdef CONFIG_WAKELOCK_STAT
 	wait_for_wakeup = 1;
 #endif
@@ -382,6 +450,7 @@ void wake_lock_destroy(struct wake_lock *lock)
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_lock_destroy name=%s\n", lock->name);
 	spin_lock_irqsave(&list_lock, irqflags);
+	wake_lock_detach(lock, lock->flags & WAKE_LOCK_TYPE_MASK);
 	lock->flags &= ~WAKE_LOCK_INITIALIZED;
 #ifdef CONFIG_WAKELOCK_STAT
 	if (lock->stat.count) {
@@ -398,7 +467,6 @@ void wake_lock_destroy(struct wake_lock *lock)
 				  lock->stat.max_time);
 	}
 #endif
-	list_del(&lock->link);
 	spin_unlock_irqrestore(&list_lock, irqflags);
 }
 EXPORT_SYMBOL(wake_lock_destroy);
@@ -427,13 +495,13 @@ static void wake_lock_internal(
 		lock->stat.last_time = ktime_get();
 	}
 #endif
+	wake_lock_detach(lock, type);
 	if (!(lock->flags & WAKE_LOCK_ACTIVE)) {
 		lock->flags |= WAKE_LOCK_ACTIVE;
 #ifdef CONFIG_WAKELOCK_STAT
 		lock->stat.last_time = ktime_get();
 #endif
 	}
-	list_del(&lock->link);
 	if (has_timeout) {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d, timeout %ld.%03lu\n",
@@ -442,12 +510,14 @@ static void wake_lock_internal(
 		lock->expires = jiffies + timeout;
 		lock->flags |= WAKE_LOCK_AUTO_EXPIRE;
 		list_add_tail(&lock->link, &active_wake_locks[type]);
+		expire_tree_insert(lock, type);
 	} else {
 		if (debug_mask & DEBUG_WAKE_LOCK)
 			pr_info("wake_lock: %s, type %d\n", lock->name, type);
 		lock->expires = LONG_MAX;
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
+		active_untimed_locks[type]++;
 	}
 	if (type == WAKE_LOCK_SUSPEND) {
 		current_event_num++;
@@ -501,8 +571,8 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	wake_lock_detach(lock, type);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
-	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
 	if (type == WAKE_LOCK_SUSPEND) {
 		long has_lock = has_wake_lock_locked(type);
@@ -555,8 +625,10 @@ static int __init wakelocks_init(void)
 	int ret;
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++)
+	for (i = 0; i < ARRAY_SIZE(active_wake_locks); i++) {
 		INIT_LIST_HEAD(&active_wake_locks[i]);
+		expire_tree[i] = RB_ROOT;
+	}
 
 #ifdef CONFIG_WAKELOCK_STAT
 	wake_lock_init(&deleted_wake_locks, WAKE_LOCK_SUSPEND,
@@ -0,0 +1,91 @@
+/* kernel/power/wakelock_test.c
+ *
+ * Wake lock lock/unlock microbenchmark, run once during bootup.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/wakelock.h>
+
+#include <asm/div64.h>
+
+#define TEST_WAKELOCK_BACKGROUND	128
+#define TEST_WAKELOCK_LOOPS		10000
+
+static struct wake_lock test_lock;
+
+static void __init test_wakelock_report(const char *label, ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	do_div(ns, TEST_WAKELOCK_LOOPS);
+	pr_info("wakelock test: %s: %llu ns\n", label, ns);
+}
+
+static void __init test_wakelock_run(const char *label)
+{
+	ktime_t start;
+	int i;
+
+	pr_info("wakelock test: %s\n", label);
+
+	start = ktime_get();
+	for (i = 0; i < TEST_WAKELOCK_LOOPS; i++) {
+		wake_lock(&test_lock);
+		wake_unlock(&test_lock);
+	}
+	test_wakelock_report("lock/unlock", start);
+
+	start = ktime_get();
+	for (i = 0; i < TEST_WAKELOCK_LOOPS; i++) {
+		wake_lock_timeout(&test_lock, HZ);
+		wake_unlock(&test_lock);
+	}
+	test_wakelock_report("lock_timeout/unlock", start);
+
+	start = ktime_get();
+	for (i = 0; i < TEST_WAKELOCK_LOOPS; i++)
+		has_wake_lock(WAKE_LOCK_SUSPEND);
+	test_wakelock_report("has_wake_lock", start);
+}
+
+static int __init test_wakelock(void)
+{
+	struct wake_lock *locks;
+	int i;
+
+	locks = kzalloc(sizeof(*locks) * TEST_WAKELOCK_BACKGROUND, GFP_KERNEL);
+	if (!locks)
+		return -ENOMEM;
+
+	wake_lock_init(&test_lock, WAKE_LOCK_SUSPEND, "wakelock_test");
+	test_wakelock_run("no other test locks held");
+
+	for (i = 0; i < TEST_WAKELOCK_BACKGROUND; i++) {
+		wake_lock_init(&locks[i], WAKE_LOCK_SUSPEND,
+			       "wakelock_test_bg");
+		wake_lock_timeout(&locks[i], 10 * HZ + i);
+	}
+	test_wakelock_run("128 timed locks held");
+
+	for (i = 0; i < TEST_WAKELOCK_BACKGROUND; i++) {
+		wake_unlock(&locks[i]);
+		wake_lock_destroy(&locks[i]);
+	}
+	wake_lock_destroy(&test_lock);
+	kfree(locks);
+	return 0;
+}
+late_initcall(test_wakelock);